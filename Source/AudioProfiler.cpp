@@ -0,0 +1,212 @@
+#include "AudioProfiler.h"
+#include <algorithm>
+
+AudioProfiler::AudioProfiler()
+    : enabled(false),
+      resetRequested(false),
+      secondsSincePublish(0.0)
+{
+    std::fill(std::begin(trackTicks), std::end(trackTicks), (juce::int64)0);
+    std::fill(&stageTicks[0][0], &stageTicks[0][0] + (maxTracks + 1) * numStages, (juce::int64)0);
+}
+
+juce::int64 AudioProfiler::beginBlock() noexcept
+{
+    if (!isEnabled())
+        return 0;
+
+    if (resetRequested.exchange(false))
+    {
+        report = Report();
+        secondsSincePublish = publishInterval; // Show the cleared numbers straight away
+    }
+
+    std::fill(std::begin(trackTicks), std::end(trackTicks), (juce::int64)0);
+    std::fill(&stageTicks[0][0], &stageTicks[0][0] + (maxTracks + 1) * numStages, (juce::int64)0);
+
+    return juce::Time::getHighResolutionTicks();
+}
+
+void AudioProfiler::endBlock(juce::int64 startTicks, int numSamples, double sampleRate) noexcept
+{
+    if (startTicks == 0 || numSamples <= 0 || sampleRate <= 0.0)
+        return;
+
+    const double blockSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    const double deadline = numSamples / sampleRate;
+
+    addToTiming(report.block, blockSeconds, deadline);
+
+    for (int track = 0; track < maxTracks; ++track)
+    {
+        if (trackTicks[track] > 0)
+            addToTiming(report.tracks[track], juce::Time::highResolutionTicksToSeconds(trackTicks[track]), deadline);
+    }
+
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        juce::int64 stageTotal = stageTicks[engineSlot][stage];
+
+        for (int track = 0; track < maxTracks; ++track)
+        {
+            if (stageTicks[track][stage] > 0)
+            {
+                stageTotal += stageTicks[track][stage];
+                addToTiming(report.trackStages[track][stage], juce::Time::highResolutionTicksToSeconds(stageTicks[track][stage]), deadline);
+            }
+        }
+
+        if (stageTotal > 0)
+            addToTiming(report.stages[stage], juce::Time::highResolutionTicksToSeconds(stageTotal), deadline);
+    }
+
+    report.sampleRate = sampleRate;
+    report.blockSize = numSamples;
+    report.secondsProfiled += deadline;
+    secondsSincePublish += deadline;
+
+    if (secondsSincePublish >= publishInterval)
+    {
+        snapshot.publish(report);
+        secondsSincePublish = 0.0;
+    }
+}
+
+void AudioProfiler::addTrackTime(int trackIndex, juce::int64 startTicks) noexcept
+{
+    if (startTicks != 0 && trackIndex >= 0 && trackIndex < maxTracks)
+        trackTicks[trackIndex] += juce::Time::getHighResolutionTicks() - startTicks;
+}
+
+void AudioProfiler::addStageTime(int slot, Stage stage, juce::int64 startTicks) noexcept
+{
+    if (startTicks != 0 && slot >= 0 && slot <= engineSlot && stage >= 0 && stage < numStages)
+        stageTicks[slot][stage] += juce::Time::getHighResolutionTicks() - startTicks;
+}
+
+void AudioProfiler::addToTiming(Timing& timing, double seconds, double deadline) noexcept
+{
+    const double load = seconds / deadline;
+
+    ++timing.numBlocks;
+    timing.totalSeconds += seconds;
+    timing.totalLoad += load;
+    timing.worstSeconds = juce::jmax(timing.worstSeconds, seconds);
+    timing.worstLoad = juce::jmax(timing.worstLoad, load);
+
+    if (load > 1.0)
+        ++timing.numOverruns;
+
+    const int bin = load < 1.0 ? (int)(load * 10.0) : (load < 1.5 ? 10 : 11);
+    ++timing.histogram[juce::jlimit(0, numLoadBins - 1, bin)];
+}
+
+// ============================================================================
+// StageTimer
+// ============================================================================
+
+AudioProfiler::StageTimer::StageTimer(AudioProfiler* profilerToUse, int slotToTime, Stage firstStage) noexcept
+    : profiler(profilerToUse),
+      slot(slotToTime),
+      stage(firstStage),
+      startTicks(profilerToUse != nullptr ? profilerToUse->now() : 0)
+{
+}
+
+void AudioProfiler::StageTimer::next(Stage nextStage) noexcept
+{
+    stop();
+
+    stage = nextStage;
+    startTicks = profiler != nullptr ? profiler->now() : 0;
+}
+
+void AudioProfiler::StageTimer::stop() noexcept
+{
+    if (profiler != nullptr && startTicks != 0)
+        profiler->addStageTime(slot, stage, startTicks);
+
+    startTicks = 0;
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+
+juce::String AudioProfiler::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+        case directCopy:        return "Direct copy";
+        case soundTouchPut:     return "SoundTouch put";
+        case soundTouchReceive: return "SoundTouch receive";
+        case mix:               return "Mix";
+        case metronome:         return "Metronome";
+        case numStages:         break;
+    }
+
+    return {};
+}
+
+juce::String AudioProfiler::toCSV(const Report& report)
+{
+    juce::String csv = "scope,stage,blocks,mean_us,worst_us,mean_load,worst_load,overruns";
+
+    for (int bin = 0; bin < numLoadBins; ++bin)
+    {
+        csv << (bin < 10 ? ",load_" + juce::String(bin * 10) + "_" + juce::String(bin * 10 + 10)
+                         : bin == 10 ? juce::String(",load_100_150") : juce::String(",load_150_up"));
+    }
+
+    csv << "\n";
+
+    auto addRow = [&csv](const juce::String& scope, const juce::String& stage, const Timing& timing)
+    {
+        if (timing.numBlocks == 0)
+            return;
+
+        csv << scope << "," << stage << "," << juce::String((juce::int64)timing.numBlocks) << ","
+            << juce::String(timing.getMeanSeconds() * 1.0e6, 2) << "," << juce::String(timing.worstSeconds * 1.0e6, 2) << ","
+            << juce::String(timing.getMeanLoad(), 4) << "," << juce::String(timing.worstLoad, 4) << ","
+            << juce::String((juce::int64)timing.numOverruns);
+
+        for (juce::uint32 count : timing.histogram)
+            csv << "," << juce::String((juce::int64)count);
+
+        csv << "\n";
+    };
+
+    addRow("block", "all", report.block);
+
+    for (int stage = 0; stage < numStages; ++stage)
+        addRow("all tracks", getStageName((Stage)stage), report.stages[stage]);
+
+    for (int track = 0; track < maxTracks; ++track)
+    {
+        const juce::String scope = "track " + juce::String(track + 1);
+        addRow(scope, "all", report.tracks[track]);
+
+        for (int stage = 0; stage < numStages; ++stage)
+            addRow(scope, getStageName((Stage)stage), report.trackStages[track][stage]);
+    }
+
+    return csv;
+}
+
+juce::Result AudioProfiler::exportCSV(const juce::File& file) const
+{
+    Report current;
+    getReport(current);
+
+    if (current.block.numBlocks == 0)
+        return juce::Result::fail("No audio has been profiled yet");
+
+    if (!file.replaceWithText(toCSV(current)))
+        return juce::Result::fail("Could not write " + file.getFullPathName());
+
+    juce::Logger::writeToLog("Exported the audio profile (" + juce::String(current.secondsProfiled, 1) + "s at " +
+                             juce::String(current.blockSize) + " samples, " + juce::String(current.sampleRate, 0) +
+                             " Hz) to " + file.getFullPathName());
+
+    return juce::Result::ok();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeSnapshot.h"
+#include <atomic>
+
+// Where the audio callback spends its time. The engine brackets every block and each
+// track marks the stages it runs; at the end of the block the times are folded into
+// statistics measured against the block's deadline, its own length in real time. A
+// block that takes longer than that is an overrun: the device would have glitched.
+//
+// Timing a stage costs two tick reads on the audio thread and nothing when profiling is
+// disabled, which it is until switched on from the profiler panel. The statistics are published through a LockFreeSnapshot about ten times a
+// second, so the UI reads them without ever holding the audio thread up.
+class AudioProfiler
+{
+public:
+    enum Stage
+    {
+        directCopy,             // Unstretched playback straight from the source
+        soundTouchPut,          // Feeding source to SoundTouch, which stretches as it goes
+        soundTouchReceive,      // Collecting the stretched audio and adding it to the mix
+        mix,                    // Clearing, solo checks and the master meter
+        metronome,
+        numStages
+    };
+
+    static constexpr int maxTracks = 32;
+    static constexpr int engineSlot = maxTracks;    // For the stages the engine runs itself
+    static constexpr int numLoadBins = 12;          // 10% of the deadline each, then 100-150% and beyond
+
+    struct Timing
+    {
+        juce::uint32 numBlocks = 0;                 // Blocks this ran in
+        juce::uint32 numOverruns = 0;               // Of those, the ones over the deadline
+        double totalSeconds = 0.0;
+        double totalLoad = 0.0;                     // Sum of time over deadline
+        double worstSeconds = 0.0;
+        double worstLoad = 0.0;
+        juce::uint32 histogram[numLoadBins] = {};
+
+        double getMeanSeconds() const { return numBlocks > 0 ? totalSeconds / numBlocks : 0.0; }
+        double getMeanLoad() const { return numBlocks > 0 ? totalLoad / numBlocks : 0.0; }
+    };
+
+    struct Report
+    {
+        Timing block;                               // The whole callback, lock wait included
+        Timing tracks[maxTracks];
+        Timing stages[numStages];                   // Summed over the tracks in each block
+        Timing trackStages[maxTracks][numStages];
+        double sampleRate = 0.0;
+        int blockSize = 0;                          // Of the latest block
+        double secondsProfiled = 0.0;               // Audio time covered since the last reset
+    };
+
+    AudioProfiler();
+
+    void setEnabled(bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Audio thread. Start times come from now(), which is 0 while disabled; anything
+    // started at 0 is ignored, so toggling mid-block never records a bogus time.
+    juce::int64 now() const noexcept
+    {
+        return isEnabled() ? juce::Time::getHighResolutionTicks() : 0;
+    }
+
+    juce::int64 beginBlock() noexcept;
+    void endBlock(juce::int64 startTicks, int numSamples, double sampleRate) noexcept;
+
+    // One track's whole processBlock(), measured by the engine
+    void addTrackTime(int trackIndex, juce::int64 startTicks) noexcept;
+
+    // A stage run by a track, or by the engine in engineSlot. Tracks rendered on pool
+    // threads each write only their own slot.
+    void addStageTime(int slot, Stage stage, juce::int64 startTicks) noexcept;
+
+    // Times a stage from construction, or from the latest next(), until stop() or
+    // destruction. A null profiler makes it do nothing.
+    class StageTimer
+    {
+    public:
+        StageTimer(AudioProfiler* profilerToUse, int slotToTime, Stage firstStage) noexcept;
+        ~StageTimer() { stop(); }
+
+        void next(Stage nextStage) noexcept;
+        void stop() noexcept;
+
+    private:
+        AudioProfiler* profiler;
+        int slot;
+        Stage stage;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(StageTimer)
+    };
+
+    // Any thread: the statistics as last published, and their version
+    juce::uint32 getReport(Report& destination) const { return snapshot.read(destination); }
+    juce::uint32 getReportVersion() const { return snapshot.getVersion(); }
+
+    // Any thread: starts the statistics afresh at the next block
+    void reset() { resetRequested = true; }
+
+    // One CSV row per block, track, stage and track stage, with the load histogram
+    static juce::String toCSV(const Report& report);
+    juce::Result exportCSV(const juce::File& file) const;
+
+    static juce::String getStageName(Stage stage);
+
+private:
+    static constexpr double publishInterval = 0.1;  // Seconds of audio
+
+    std::atomic<bool> enabled;
+    std::atomic<bool> resetRequested;
+    LockFreeSnapshot<Report> snapshot;
+
+    // Audio thread only
+    Report report;
+    double secondsSincePublish;
+    juce::int64 trackTicks[maxTracks];
+    juce::int64 stageTicks[maxTracks + 1][numStages];
+
+    static void addToTiming(Timing& timing, double seconds, double deadline) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioProfiler)
+};
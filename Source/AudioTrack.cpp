@@ -0,0 +1,1201 @@
+#include "AudioTrack.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <cmath>
+
+// Decodes and analyses a file off the message thread, then hands back to the UI
+class AudioTrack::LoaderThread : public juce::Thread
+{
+public:
+    LoaderThread(AudioTrack& owner, const juce::File& file, std::function<void()> callback)
+        : juce::Thread("Track Loader"),
+          track(owner),
+          fileToLoad(file),
+          onLoaded(std::move(callback))
+    {
+    }
+    
+    void run() override
+    {
+        track.loadAudioFile(fileToLoad);
+        
+        if (!threadShouldExit() && onLoaded)
+        {
+            juce::MessageManager::callAsync(onLoaded);
+        }
+    }
+    
+private:
+    AudioTrack& track;
+    juce::File fileToLoad;
+    std::function<void()> onLoaded;
+};
+
+AudioTrack::AudioTrack()
+    : sampleRate(44100.0),
+      currentPosition(0.0),
+      stretchRatio(1.0),
+      effectiveStretchRatio(1.0),
+      detectedBPM(0.0),
+      bpmConfidence(0.0),
+      masterBPM(120.0),
+      startOffset(0.0),
+      preparedBlockSize(512),
+      muted(false),
+      solo(false),
+      looping(true),
+      tempoMapEnabled(false),
+      volume(1.0f),
+      hasCustomLoopRegion(false),
+      loopStartTime(0.0),
+      loopEndTime(0.0),
+      loadingFile(false),
+      loadProgress(0.0),
+      loadCount(0),
+      profiler(nullptr),
+      profilerSlot(0),
+      decodedMemory(MemoryAccounting::decodedAudio),
+      scratchMemory(MemoryAccounting::scratchBuffers),
+      backlogMemory(MemoryAccounting::soundTouchBacklog)
+{
+    formatManager.registerBasicFormats();
+    soundTouch = std::make_unique<soundtouch::SoundTouch>();
+}
+
+AudioTrack::~AudioTrack()
+{
+    if (loaderThread)
+    {
+        loaderThread->stopThread(4000);
+    }
+    
+    juce::ScopedLock sl(lock);
+    
+    if (soundTouch)
+    {
+        soundTouch.reset();
+    }
+    
+    audioBuffer.clear();
+    stretchedBuffer.clear();
+}
+
+void AudioTrack::prepareToPlay(int maxBlockSize)
+{
+    juce::ScopedLock sl(lock);
+    
+    preparedBlockSize = juce::jmax(preparedBlockSize, maxBlockSize);
+    allocateScratchBuffers();
+}
+
+void AudioTrack::allocateScratchBuffers()
+{
+    const int numChannels = juce::jmax(1, audioBuffer.getNumChannels());
+    
+    // Frames are interleaved into the first channel, and up to four times a block is read at the fastest ratio
+    stretchedBuffer.setSize(1, preparedBlockSize * numChannels, false, false, true);
+    interleavedInput.setSize(1, preparedBlockSize * 4 * numChannels, false, false, true);
+    countScratchMemory();
+}
+
+void AudioTrack::countScratchMemory()
+{
+    scratchMemory.set(MemoryAccounting::bytesOf(stretchedBuffer) + MemoryAccounting::bytesOf(interleavedInput));
+}
+
+void AudioTrack::loadAudioFileAsync(const juce::File& file, std::function<void()> onLoaded)
+{
+    if (loaderThread)
+    {
+        loaderThread->stopThread(4000);
+    }
+    
+    loaderThread = std::make_unique<LoaderThread>(*this, file, std::move(onLoaded));
+    loaderThread->startThread();
+}
+
+void AudioTrack::loadAudioFile(const juce::File& file)
+{
+    TraceRecorder::Scope trace("loadAudioFile", "load");
+    
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    
+    if (reader == nullptr)
+        return;
+    
+    const int numChannels = static_cast<int>(reader->numChannels);
+    const int lengthInSamples = static_cast<int>(reader->lengthInSamples);
+    
+    loadingFile = true;
+    loadProgress = 0.0;
+    tempoEstimator.prepare(reader->sampleRate);
+    
+    // Decode in blocks so the streaming estimator can publish a provisional BPM early
+    juce::AudioBuffer<float> decoded(numChannels, lengthInSamples);
+    const int decodeBlockSize = 65536;
+    
+    for (int pos = 0; pos < lengthInSamples; pos += decodeBlockSize)
+    {
+        if (juce::Thread::currentThreadShouldExit())
+        {
+            loadingFile = false;
+            return;
+        }
+        
+        const int samplesThisBlock = juce::jmin(decodeBlockSize, lengthInSamples - pos);
+        
+        {
+            TraceRecorder::Scope decodeTrace("decode", "load");
+            reader->read(&decoded, pos, samplesThisBlock, pos, true, true);
+        }
+        
+        TraceRecorder::Scope estimateTrace("streamingTempoEstimate", "analysis");
+        tempoEstimator.process(decoded, pos, samplesThisBlock);
+        loadProgress = (double)(pos + samplesThisBlock) / lengthInSamples;
+    }
+    
+    {
+        juce::ScopedLock sl(lock);
+        
+        audioBuffer = std::move(decoded);
+        decodedMemory.set(MemoryAccounting::bytesOf(audioBuffer));
+        
+        sampleRate = reader->sampleRate;
+        fileName = file.getFileNameWithoutExtension();
+        currentPosition = 0.0;
+        stretchRatio = 1.0;
+        effectiveStretchRatio = 1.0;
+        startOffset = 0.0;
+        
+        // A confident streaming estimate is good enough to beat-match with while the
+        // slower analysis below runs; the final tempo replaces it
+        const bool provisionalIsConfident = tempoEstimator.getConfidence() >= minimumStreamingConfidence;
+        detectedBPM = provisionalIsConfident ? tempoEstimator.getBPM() : 0.0;
+        bpmConfidence = provisionalIsConfident ? tempoEstimator.getConfidence() : 0.0;
+        onsetEnvelope.clear();
+        tempoCandidates.clear();
+        tempoMap.clear();
+        
+        // Clear any existing loop region when loading new file
+        hasCustomLoopRegion = false;
+        loopStartTime = 0.0;
+        loopEndTime = 0.0;
+        
+        initializeSoundTouch();
+        allocateScratchBuffers();
+        publishState();
+    }
+    
+    // Analysis only reads the decoded audio, so playback can continue meanwhile. Results
+    // stay local until the end and are published in one step, and the loader may be
+    // stopped between stages, so nothing half-finished is ever seen.
+    auto stopRequested = [this]
+    {
+        if (!juce::Thread::currentThreadShouldExit())
+            return false;
+        
+        loadingFile = false;
+        return true;
+    };
+    
+    generateWaveformPeaks();
+    
+    if (stopRequested())
+        return;
+    
+    // Onset envelope is shared by the onset detector and the beat tracker
+    const std::vector<float> onsets = analyseSpectrum();
+    
+    if (stopRequested())
+        return;
+    
+    // Zero crossings and transients for snapping loop points and edits
+    buildSnapIndex(onsets);
+    
+    if (stopRequested())
+        return;
+    
+    // Ranked candidates from the onset histogram; the fallback chain only runs when
+    // none of them is clearly supported
+    std::vector<TempoCandidate> candidates;
+    
+    {
+        TraceRecorder::Scope candidatesTrace("rankTempoCandidates", "analysis");
+        candidates = TempoAnalysis::rankTempoCandidates(detectOnsetTimes(onsets), maxTempoCandidates);
+    }
+    
+    double bpm = 0.0;
+    double confidence = 0.0;
+    
+    if (!candidates.empty() && candidates.front().confidence >= minimumCandidateConfidence)
+    {
+        bpm = candidates.front().bpm;
+        confidence = candidates.front().confidence;
+    }
+    else if (tempoEstimator.getConfidence() >= minimumStreamingConfidence)
+    {
+        // The streaming estimate already is an autocorrelation of the whole file
+        bpm = tempoEstimator.getBPM();
+        confidence = tempoEstimator.getConfidence();
+    }
+    else
+    {
+        bpm = detectBPMAutocorrelation();
+        
+        if (stopRequested())
+            return;
+        
+        // Final fallback to pattern-based detection
+        if (bpm < 60.0 || bpm > 200.0)
+        {
+            bpm = detectBPMImproved();
+        }
+    }
+    
+    // Ultimate fallback
+    if (bpm < 60.0 || bpm > 200.0)
+    {
+        bpm = 120.0;
+        confidence = 0.0;
+        juce::Logger::writeToLog("BPM detection failed for " + fileName + " - using 120 BPM default. Use manual grid adjustment.");
+    }
+    
+    TempoMap newTempoMap = buildTempoMap(onsets, bpm, sampleRate, fileName);
+    
+    if (stopRequested())
+        return;
+    
+    {
+        juce::ScopedLock sl(lock);
+        onsetEnvelope = onsets;
+        tempoCandidates = std::move(candidates);
+        detectedBPM = bpm;
+        bpmConfidence = confidence;
+        tempoMap = std::move(newTempoMap);
+        ++loadCount;
+        publishState();
+    }
+    
+    loadingFile = false;
+    
+    juce::Logger::writeToLog("Loaded: " + fileName +
+                            " - BPM: " + juce::String(bpm, 1) +
+                            " (provisional " + juce::String(tempoEstimator.getBPM(), 1) +
+                            " at " + juce::String((int)(tempoEstimator.getConfidence() * 100.0)) + "% confidence)");
+}
+
+std::vector<TempoCandidate> AudioTrack::getTempoCandidates() const
+{
+    juce::ScopedLock sl(lock);
+    return tempoCandidates;
+}
+
+std::vector<float> AudioTrack::getOnsetEnvelope() const
+{
+    juce::ScopedLock sl(lock);
+    return onsetEnvelope;
+}
+
+double AudioTrack::detectBPMFromOnsets(const std::vector<float>& onsets)
+{
+    if (!isLoaded() || audioBuffer.getNumSamples() < (int)sampleRate)
+        return 120.0;
+    
+    return TempoAnalysis::detectBPMFromOnsets(onsets, sampleRate);
+}
+
+std::vector<double> AudioTrack::detectOnsetTimes(const std::vector<float>& onsets)
+{
+    if (!isLoaded() || audioBuffer.getNumSamples() < (int)sampleRate)
+        return {};
+    
+    return TempoAnalysis::pickOnsetTimes(onsets, sampleRate);
+}
+
+std::vector<float> AudioTrack::analyseSpectrum()
+{
+    TraceRecorder::Scope trace("analyseSpectrum", "analysis");
+    
+    // One STFT of the mono mix feeds both the onset envelope and the spectrogram lane
+    std::shared_ptr<const WaveformPeaks> peaks = getWaveformPeaks();
+    auto newSpectrogram = std::make_shared<Spectrogram>();
+    
+    if (peaks != nullptr)
+        newSpectrogram->build(peaks->getSamples(), sampleRate);
+    
+    std::vector<float> onsets = newSpectrogram->getOnsetStrength();
+    
+    {
+        juce::ScopedLock sl(lock);
+        spectrogram = std::move(newSpectrogram);
+    }
+    
+    return onsets;
+}
+
+void AudioTrack::buildSnapIndex(const std::vector<float>& onsets)
+{
+    TraceRecorder::Scope trace("buildSnapIndex", "analysis");
+    
+    std::shared_ptr<const WaveformPeaks> peaks = getWaveformPeaks();
+    auto newSnapIndex = std::make_shared<SnapIndex>();
+    
+    if (peaks != nullptr)
+        newSnapIndex->build(peaks->getSamples(), onsets, sampleRate);
+    
+    juce::Logger::writeToLog("Snap index: " + juce::String(newSnapIndex->getNumZeroCrossings()) + " zero crossings, "
+                             + juce::String(newSnapIndex->getNumTransients()) + " transients");
+    
+    juce::ScopedLock sl(lock);
+    snapIndex = std::move(newSnapIndex);
+}
+
+double AudioTrack::detectBPMAutocorrelation()
+{
+    TraceRecorder::Scope trace("detectBPMAutocorrelation", "analysis");
+    
+    return TempoAnalysis::detectBPMAutocorrelation(audioBuffer, sampleRate);
+}
+
+double AudioTrack::detectBPMImproved()
+{
+    TraceRecorder::Scope trace("detectBPMImproved", "analysis");
+    
+    if (!isLoaded() || audioBuffer.getNumSamples() == 0)
+        return 120.0;
+    
+    return TempoAnalysis::detectBPMImproved(getDurationInSeconds());
+}
+
+void AudioTrack::setManualBPM(double bpm)
+{
+    if (bpm < 60.0 || bpm > 200.0)
+        return;
+    
+    std::vector<float> onsets;
+    double sourceSampleRate = 0.0;
+    juce::String name;
+    int startLoadCount = 0;
+    
+    {
+        juce::ScopedLock sl(lock);
+        onsets = onsetEnvelope;
+        sourceSampleRate = sampleRate;
+        name = fileName;
+        startLoadCount = loadCount;
+    }
+    
+    // Beat tracking covers the whole envelope, so it runs without the lock; grid drags
+    // call this on every mouse move and the audio thread must not wait on them
+    TempoMap newTempoMap = buildTempoMap(onsets, bpm, sourceSampleRate, name);
+    
+    juce::ScopedLock sl(lock);
+    
+    // A file that finished loading meanwhile has its own tempo and map
+    if (loadCount != startLoadCount)
+        return;
+    
+    detectedBPM = bpm;
+    bpmConfidence = 1.0;
+    tempoMap = std::move(newTempoMap);
+    publishState();
+    juce::Logger::writeToLog("Manual BPM set to: " + juce::String(bpm, 1) + " for " + name);
+}
+
+TempoMap AudioTrack::buildTempoMap(const std::vector<float>& onsets, double bpm, double sourceSampleRate,
+                                   const juce::String& name)
+{
+    TraceRecorder::Scope trace("buildTempoMap", "analysis");
+    
+    // Beat tracking is seeded with the nominal BPM, so it is redone whenever that changes.
+    // It reads no members, so callers run it without the lock and swap the map in under it.
+    const double framesPerSecond = sourceSampleRate / 512.0;
+    std::vector<double> beatTimes = TempoAnalysis::trackBeats(onsets, framesPerSecond, bpm);
+    
+    TempoMap newMap;
+    newMap.build(beatTimes, bpm);
+    
+    if (!newMap.isEmpty())
+    {
+        juce::Logger::writeToLog("Tempo map for " + name + ": " + juce::String((int)beatTimes.size()) +
+                                " beats around " + juce::String(bpm, 1) + " BPM");
+    }
+    
+    return newMap;
+}
+
+void AudioTrack::autoSyncToMaster()
+{
+    if (detectedBPM > 0.0 && masterBPM > 0.0)
+    {
+        double syncRatio = detectedBPM / masterBPM;
+        setStretchRatio(syncRatio);
+    }
+}
+
+void AudioTrack::initializeSoundTouch()
+{
+    TraceRecorder::Scope trace("initializeSoundTouch", "load");
+    
+    if (soundTouch && audioBuffer.getNumSamples() > 0)
+    {
+        soundTouch->setSampleRate(static_cast<uint32_t>(sampleRate));
+        soundTouch->setChannels(audioBuffer.getNumChannels());
+        soundTouch->setTempo(stretchRatio);
+        soundTouch->setPitch(1.0);
+        soundTouch->clear();
+    }
+}
+
+void AudioTrack::generateWaveformPeaks()
+{
+    TraceRecorder::Scope trace("generateWaveformPeaks", "analysis");
+    
+    // Built once, then only ever shared read-only with the views
+    auto peaks = std::make_shared<WaveformPeaks>();
+    peaks->build(audioBuffer);
+    
+    juce::ScopedLock sl(lock);
+    waveformPeaks = std::move(peaks);
+}
+
+std::shared_ptr<const WaveformPeaks> AudioTrack::getWaveformPeaks() const
+{
+    juce::ScopedLock sl(lock);
+    return waveformPeaks;
+}
+
+std::shared_ptr<const Spectrogram> AudioTrack::getSpectrogram() const
+{
+    juce::ScopedLock sl(lock);
+    return spectrogram;
+}
+
+std::shared_ptr<const SnapIndex> AudioTrack::getSnapIndex() const
+{
+    juce::ScopedLock sl(lock);
+    return snapIndex;
+}
+
+void AudioTrack::setStretchRatio(double ratio)
+{
+    juce::ScopedLock sl(lock);
+    
+    double newRatio = juce::jlimit(0.25, 4.0, ratio);
+    if (std::abs(newRatio - stretchRatio) > 0.001)
+    {
+        stretchRatio = newRatio;
+        publishState();
+    }
+}
+
+void AudioTrack::scaleStretchRatio(double scaleFactor)
+{
+    juce::ScopedLock sl(lock);
+    
+    double newRatio = stretchRatio * scaleFactor;
+    newRatio = juce::jlimit(0.25, 4.0, newRatio);
+    
+    if (std::abs(newRatio - stretchRatio) > 0.001)
+    {
+        stretchRatio = newRatio;
+        publishState();
+    }
+}
+
+void AudioTrack::setPosition(double positionInSeconds)
+{
+    juce::ScopedLock sl(lock);
+    
+    // If there's a custom loop region, constrain position within it
+    if (hasCustomLoopRegion && loopEndTime > loopStartTime)
+    {
+        currentPosition = juce::jlimit(loopStartTime, loopEndTime, positionInSeconds);
+    }
+    else
+    {
+        currentPosition = juce::jlimit(0.0, getDurationInSeconds(), positionInSeconds);
+    }
+    
+    publishState();
+}
+
+void AudioTrack::setTransportPosition(double transportSeconds)
+{
+    setPosition(transportToSourcePosition(transportSeconds));
+}
+
+void AudioTrack::setStartOffset(double offsetInSeconds)
+{
+    juce::ScopedLock sl(lock);
+    
+    double rangeLength = hasCustomLoopRegion ? loopEndTime - loopStartTime : getDurationInSeconds();
+    
+    if (rangeLength > 0.0)
+    {
+        offsetInSeconds = std::fmod(offsetInSeconds, rangeLength);
+        if (offsetInSeconds < 0.0)
+            offsetInSeconds += rangeLength;
+    }
+    
+    startOffset = offsetInSeconds;
+}
+
+double AudioTrack::transportToSourcePosition(double transportSeconds) const
+{
+    const bool useLoopRegion = hasCustomLoopRegion && loopEndTime > loopStartTime;
+    const double rangeStart = useLoopRegion ? loopStartTime : 0.0;
+    const double rangeLength = useLoopRegion ? loopEndTime - loopStartTime : getDurationInSeconds();
+    
+    // Source audio runs at the stretch ratio relative to the transport
+    double position = startOffset + transportSeconds * stretchRatio;
+    
+    if (looping && rangeLength > 0.0)
+    {
+        position = std::fmod(position, rangeLength);
+        if (position < 0.0)
+            position += rangeLength;
+    }
+    
+    return rangeStart + position;
+}
+
+void AudioTrack::reset()
+{
+    juce::ScopedLock sl(lock);
+    
+    // Back to the loop start (or the beginning), shifted by the alignment offset
+    currentPosition = transportToSourcePosition(0.0);
+    
+    if (soundTouch)
+        soundTouch->clear();
+    
+    publishState();
+}
+
+void AudioTrack::setMasterBPM(double newMasterBPM)
+{
+    juce::ScopedLock sl(lock);
+    masterBPM = newMasterBPM;
+}
+
+void AudioTrack::setMuted(bool shouldBeMuted)
+{
+    juce::ScopedLock sl(lock);
+    muted = shouldBeMuted;
+    publishState();
+}
+
+void AudioTrack::setSolo(bool shouldBeSolo)
+{
+    juce::ScopedLock sl(lock);
+    solo = shouldBeSolo;
+    publishState();
+}
+
+void AudioTrack::setVolume(float newVolume)
+{
+    juce::ScopedLock sl(lock);
+    volume = newVolume;
+    publishState();
+}
+
+void AudioTrack::setLooping(bool shouldLoop)
+{
+    juce::ScopedLock sl(lock);
+    looping = shouldLoop;
+    publishState();
+}
+
+void AudioTrack::setTempoMapEnabled(bool shouldFollow)
+{
+    juce::ScopedLock sl(lock);
+    tempoMapEnabled = shouldFollow;
+    publishState();
+}
+
+void AudioTrack::publishState()
+{
+    State newState;
+    newState.position = currentPosition;
+    newState.stretchRatio = stretchRatio;
+    newState.effectiveStretchRatio = effectiveStretchRatio;
+    newState.detectedBPM = detectedBPM;
+    newState.durationInSeconds = getDurationInSeconds();
+    newState.loopStart = loopStartTime;
+    newState.loopEnd = loopEndTime;
+    newState.volume = volume;
+    newState.loadCount = loadCount;
+    newState.loaded = isLoaded();
+    newState.muted = muted;
+    newState.solo = solo;
+    newState.looping = looping;
+    newState.tempoMapEnabled = tempoMapEnabled;
+    newState.hasTempoMap = !tempoMap.isEmpty();
+    newState.hasLoopRegion = hasCustomLoopRegion;
+    
+    state.publish(newState);
+}
+
+void AudioTrack::processBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    juce::ScopedLock sl(lock);
+    
+    // Mute and solo are the mixer's business; stems render muted tracks too
+    if (!isLoaded() || numSamples <= 0 || startSample < 0)
+    {
+        return;
+    }
+    
+    const int outputChannels = buffer.getNumChannels();
+    const int inputChannels = audioBuffer.getNumChannels();
+    const int totalSamples = audioBuffer.getNumSamples();
+    
+    if (outputChannels <= 0 || inputChannels <= 0 || totalSamples <= 0)
+        return;
+    
+    if (startSample + numSamples > buffer.getNumSamples())
+        return;
+    
+    effectiveStretchRatio = stretchRatio;
+    
+    if (tempoMapEnabled && !tempoMap.isEmpty())
+    {
+        // Follow the performance: divide by local tempo over nominal tempo, one lookup per block
+        effectiveStretchRatio = juce::jlimit(0.25, 4.0, tempoMap.getWarpedRatioAt(currentPosition, stretchRatio));
+    }
+    
+    if (std::abs(effectiveStretchRatio - 1.0) < 0.02)
+    {
+        processDirectPlayback(buffer, startSample, numSamples);
+    }
+    else
+    {
+        processWithSoundTouch(buffer, startSample, numSamples);
+    }
+    
+    levelMeter.publish();
+    publishState();
+}
+
+void AudioTrack::processDirectPlayback(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    AudioProfiler::StageTimer timer(profiler, profilerSlot, AudioProfiler::directCopy);
+    
+    const int outputChannels = buffer.getNumChannels();
+    const int inputChannels = audioBuffer.getNumChannels();
+    const int totalSamples = audioBuffer.getNumSamples();
+    const int channelsToProcess = juce::jmin(outputChannels, inputChannels);
+    
+    // Determine loop bounds
+    double loopStart = 0.0;
+    double loopEnd = getDurationInSeconds();
+    
+    if (hasCustomLoopRegion && loopEndTime > loopStartTime)
+    {
+        loopStart = loopStartTime;
+        loopEnd = loopEndTime;
+    }
+    
+    int loopStartSample = juce::roundToInt(loopStart * sampleRate);
+    int loopEndSample = juce::jmin(juce::roundToInt(loopEnd * sampleRate), totalSamples);
+    int loopLengthSamples = loopEndSample - loopStartSample;
+    
+    if (loopLengthSamples <= 0)
+        return;
+    
+    int currentSample = static_cast<int>(currentPosition * sampleRate);
+    
+    // Handle looping within the defined region
+    if (looping)
+    {
+        if (currentSample < loopStartSample)
+        {
+            currentSample = loopStartSample;
+            currentPosition = loopStart;
+        }
+        else if (currentSample >= loopEndSample)
+        {
+            currentSample = loopStartSample + ((currentSample - loopStartSample) % loopLengthSamples);
+            currentPosition = currentSample / sampleRate;
+        }
+    }
+    else if (currentSample >= loopEndSample)
+    {
+        return; // Stop at end of loop region when not looping
+    }
+    
+    int samplesToRead = juce::jmin(numSamples, loopEndSample - currentSample);
+    if (samplesToRead <= 0)
+        return;
+    
+    for (int ch = 0; ch < channelsToProcess; ++ch)
+    {
+        buffer.addFrom(ch, startSample, audioBuffer, ch, currentSample, samplesToRead, volume);
+        levelMeter.addSamples(ch, audioBuffer.getReadPointer(ch, currentSample), samplesToRead, volume);
+    }
+    
+    if (inputChannels == 1 && outputChannels >= 2)
+    {
+        buffer.addFrom(1, startSample, audioBuffer, 0, currentSample, samplesToRead, volume);
+        levelMeter.addSamples(1, audioBuffer.getReadPointer(0, currentSample), samplesToRead, volume);
+    }
+    
+    currentPosition += (double)samplesToRead / sampleRate;
+    
+    // Loop back to start when reaching end of loop region
+    if (looping && currentPosition >= loopEnd)
+    {
+        currentPosition = loopStart;
+    }
+}
+
+void AudioTrack::processWithSoundTouch(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int outputChannels = buffer.getNumChannels();
+    const int inputChannels = audioBuffer.getNumChannels();
+    const int totalSamples = audioBuffer.getNumSamples();
+    const int channelsToProcess = juce::jmin(outputChannels, inputChannels);
+    
+    if (!soundTouch)
+        return;
+    
+    AudioProfiler::StageTimer timer(profiler, profilerSlot, AudioProfiler::soundTouchPut);
+    
+    soundTouch->setTempo(effectiveStretchRatio);
+    
+    // Determine loop bounds
+    double loopStart = 0.0;
+    double loopEnd = getDurationInSeconds();
+    
+    if (hasCustomLoopRegion && loopEndTime > loopStartTime)
+    {
+        loopStart = loopStartTime;
+        loopEnd = loopEndTime;
+    }
+    
+    int loopStartSample = juce::roundToInt(loopStart * sampleRate);
+    int loopEndSample = juce::jmin(juce::roundToInt(loopEnd * sampleRate), totalSamples);
+    int loopLengthSamples = loopEndSample - loopStartSample;
+    
+    if (loopLengthSamples <= 0)
+        return;
+    
+    int currentSample = static_cast<int>(currentPosition * sampleRate);
+    
+    // Handle looping within the defined region
+    if (looping)
+    {
+        if (currentSample < loopStartSample)
+        {
+            currentSample = loopStartSample;
+            currentPosition = loopStart;
+            soundTouch->clear();
+        }
+        else if (currentSample >= loopEndSample)
+        {
+            currentSample = loopStartSample + ((currentSample - loopStartSample) % loopLengthSamples);
+            currentPosition = currentSample / sampleRate;
+            soundTouch->clear();
+        }
+    }
+    else if (currentSample >= loopEndSample)
+    {
+        return; // Stop at end of loop region when not looping
+    }
+    
+    // Consume source at the tempo ratio so the position (and the tempo map lookup) tracks the output
+    int samplesToRead = juce::jmin((int)std::ceil(numSamples * effectiveStretchRatio), loopEndSample - currentSample);
+    if (samplesToRead <= 0)
+        return;
+    
+    if (inputChannels == 1)
+    {
+        soundTouch->putSamples(audioBuffer.getReadPointer(0, currentSample), samplesToRead);
+    }
+    else
+    {
+        // Only reallocates for a block larger than prepareToPlay() was told about
+        if (interleavedInput.getNumSamples() < samplesToRead * inputChannels)
+        {
+            interleavedInput.setSize(1, samplesToRead * inputChannels, false, false, true);
+            countScratchMemory();
+        }
+        
+        float* interleaved = interleavedInput.getWritePointer(0);
+        
+        for (int ch = 0; ch < inputChannels; ++ch)
+        {
+            const float* source = audioBuffer.getReadPointer(ch, currentSample);
+            
+            for (int sample = 0; sample < samplesToRead; ++sample)
+            {
+                interleaved[sample * inputChannels + ch] = source[sample];
+            }
+        }
+        
+        soundTouch->putSamples(interleaved, samplesToRead);
+    }
+    
+    timer.next(AudioProfiler::soundTouchReceive);
+    
+    // Frames come back interleaved into the first channel, so it must hold the whole block
+    if (stretchedBuffer.getNumSamples() < numSamples * inputChannels)
+    {
+        stretchedBuffer.setSize(1, numSamples * inputChannels, false, false, true);
+        countScratchMemory();
+    }
+    
+    uint32_t receivedSamples = soundTouch->receiveSamples(stretchedBuffer.getWritePointer(0), numSamples);
+    
+    // Frames fed in but not yet handed back, whether still to be stretched or waiting as output
+    backlogMemory.set((size_t)(soundTouch->numUnprocessedSamples() + soundTouch->numSamples())
+                      * (size_t)inputChannels * sizeof(float));
+    
+    if (receivedSamples > 0)
+    {
+        const int framesReceived = juce::jmin((int)receivedSamples, numSamples);
+        
+        if (inputChannels == 1)
+        {
+            for (int i = 0; i < framesReceived; ++i)
+            {
+                float sample = stretchedBuffer.getSample(0, i);
+                buffer.addSample(0, startSample + i, sample * volume);
+                
+                if (outputChannels >= 2)
+                {
+                    buffer.addSample(1, startSample + i, sample * volume);
+                }
+            }
+            
+            levelMeter.addSamples(0, stretchedBuffer.getReadPointer(0), framesReceived, volume);
+            
+            if (outputChannels >= 2)
+                levelMeter.addSamples(1, stretchedBuffer.getReadPointer(0), framesReceived, volume);
+        }
+        else
+        {
+            for (int i = 0; i < framesReceived; ++i)
+            {
+                for (int ch = 0; ch < channelsToProcess; ++ch)
+                {
+                    float sample = stretchedBuffer.getSample(0, i * inputChannels + ch);
+                    buffer.addSample(ch, startSample + i, sample * volume);
+                }
+            }
+            
+            levelMeter.addInterleaved(stretchedBuffer.getReadPointer(0), framesReceived, inputChannels, volume);
+        }
+    }
+    
+    currentPosition += (double)samplesToRead / sampleRate;
+    
+    // Loop back to start when reaching end of loop region
+    if (looping && currentPosition >= loopEnd)
+    {
+        currentPosition = loopStart;
+        soundTouch->clear(); // Clear SoundTouch buffer when looping
+    }
+}
+
+bool AudioTrack::LoopPass::usesSoundTouch() const
+{
+    // Matches processBlock, which plays near-unity ratios directly. A followed tempo map
+    // bends the ratio within the pass, so it always stretches.
+    return !tempoMap.isEmpty() || std::abs(stretchRatio - 1.0) >= 0.02;
+}
+
+double AudioTrack::LoopPass::getRatioAt(int sourceSample, double sourceSampleRate) const
+{
+    if (!tempoMap.isEmpty())
+        return juce::jlimit(0.25, 4.0, tempoMap.getWarpedRatioAt(sourceSample / sourceSampleRate, stretchRatio));
+    
+    return stretchRatio;
+}
+
+AudioTrack::LoopPass AudioTrack::getLoopPass(int blockSize) const
+{
+    juce::ScopedLock sl(lock);
+    
+    LoopPass pass;
+    pass.name = fileName;
+    pass.loadCount = loadCount;
+    pass.blockSize = juce::jmax(1, blockSize);
+    pass.stretchRatio = stretchRatio;
+    pass.gain = volume;
+    
+    if (tempoMapEnabled)
+        pass.tempoMap = tempoMap;
+    
+    // The bounds processBlock loops over
+    const int totalSamples = audioBuffer.getNumSamples();
+    const bool useRegion = hasCustomLoopRegion && loopEndTime > loopStartTime;
+    pass.startSample = useRegion ? juce::roundToInt(loopStartTime * sampleRate) : 0;
+    pass.endSample = useRegion ? juce::jmin(juce::roundToInt(loopEndTime * sampleRate), totalSamples) : totalSamples;
+    
+    if (!pass.usesSoundTouch())
+    {
+        pass.lengthInSamples = juce::jmax(0, pass.endSample - pass.startSample);
+        return pass;
+    }
+    
+    // The same chunks renderLoopPass feeds SoundTouch, each over its own ratio
+    double length = 0.0;
+    
+    for (int position = pass.startSample; position < pass.endSample;)
+    {
+        const double ratio = pass.getRatioAt(position, sampleRate);
+        const int count = juce::jmin((int)std::ceil(pass.blockSize * ratio), pass.endSample - position);
+        length += count / ratio;
+        position += count;
+    }
+    
+    pass.lengthInSamples = (juce::int64)std::llround(length);
+    return pass;
+}
+
+juce::Result AudioTrack::renderLoopPass(const LoopPass& pass, int numOutputChannels,
+                                        const std::function<juce::Result(const juce::AudioBuffer<float>&, int)>& writeBlock)
+{
+    TraceRecorder::Scope trace("renderLoopPass", "render");
+    
+    const int blockSize = pass.blockSize;
+    const int startSample = pass.startSample;
+    const int endSample = pass.endSample;
+    const float gain = pass.gain;
+    const juce::Result reloaded = juce::Result::fail(pass.name + " was reloaded during the export");
+    int inputChannels = 0;
+    double sourceSampleRate = 0.0;
+    
+    {
+        juce::ScopedLock sl(lock);
+        
+        if (loadingFile || loadCount != pass.loadCount)
+            return reloaded;
+        
+        inputChannels = audioBuffer.getNumChannels();
+        sourceSampleRate = sampleRate;
+    }
+    
+    if (inputChannels <= 0 || numOutputChannels <= 0 || blockSize <= 0)
+        return juce::Result::ok();
+    
+    // Mono sources go to both sides, as in playback
+    auto sourceChannelFor = [inputChannels](int outputChannel)
+    {
+        return inputChannels == 1 && outputChannel == 1 ? 0 : outputChannel;
+    };
+    
+    juce::AudioBuffer<float> output(numOutputChannels, blockSize);
+    
+    if (!pass.usesSoundTouch())
+    {
+        for (int position = startSample; position < endSample; position += blockSize)
+        {
+            const int numSamples = juce::jmin(blockSize, endSample - position);
+            output.clear();
+            
+            {
+                juce::ScopedLock sl(lock);
+                
+                if (loadingFile || loadCount != pass.loadCount)
+                    return reloaded;
+                
+                for (int ch = 0; ch < numOutputChannels; ++ch)
+                {
+                    if (sourceChannelFor(ch) < inputChannels)
+                        output.copyFrom(ch, 0, audioBuffer.getReadPointer(sourceChannelFor(ch), position), numSamples, gain);
+                }
+            }
+            
+            juce::Result result = writeBlock(output, numSamples);
+            
+            if (result.failed())
+                return result;
+        }
+        
+        return juce::Result::ok();
+    }
+    
+    soundtouch::SoundTouch stretcher;
+    stretcher.setSampleRate((uint32_t)sourceSampleRate);
+    stretcher.setChannels((uint32_t)inputChannels);
+    stretcher.setPitch(1.0);
+    
+    // A chunk is at most four blocks of source, at the fastest ratio
+    std::vector<float> interleaved((size_t)blockSize * 4 * (size_t)inputChannels);
+    std::vector<float> received((size_t)blockSize * (size_t)inputChannels);
+    double targetLength = 0.0;
+    juce::int64 written = 0;
+    int filled = 0;
+    output.clear();
+    
+    auto writeOutput = [&]() -> juce::Result
+    {
+        juce::Result result = writeBlock(output, filled);
+        output.clear();
+        filled = 0;
+        return result;
+    };
+    
+    // Takes whatever SoundTouch has ready, up to the length fed so far. Nothing is
+    // skipped at the start, so the latency never reaches the file as silence.
+    auto collect = [&]() -> juce::Result
+    {
+        for (;;)
+        {
+            const int numReceived = (int)stretcher.receiveSamples(received.data(), (uint32_t)(blockSize - filled));
+            
+            if (numReceived <= 0)
+                return juce::Result::ok();
+            
+            const int numToKeep = (int)juce::jlimit((juce::int64)0, (juce::int64)numReceived,
+                                                    (juce::int64)std::llround(targetLength) - written);
+            
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+            {
+                const int sourceChannel = sourceChannelFor(ch);
+                
+                if (sourceChannel >= inputChannels)
+                    continue;
+                
+                float* destination = output.getWritePointer(ch, filled);
+                
+                for (int i = 0; i < numToKeep; ++i)
+                    destination[i] = received[(size_t)(i * inputChannels + sourceChannel)] * gain;
+            }
+            
+            filled += numToKeep;
+            written += numToKeep;
+            
+            if (filled == blockSize)
+            {
+                juce::Result result = writeOutput();
+                
+                if (result.failed())
+                    return result;
+            }
+        }
+    };
+    
+    for (int position = startSample; position < endSample;)
+    {
+        double ratio = 1.0;
+        int count = 0;
+        
+        {
+            juce::ScopedLock sl(lock);
+            
+            if (loadingFile || loadCount != pass.loadCount)
+                return reloaded;
+            
+            ratio = pass.getRatioAt(position, sourceSampleRate);
+            count = juce::jmin((int)std::ceil(blockSize * ratio), endSample - position);
+            
+            for (int ch = 0; ch < inputChannels; ++ch)
+            {
+                const float* source = audioBuffer.getReadPointer(ch, position);
+                
+                for (int i = 0; i < count; ++i)
+                    interleaved[(size_t)(i * inputChannels + ch)] = source[i];
+            }
+        }
+        
+        stretcher.setTempo(ratio);
+        stretcher.putSamples(interleaved.data(), (uint32_t)count);
+        targetLength += count / ratio;
+        position += count;
+        
+        juce::Result result = collect();
+        
+        if (result.failed())
+            return result;
+    }
+    
+    // The tail still inside SoundTouch; flush() pads it with silence, which the target trims
+    stretcher.flush();
+    juce::Result result = collect();
+    
+    if (result.failed())
+        return result;
+    
+    // Should the flush come up short, the pass still gets its full length
+    const juce::int64 target = (juce::int64)std::llround(targetLength);
+    
+    while (written < target)
+    {
+        const int numSilent = (int)juce::jmin((juce::int64)(blockSize - filled), target - written);
+        filled += numSilent;
+        written += numSilent;
+        
+        if (filled == blockSize)
+        {
+            result = writeOutput();
+            
+            if (result.failed())
+                return result;
+        }
+    }
+    
+    return filled > 0 ? writeOutput() : juce::Result::ok();
+}
+
+juce::String AudioTrack::getFileName() const
+{
+    juce::ScopedLock sl(lock);
+    return fileName;
+}
+
+double AudioTrack::getDurationInSeconds() const
+{
+    if (audioBuffer.getNumSamples() > 0 && sampleRate > 0)
+        return audioBuffer.getNumSamples() / sampleRate;
+    return 0.0;
+}
+
+void AudioTrack::setLoopRegion(double startTime, double endTime)
+{
+    juce::ScopedLock sl(lock);
+    
+    // Loop points on rising zero crossings, so the wrap doesn't click
+    if (snapIndex != nullptr)
+    {
+        startTime = snapIndex->snapToZeroCrossing(startTime, loopSnapDistance);
+        endTime = juce::jmin(snapIndex->snapToZeroCrossing(endTime, loopSnapDistance), getDurationInSeconds());
+    }
+    
+    if (startTime >= 0.0 && endTime > startTime && endTime <= getDurationInSeconds())
+    {
+        loopStartTime = startTime;
+        loopEndTime = endTime;
+        hasCustomLoopRegion = true;
+        
+        // Set position to loop start if currently outside the loop region
+        if (currentPosition < loopStartTime || currentPosition > loopEndTime)
+        {
+            currentPosition = loopStartTime;
+        }
+        
+        publishState();
+        juce::Logger::writeToLog("Loop region set: " + juce::String(startTime, 2) + "s - " + juce::String(endTime, 2) + "s | Duration: " + juce::String(endTime - startTime, 2) + "s");
+    }
+}
+
+void AudioTrack::clearLoopRegion()
+{
+    juce::ScopedLock sl(lock);
+    
+    hasCustomLoopRegion = false;
+    loopStartTime = 0.0;
+    loopEndTime = 0.0;
+    
+    // Reset position to beginning of full track if we were inside a custom loop
+    if (currentPosition > getDurationInSeconds())
+    {
+        currentPosition = 0.0;
+    }
+    
+    publishState();
+    juce::Logger::writeToLog("Loop region cleared - now looping full track (" + juce::String(getDurationInSeconds(), 1) + "s)");
+}
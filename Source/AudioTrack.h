@@ -0,0 +1,230 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <soundtouch/SoundTouch.h>
+#include "TempoAnalysis.h"
+#include "WaveformPeaks.h"
+#include "LockFreeSnapshot.h"
+#include "LevelMeter.h"
+#include "Spectrogram.h"
+#include "SnapIndex.h"
+#include "AudioProfiler.h"
+#include "MemoryAccounting.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+// One loop: decodes a file, analyses its tempo and transients, and renders it stretched
+// to the master tempo. Needs no GUI modules, so it builds into the headless engine.
+class AudioTrack
+{
+public:
+    // Everything the UI shows about a track, republished whenever any of it changes
+    struct State
+    {
+        double position = 0.0;
+        double stretchRatio = 1.0;
+        double effectiveStretchRatio = 1.0;
+        double detectedBPM = 0.0;
+        double durationInSeconds = 0.0;
+        double loopStart = 0.0;         // Meaningful when hasLoopRegion
+        double loopEnd = 0.0;
+        float volume = 1.0f;
+        int loadCount = 0;              // Bumped each time a file finishes loading
+        bool loaded = false;
+        bool muted = false;
+        bool solo = false;
+        bool looping = true;
+        bool tempoMapEnabled = false;
+        bool hasTempoMap = false;
+        bool hasLoopRegion = false;
+    };
+    
+    AudioTrack();
+    ~AudioTrack();
+    
+    void loadAudioFile(const juce::File& file);
+    void loadAudioFileAsync(const juce::File& file, std::function<void()> onLoaded);
+    void setStretchRatio(double ratio);
+    void scaleStretchRatio(double scaleFactor);
+    void setPosition(double positionInSeconds);
+    void setTransportPosition(double transportSeconds);
+    void reset();
+    void setMasterBPM(double masterBPM);
+    void setManualBPM(double bpm);
+    
+    void processBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    
+    // Everything one exported pass of the loop region depends on, taken in one go under
+    // the lock, so loop, tempo or volume edits made while it renders don't reach it
+    struct LoopPass
+    {
+        juce::String name;
+        int loadCount = 0;
+        int blockSize = 0;
+        int startSample = 0;
+        int endSample = 0;
+        double stretchRatio = 1.0;
+        TempoMap tempoMap;              // Empty unless the track follows one
+        float gain = 1.0f;
+        juce::int64 lengthInSamples = 0; // Each block's source over its own ratio
+        
+        bool usesSoundTouch() const;
+        double getRatioAt(int sourceSample, double sourceSampleRate) const;
+    };
+    
+    LoopPass getLoopPass(int blockSize) const;
+    
+    // Renders a pass on a SoundTouch of its own. Output is collected as SoundTouch
+    // produces it, so its latency never becomes leading silence, and the tail is flushed
+    // out at the end: the pass starts on the loop start and is lengthInSamples long.
+    // Source audio is read under the lock a block at a time; a reload ends the pass.
+    // Blocks go to writeBlock, and a failure it returns stops the pass.
+    juce::Result renderLoopPass(const LoopPass& pass, int numOutputChannels,
+                                const std::function<juce::Result(const juce::AudioBuffer<float>&, int)>& writeBlock);
+    
+    // Sizes the scratch buffers for blocks of up to this many samples, so processBlock
+    // doesn't allocate. They only grow, so an offline render can't undo the live setting.
+    void prepareToPlay(int maxBlockSize);
+    
+    bool isLoaded() const { return audioBuffer.getNumSamples() > 0; }
+    double getDurationInSeconds() const;
+    double getCurrentPosition() const { return currentPosition; }
+    double getStretchRatio() const { return stretchRatio; }
+    double getEffectiveStretchRatio() const { return effectiveStretchRatio; }
+    juce::String getFileName() const; // A copy taken under the lock, as loads reassign it
+    double getDetectedBPM() const { return detectedBPM; }
+    double getBPMConfidence() const { return bpmConfidence; }   // 0..1, 0 when a fallback picked the tempo
+    std::shared_ptr<const WaveformPeaks> getWaveformPeaks() const;
+    std::shared_ptr<const Spectrogram> getSpectrogram() const;
+    std::shared_ptr<const SnapIndex> getSnapIndex() const;
+    std::vector<TempoCandidate> getTempoCandidates() const;
+    std::vector<float> getOnsetEnvelope() const;
+    double getSampleRate() const { return sampleRate; }
+    
+    // The decoded file. Only valid while no load is in progress.
+    const juce::AudioBuffer<float>& getAudioBuffer() const { return audioBuffer; }
+    
+    // Levels of what this track adds to the mix, filled in by processBlock
+    LevelMeter& getLevelMeter() { return levelMeter; }
+    
+    // processBlock reports its stages to the profiler under this slot. Set before playback starts.
+    void setProfiler(AudioProfiler* profilerToUse, int slot) { profiler = profilerToUse; profilerSlot = slot; }
+    
+    // Progress of a background load, with the tempo estimate refined as blocks decode
+    bool isLoadingFile() const { return loadingFile.load(); }
+    double getLoadProgress() const { return loadProgress.load(); }
+    double getProvisionalBPM() const { return tempoEstimator.getBPM(); }
+    double getProvisionalConfidence() const { return tempoEstimator.getConfidence(); }
+    
+    void setMuted(bool shouldBeMuted);
+    void setSolo(bool shouldBeSolo);
+    void setVolume(float newVolume);
+    void setLooping(bool shouldLoop);
+    void autoSyncToMaster();
+    
+    // Lock-free view of the track for the UI; the version changes with every publish
+    juce::uint32 readState(State& destination) const { return state.read(destination); }
+    juce::uint32 getStateVersion() const { return state.getVersion(); }
+    
+    // Tempo map (drift following for live recordings)
+    void setTempoMapEnabled(bool shouldFollow);
+    bool isTempoMapEnabled() const { return tempoMapEnabled; }
+    bool hasTempoMap() const { return !tempoMap.isEmpty(); }
+    
+    // Phase against the transport: where in the playback range this track is at transport zero
+    void setStartOffset(double offsetInSeconds);
+    double getStartOffset() const { return startOffset; }
+    double transportToSourcePosition(double transportSeconds) const;
+    
+    // Selection-based looping
+    void setLoopRegion(double startTime, double endTime);
+    void clearLoopRegion();
+    bool hasLoopRegion() const { return hasCustomLoopRegion; }
+    double getLoopStart() const { return loopStartTime; }
+    double getLoopEnd() const { return loopEndTime; }
+    
+    bool isMuted() const { return muted; }
+    bool isSolo() const { return solo; }
+    float getVolume() const { return volume; }
+    bool isLooping() const { return looping; }
+
+private:
+    class LoaderThread;
+    
+    juce::AudioBuffer<float> audioBuffer;
+    std::unique_ptr<soundtouch::SoundTouch> soundTouch;
+    juce::AudioFormatManager formatManager;
+    std::shared_ptr<const WaveformPeaks> waveformPeaks;
+    std::shared_ptr<const Spectrogram> spectrogram;
+    std::shared_ptr<const SnapIndex> snapIndex;
+    juce::AudioBuffer<float> stretchedBuffer;
+    juce::AudioBuffer<float> interleavedInput;
+    std::vector<float> onsetEnvelope;
+    std::vector<TempoCandidate> tempoCandidates;
+    TempoMap tempoMap;
+    StreamingTempoEstimator tempoEstimator;
+    std::unique_ptr<LoaderThread> loaderThread;
+    
+    double sampleRate;
+    double currentPosition;
+    double stretchRatio;
+    double effectiveStretchRatio;
+    double detectedBPM;
+    double bpmConfidence;
+    double masterBPM;
+    double startOffset;
+    juce::String fileName;
+    int preparedBlockSize;
+    
+    bool muted;
+    bool solo;
+    bool looping;
+    bool tempoMapEnabled;
+    float volume;
+    
+    // Loop region selection
+    bool hasCustomLoopRegion;
+    double loopStartTime;
+    double loopEndTime;
+    
+    // Background load state, polled by the UI
+    std::atomic<bool> loadingFile;
+    std::atomic<double> loadProgress;
+    int loadCount;
+    
+    LockFreeSnapshot<State> state;
+    LevelMeter levelMeter;
+    AudioProfiler* profiler;
+    int profilerSlot;
+    juce::CriticalSection lock;
+    
+    MemoryAccounting::Allocation decodedMemory;
+    MemoryAccounting::Allocation scratchMemory;
+    MemoryAccounting::Allocation backlogMemory;    // Only touched by the audio thread
+    
+    // Below these confidences the next detector in the chain is consulted
+    static constexpr int maxTempoCandidates = 5;
+    static constexpr double minimumCandidateConfidence = 0.15;
+    static constexpr double minimumStreamingConfidence = 0.6;
+    static constexpr double loopSnapDistance = 0.005;  // Seconds either side of a requested loop point
+    
+    // Improved BPM detection methods
+    double detectBPMImproved();
+    double detectBPMAutocorrelation();
+    double detectBPMFromOnsets(const std::vector<float>& onsets);
+    std::vector<double> detectOnsetTimes(const std::vector<float>& onsets);
+    std::vector<float> analyseSpectrum();
+    void buildSnapIndex(const std::vector<float>& onsets);
+    static TempoMap buildTempoMap(const std::vector<float>& onsets, double bpm, double sourceSampleRate,
+                                  const juce::String& name);
+    
+    void generateWaveformPeaks();
+    void publishState(); // Call with the lock held
+    void processDirectPlayback(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void processWithSoundTouch(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void initializeSoundTouch();
+    void allocateScratchBuffers();
+    void countScratchMemory();
+};
@@ -0,0 +1,170 @@
+#include "LevelMeter.h"
+#include <cmath>
+
+namespace
+{
+    // Peak and sum of squares per channel of interleaved values. Once the data is aligned
+    // and at a frame boundary, each register holds whole frames, so lane % numChannels is
+    // the channel of every value that lane sees.
+    void measure(const float* samples, int numValues, int numChannels, float* peaks, double* sumsOfSquares) noexcept
+    {
+        using Vector = juce::dsp::SIMDRegister<float>;
+        constexpr int lanes = (int)Vector::SIMDNumElements;
+
+        int i = 0;
+
+        auto measureScalar = [&](int end)
+        {
+            for (; i < end; ++i)
+            {
+                const float value = samples[i];
+                const int channel = i % numChannels;
+                peaks[channel] = juce::jmax(peaks[channel], std::abs(value));
+                sumsOfSquares[channel] += (double)value * value;
+            }
+        };
+
+        if (lanes % numChannels == 0)
+        {
+            while (i < numValues && (!Vector::isSIMDAligned(samples + i) || i % numChannels != 0))
+                measureScalar(i + 1);
+
+            if (numValues - i >= lanes)
+            {
+                Vector lowest = Vector::expand(0.0f);
+                Vector highest = Vector::expand(0.0f);
+                Vector squares = Vector::expand(0.0f);
+
+                for (; i + lanes <= numValues; i += lanes)
+                {
+                    Vector values = Vector::fromRawArray(samples + i);
+                    lowest = Vector::min(lowest, values);
+                    highest = Vector::max(highest, values);
+                    squares += values * values;
+                }
+
+                for (size_t lane = 0; lane < (size_t)lanes; ++lane)
+                {
+                    const int channel = (int)lane % numChannels;
+                    peaks[channel] = juce::jmax(peaks[channel], -lowest.get(lane), highest.get(lane));
+                    sumsOfSquares[channel] += squares.get(lane);
+                }
+            }
+        }
+
+        measureScalar(numValues);
+    }
+}
+
+LevelMeter::LevelMeter()
+    : totals(),
+      blockStarted(false),
+      publishedVersion(snapshot.getVersion()),
+      lastReadVersion(snapshot.getVersion())
+{
+}
+
+void LevelMeter::startBlock() noexcept
+{
+    blockStarted = true;
+
+    juce::uint32 unreadSamples = 0;
+    for (int channel = 0; channel < maxChannels; ++channel)
+        unreadSamples = juce::jmax(unreadSamples, totals.numSamples[channel]);
+
+    // The reader has seen everything published, so anything new is a fresh interval
+    if (acknowledgedVersion.load(std::memory_order_acquire) == publishedVersion || unreadSamples > maxUnreadSamples)
+        totals = Totals();
+}
+
+void LevelMeter::addSamples(int channel, const float* samples, int numSamples, float gain) noexcept
+{
+    if (channel < 0 || channel >= maxChannels || samples == nullptr || numSamples <= 0)
+        return;
+
+    if (!blockStarted)
+        startBlock();
+
+    float peak = 0.0f;
+    double sumOfSquares = 0.0;
+    measure(samples, numSamples, 1, &peak, &sumOfSquares);
+
+    totals.peak[channel] = juce::jmax(totals.peak[channel], peak * std::abs(gain));
+    totals.sumOfSquares[channel] += sumOfSquares * gain * gain;
+    totals.numSamples[channel] += (juce::uint32)numSamples;
+    totals.numChannels = juce::jmax(totals.numChannels, channel + 1);
+}
+
+void LevelMeter::addInterleaved(const float* samples, int numFrames, int numChannels, float gain) noexcept
+{
+    if (samples == nullptr || numFrames <= 0 || numChannels <= 0)
+        return;
+
+    if (!blockStarted)
+        startBlock();
+
+    float peaks[maxChannels] = {};
+    double sumsOfSquares[maxChannels] = {};
+    const int channelsToMeasure = juce::jmin(numChannels, maxChannels);
+
+    if (numChannels <= maxChannels)
+    {
+        measure(samples, numFrames * numChannels, numChannels, peaks, sumsOfSquares);
+    }
+    else
+    {
+        // More channels than we show; only the first ones count
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            for (int channel = 0; channel < channelsToMeasure; ++channel)
+            {
+                const float value = samples[frame * numChannels + channel];
+                peaks[channel] = juce::jmax(peaks[channel], std::abs(value));
+                sumsOfSquares[channel] += (double)value * value;
+            }
+        }
+    }
+
+    for (int channel = 0; channel < channelsToMeasure; ++channel)
+    {
+        totals.peak[channel] = juce::jmax(totals.peak[channel], peaks[channel] * std::abs(gain));
+        totals.sumOfSquares[channel] += sumsOfSquares[channel] * gain * gain;
+        totals.numSamples[channel] += (juce::uint32)numFrames;
+    }
+
+    totals.numChannels = juce::jmax(totals.numChannels, channelsToMeasure);
+}
+
+void LevelMeter::publish() noexcept
+{
+    if (!blockStarted)
+        return;
+
+    snapshot.publish(totals);
+    publishedVersion = snapshot.getVersion();
+    blockStarted = false;
+}
+
+bool LevelMeter::getLevels(Levels& levels) noexcept
+{
+    Totals published;
+    const juce::uint32 version = snapshot.read(published);
+
+    if (version == lastReadVersion)
+        return false;
+
+    lastReadVersion = version;
+    acknowledgedVersion.store(version, std::memory_order_release);
+
+    levels.numChannels = published.numChannels;
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        levels.peak[channel] = published.peak[channel];
+        levels.rms[channel] = published.numSamples[channel] > 0
+                                  ? (float)std::sqrt(published.sumOfSquares[channel] / published.numSamples[channel])
+                                  : 0.0f;
+    }
+
+    return true;
+}
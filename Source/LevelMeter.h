@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeSnapshot.h"
+#include <atomic>
+
+// Peak and RMS of an audio stream, measured on the audio thread and read by the UI.
+// The audio thread folds each block into running totals with SIMD and publishes them
+// through a LockFreeSnapshot. The totals keep growing until the UI acknowledges a
+// reading, so a single-sample over between two display frames is never lost. Neither
+// side ever waits for the other.
+class LevelMeter
+{
+public:
+    static constexpr int maxChannels = 2;
+
+    struct Levels
+    {
+        float peak[maxChannels] = {};     // Linear gain
+        float rms[maxChannels] = {};
+        int numChannels = 0;
+    };
+
+    LevelMeter();
+
+    // Audio thread: fold in one channel's samples, scaled by gain
+    void addSamples(int channel, const float* samples, int numSamples, float gain = 1.0f) noexcept;
+
+    // Audio thread: fold in interleaved frames, one channel per slot
+    void addInterleaved(const float* samples, int numFrames, int numChannels, float gain = 1.0f) noexcept;
+
+    // Audio thread: make everything added so far visible to the reader
+    void publish() noexcept;
+
+    // Message thread: levels of everything measured since the last call. Returns false
+    // when nothing new was published, e.g. while stopped or muted.
+    bool getLevels(Levels& levels) noexcept;
+
+private:
+    struct Totals
+    {
+        float peak[maxChannels];
+        double sumOfSquares[maxChannels];
+        juce::uint32 numSamples[maxChannels];
+        int numChannels;
+    };
+
+    // Start afresh after this much unread audio, so a meter nobody looks at stays current
+    static constexpr juce::uint32 maxUnreadSamples = 1 << 16;
+
+    LockFreeSnapshot<Totals> snapshot;
+    std::atomic<juce::uint32> acknowledgedVersion { 0 };
+
+    Totals totals;                          // Audio thread only
+    bool blockStarted;                      // Audio thread only
+    juce::uint32 publishedVersion;          // Audio thread only
+    juce::uint32 lastReadVersion;           // Message thread only
+
+    void startBlock() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeter)
+};
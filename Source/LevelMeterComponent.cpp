@@ -0,0 +1,157 @@
+#include "LevelMeterComponent.h"
+#include <algorithm>
+#include <cmath>
+
+LevelMeterComponent::LevelMeterComponent()
+    : meter(nullptr),
+      numChannels(0),
+      clipped(false),
+      lastRefreshTime(juce::Time::getMillisecondCounterHiRes() * 0.001),
+      shownClipped(false)
+{
+    std::fill(std::begin(shownPositions), std::end(shownPositions), -1);
+    setOpaque(true);
+}
+
+void LevelMeterComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff1a1a1a));
+
+    juce::Rectangle<int> area = getBarArea();
+    const int channels = juce::jmax(1, numChannels);
+    const int barHeight = juce::jmax(1, (area.getHeight() - (channels - 1)) / channels);
+
+    int positions[LevelMeter::maxChannels * 3];
+    computePositions(positions);
+
+    for (int channel = 0; channel < channels; ++channel)
+    {
+        juce::Rectangle<int> barArea = area.removeFromTop(barHeight);
+        area.removeFromTop(1);
+
+        g.setColour(juce::Colours::black);
+        g.fillRect(barArea);
+
+        if (channel >= numChannels)
+            continue;
+
+        const int peakEnd = positions[channel * 3];
+        const int rmsEnd = positions[channel * 3 + 1];
+        const int holdPosition = positions[channel * 3 + 2];
+        const float rmsDecibels = bars[channel].rmsDecibels;
+
+        g.setColour(juce::Colours::green.withAlpha(0.35f));
+        g.fillRect(barArea.withWidth(peakEnd));
+
+        g.setColour(rmsDecibels > -3.0f ? juce::Colours::red
+                    : rmsDecibels > -12.0f ? juce::Colours::yellow
+                    : juce::Colours::green);
+        g.fillRect(barArea.withWidth(rmsEnd));
+
+        if (holdPosition > 0)
+        {
+            g.setColour(juce::Colours::white);
+            g.fillRect(barArea.getX() + holdPosition - 1, barArea.getY(), 2, barArea.getHeight());
+        }
+    }
+
+    // Clip light at the right end
+    g.setColour(clipped ? juce::Colours::red : juce::Colours::darkgrey.darker());
+    g.fillRect(getLocalBounds().removeFromRight(6).reduced(0, 1));
+}
+
+void LevelMeterComponent::mouseDown(const juce::MouseEvent& event)
+{
+    juce::ignoreUnused(event);
+
+    clipped = false;
+    shownClipped = false;
+    repaint();
+}
+
+void LevelMeterComponent::setMeter(LevelMeter* meterToShow)
+{
+    meter = meterToShow;
+    numChannels = 0;
+    clipped = false;
+    shownClipped = false;
+
+    for (auto& bar : bars)
+        bar = Bar();
+
+    repaint();
+}
+
+void LevelMeterComponent::refresh(bool audioFlowing)
+{
+    const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    const float elapsed = (float)juce::jlimit(0.0, 1.0, now - lastRefreshTime);
+    lastRefreshTime = now;
+
+    LevelMeter::Levels levels;
+    const bool hasLevels = meter != nullptr && meter->getLevels(levels);
+
+    if (hasLevels)
+        numChannels = levels.numChannels;
+    else if (audioFlowing)
+        return; // No block since the last frame; it isn't silence
+
+    // RMS settles over about 300 ms, like a VU needle
+    const float rmsSmoothing = 1.0f - std::exp(-elapsed / 0.3f);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        Bar& bar = bars[channel];
+        const float peak = hasLevels ? levels.peak[channel] : 0.0f;
+        const float rms = hasLevels ? levels.rms[channel] : 0.0f;
+        const float peakDecibels = juce::Decibels::gainToDecibels(peak, minimumDecibels);
+        const float rmsDecibels = juce::Decibels::gainToDecibels(rms, minimumDecibels);
+
+        if (peak >= 1.0f)
+            clipped = true;
+
+        bar.peakDecibels = juce::jmax(peakDecibels, bar.peakDecibels - fallDecibelsPerSecond * elapsed);
+        bar.rmsDecibels += (rmsDecibels - bar.rmsDecibels) * rmsSmoothing;
+
+        if (peakDecibels >= bar.holdDecibels || now - bar.holdTime > holdSeconds)
+        {
+            bar.holdDecibels = peakDecibels;
+            bar.holdTime = now;
+        }
+    }
+
+    int positions[LevelMeter::maxChannels * 3];
+    computePositions(positions);
+
+    if (!std::equal(std::begin(positions), std::end(positions), std::begin(shownPositions)) || clipped != shownClipped)
+    {
+        std::copy(std::begin(positions), std::end(positions), std::begin(shownPositions));
+        shownClipped = clipped;
+        repaint();
+    }
+}
+
+juce::Rectangle<int> LevelMeterComponent::getBarArea() const
+{
+    return getLocalBounds().withTrimmedRight(8).reduced(0, 1);
+}
+
+int LevelMeterComponent::getPosition(float decibels, int width) const
+{
+    const float proportion = (decibels - minimumDecibels) / -minimumDecibels;
+    return juce::jlimit(0, width, juce::roundToInt(proportion * width));
+}
+
+void LevelMeterComponent::computePositions(int* positions) const
+{
+    const int width = getBarArea().getWidth();
+
+    for (int channel = 0; channel < LevelMeter::maxChannels; ++channel)
+    {
+        const bool shown = channel < numChannels;
+        positions[channel * 3] = shown ? getPosition(bars[channel].peakDecibels, width) : 0;
+        positions[channel * 3 + 1] = shown ? getPosition(bars[channel].rmsDecibels, width) : 0;
+        positions[channel * 3 + 2] = shown && bars[channel].holdDecibels > minimumDecibels
+                                         ? getPosition(bars[channel].holdDecibels, width) : 0;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+
+// Horizontal peak and RMS bars for a LevelMeter, one per channel. The owner calls
+// refresh() at display rate. Bars fall back smoothly, a peak hold line lingers, and the
+// clip light stays on until clicked.
+//
+// With large audio buffers many display frames see no new block. The owner says whether
+// audio is still flowing: while it is, such a frame holds the last levels; once the
+// transport stops or the track is muted, the bars fall back to silence.
+class LevelMeterComponent : public juce::Component
+{
+public:
+    LevelMeterComponent();
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+
+    void setMeter(LevelMeter* meterToShow);
+    void refresh(bool audioFlowing);
+
+private:
+    struct Bar
+    {
+        float peakDecibels = minimumDecibels;
+        float rmsDecibels = minimumDecibels;
+        float holdDecibels = minimumDecibels;
+        double holdTime = 0.0;
+    };
+
+    static constexpr float minimumDecibels = -60.0f;
+    static constexpr float fallDecibelsPerSecond = 24.0f;
+    static constexpr double holdSeconds = 1.5;
+
+    LevelMeter* meter;
+    Bar bars[LevelMeter::maxChannels];
+    int numChannels;
+    bool clipped;
+    double lastRefreshTime;
+
+    // What was last painted, so refresh() only repaints when a pixel would change
+    int shownPositions[LevelMeter::maxChannels * 3];
+    bool shownClipped;
+
+    juce::Rectangle<int> getBarArea() const;
+    int getPosition(float decibels, int width) const;
+    void computePositions(int* positions) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeterComponent)
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// A value published by one thread at a time and read by any thread without locking.
+// The payload lives in atomic words guarded by a sequence counter: readers retry if a
+// write overlapped their copy. The counter doubles as a version number, so readers can
+// cheaply tell whether anything changed since they last looked.
+template <typename ValueType>
+class LockFreeSnapshot
+{
+public:
+    static_assert(std::is_trivially_copyable<ValueType>::value, "Snapshots are copied word by word");
+
+    LockFreeSnapshot()
+    {
+        publish(ValueType());
+    }
+
+    // Concurrent writers must be serialised by the caller
+    void publish(const ValueType& value) noexcept
+    {
+        std::array<juce::uint64, numWords> words {};
+        std::memcpy(words.data(), &value, sizeof(ValueType));
+
+        const juce::uint32 sequence = sequenceNumber.load(std::memory_order_relaxed);
+        sequenceNumber.store(sequence + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < numWords; ++i)
+            storage[i].store(words[i], std::memory_order_relaxed);
+
+        sequenceNumber.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Copies the latest value and returns its version
+    juce::uint32 read(ValueType& destination) const noexcept
+    {
+        std::array<juce::uint64, numWords> words {};
+
+        for (;;)
+        {
+            const juce::uint32 before = sequenceNumber.load(std::memory_order_acquire);
+
+            if ((before & 1) != 0)
+                continue;
+
+            for (size_t i = 0; i < numWords; ++i)
+                words[i] = storage[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequenceNumber.load(std::memory_order_relaxed) == before)
+            {
+                std::memcpy(static_cast<void*>(&destination), words.data(), sizeof(ValueType));
+                return before / 2;
+            }
+        }
+    }
+
+    juce::uint32 getVersion() const noexcept
+    {
+        return sequenceNumber.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t numWords = (sizeof(ValueType) + sizeof(juce::uint64) - 1) / sizeof(juce::uint64);
+
+    std::array<std::atomic<juce::uint64>, numWords> storage {};
+    std::atomic<juce::uint32> sequenceNumber { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(LockFreeSnapshot)
+};
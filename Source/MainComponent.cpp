@@ -1,4 +1,5 @@
 #include "MainComponent.h"
+#include "TraceRecorder.h"
 #include <algorithm>
 #include <cmath>
 
@@ -21,6 +22,7 @@ WaveformComponent::WaveformComponent()
       isDraggingGrid(false),
       initialMouseX(0.0),
       initialGridTime(0.0),
+      draggedGridTime(0.0),
       currentCursor(juce::MouseCursor::NormalCursor),
       isDraggingWaveform(false),
       initialViewStartTime(0.0),
@@ -32,18 +34,110 @@ WaveformComponent::WaveformComponent()
       selectionStartX(0.0),
       isResizingSelectionStart(false),
       isResizingSelectionEnd(false),
-      fixedSelectionBound(0.0)
+      fixedSelectionBound(0.0),
+      staticLayerValid(false),
+      staticLayerScale(1.0f),
+      notifiedStartTime(-1.0),
+      notifiedEndTime(-1.0),
+      imageMemory(MemoryAccounting::waveformImages)
 {
     setMouseCursor(juce::MouseCursor::NormalCursor);
+    setOpaque(true); // The static layer covers every pixel, so parents never repaint under us
 }
 
 WaveformComponent::~WaveformComponent()
 {
+    renderer->cancelRequests(this);
     onPositionChanged = nullptr;
     onBPMChanged = nullptr;
+    onVisibleRangeChanged = nullptr;
+    onWaveformTileRendered = nullptr;
 }
 
 void WaveformComponent::paint(juce::Graphics& g)
+{
+    // Everything but the playhead comes from the cached raster, so playhead-only
+    // repaints are a blit of a few columns
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const int imageWidth = juce::roundToInt(getWidth() * scale);
+    const int imageHeight = juce::roundToInt(getHeight() * scale);
+    
+    if (!staticLayerValid || staticLayer.getWidth() != imageWidth || staticLayer.getHeight() != imageHeight)
+        renderStaticLayer(imageWidth, imageHeight, scale);
+    
+    if (staticLayer.isValid())
+        g.drawImage(staticLayer, getLocalBounds().toFloat());
+    
+    drawPlayhead(g, getLocalBounds().reduced(2));
+}
+
+void WaveformComponent::renderStaticLayer(int imageWidth, int imageHeight, float scale)
+{
+    staticLayerValid = true;
+    
+    if (imageWidth <= 0 || imageHeight <= 0)
+    {
+        staticLayer = {};
+        countImageMemory();
+        return;
+    }
+    
+    staticLayer = juce::Image(juce::Image::RGB, imageWidth, imageHeight, false);
+    staticLayerScale = scale;
+    countImageMemory();
+    
+    juce::Graphics g(staticLayer);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    drawStaticLayers(g);
+}
+
+void WaveformComponent::countImageMemory()
+{
+    imageMemory.set(MemoryAccounting::bytesOf(staticLayer) + MemoryAccounting::bytesOf(waveformTile.image));
+}
+
+void WaveformComponent::invalidateStaticLayer()
+{
+    staticLayerValid = false;
+    repaint();
+    
+    // Every zoom and pan comes through here, so lanes following the view hook in once
+    double visibleDuration = totalDuration / zoomFactor;
+    double endTime = juce::jmin(viewStartTime + visibleDuration, totalDuration);
+    
+    if (onVisibleRangeChanged && (viewStartTime != notifiedStartTime || endTime != notifiedEndTime))
+    {
+        notifiedStartTime = viewStartTime;
+        notifiedEndTime = endTime;
+        onVisibleRangeChanged(viewStartTime, endTime);
+    }
+}
+
+juce::Rectangle<int> WaveformComponent::getPlayheadBounds(double positionInSeconds) const
+{
+    // Line plus the marker dot, with a pixel either side for antialiasing
+    int positionX = (int)timeToPixel(positionInSeconds, getLocalBounds().reduced(2));
+    return { positionX - 4, 0, 9, getHeight() };
+}
+
+void WaveformComponent::drawPlayhead(juce::Graphics& g, const juce::Rectangle<int>& area)
+{
+    if (totalDuration <= 0.0)
+        return;
+    
+    int positionX = (int)timeToPixel(currentPosition, area);
+    
+    if (positionX >= area.getX() && positionX <= area.getRight())
+    {
+        g.setColour(juce::Colours::yellow);
+        g.drawVerticalLine(positionX, area.getY(), area.getBottom());
+        
+        // Draw position marker
+        g.fillEllipse(positionX - 3, area.getY() - 3, 6, 6);
+    }
+}
+
+void WaveformComponent::drawStaticLayers(juce::Graphics& g)
 {
     g.fillAll(juce::Colour(0xff1a1a1a));
     
@@ -58,7 +152,7 @@ void WaveformComponent::paint(juce::Graphics& g)
     // Draw grid first (behind waveform)
     drawGrid(g, area);
     
-    if (waveformPeaks.empty())
+    if (waveformPeaks == nullptr)
     {
         // Draw placeholder text
         g.setColour(juce::Colours::grey);
@@ -67,73 +161,7 @@ void WaveformComponent::paint(juce::Graphics& g)
         return;
     }
     
-    // Draw waveform with track-specific color
-    g.setColour(waveformColour);
-    
-    const int width = area.getWidth();
-    const int height = area.getHeight();
-    const int centerY = area.getCentreY();
-    
-    if (width > 0 && !waveformPeaks.empty())
-    {
-        juce::Path waveformPath;
-        bool pathStarted = false;
-        
-        // Calculate visible time range based on zoom
-        double visibleDuration = totalDuration / zoomFactor;
-        double endTime = juce::jmin(viewStartTime + visibleDuration, totalDuration);
-        
-        for (int x = 0; x < width; ++x)
-        {
-            // Map x position to time considering zoom and view offset
-            double timePosition = viewStartTime + (x / (double)width) * (endTime - viewStartTime);
-            double normalizedPos = timePosition / totalDuration;
-            
-            if (normalizedPos >= 0.0 && normalizedPos <= 1.0)
-            {
-                int peakIndex = (int)(normalizedPos * (waveformPeaks.size() - 1));
-                peakIndex = juce::jlimit(0, (int)waveformPeaks.size() - 1, peakIndex);
-                
-                float peak = waveformPeaks[peakIndex];
-                int waveHeight = (int)(peak * height * 0.4f);
-                
-                int topY = centerY - waveHeight;
-                int bottomY = centerY + waveHeight;
-                
-                if (!pathStarted)
-                {
-                    waveformPath.startNewSubPath(area.getX() + x, topY);
-                    pathStarted = true;
-                }
-                else
-                {
-                    waveformPath.lineTo(area.getX() + x, topY);
-                }
-            }
-        }
-        
-        // Complete the waveform shape
-        for (int x = width - 1; x >= 0; --x)
-        {
-            double timePosition = viewStartTime + (x / (double)width) * (endTime - viewStartTime);
-            double normalizedPos = timePosition / totalDuration;
-            
-            if (normalizedPos >= 0.0 && normalizedPos <= 1.0)
-            {
-                int peakIndex = (int)(normalizedPos * (waveformPeaks.size() - 1));
-                peakIndex = juce::jlimit(0, (int)waveformPeaks.size() - 1, peakIndex);
-                
-                float peak = waveformPeaks[peakIndex];
-                int waveHeight = (int)(peak * height * 0.4f);
-                int bottomY = centerY + waveHeight;
-                
-                waveformPath.lineTo(area.getX() + x, bottomY);
-            }
-        }
-        
-        waveformPath.closeSubPath();
-        g.fillPath(waveformPath);
-    }
+    drawWaveformTile(g, area);
     
     // Draw beat lines on top of waveform
     drawBeatLines(g, area);
@@ -182,21 +210,6 @@ void WaveformComponent::paint(juce::Graphics& g)
         }
     }
     
-    // Draw playback position
-    if (totalDuration > 0.0)
-    {
-        int positionX = (int)timeToPixel(currentPosition, area);
-        
-        if (positionX >= area.getX() && positionX <= area.getRight())
-        {
-            g.setColour(juce::Colours::yellow);
-            g.drawVerticalLine(positionX, area.getY(), area.getBottom());
-            
-            // Draw position marker
-            g.fillEllipse(positionX - 3, area.getY() - 3, 6, 6);
-        }
-    }
-    
     // Draw loop indicator
     if (isLooping)
     {
@@ -227,8 +240,10 @@ void WaveformComponent::paint(juce::Graphics& g)
         double visibleDuration = totalDuration / zoomFactor;
         double endTime = juce::jmin(viewStartTime + visibleDuration, totalDuration);
         
+        // Enough decimals to tell the view edges apart at sample-level zoom
+        const int decimals = visibleDuration < 0.1 ? 4 : (visibleDuration < 10.0 ? 2 : 1);
         juce::String zoomInfo = "Zoom: " + juce::String(zoomFactor, 1) + "x | " +
-                               "View: " + juce::String(viewStartTime, 1) + "s - " + juce::String(endTime, 1) + "s";
+                               "View: " + juce::String(viewStartTime, decimals) + "s - " + juce::String(endTime, decimals) + "s";
         
         if (hasSelection)
         {
@@ -240,26 +255,8 @@ void WaveformComponent::paint(juce::Graphics& g)
         }
         
         g.drawText(zoomInfo, area.getX() + 5, area.getY() + 5, 350, 15, juce::Justification::left);
-        
-        // Draw scroll indicator
-        if (totalDuration > 0.0)
-        {
-            double scrollPercent = viewStartTime / (totalDuration - visibleDuration);
-            scrollPercent = juce::jlimit(0.0, 1.0, scrollPercent);
-            
-            int scrollBarWidth = 60;
-            int scrollBarX = area.getRight() - scrollBarWidth - 5;
-            int scrollBarY = area.getY() + 5;
-            
-            g.setColour(juce::Colours::darkgrey.withAlpha(0.5f));
-            g.fillRect(scrollBarX, scrollBarY, scrollBarWidth, 4);
-            
-            g.setColour(juce::Colours::cyan.withAlpha(0.8f));
-            int thumbPos = (int)(scrollPercent * (scrollBarWidth - 10));
-            g.fillRect(scrollBarX + thumbPos, scrollBarY, 10, 4);
-        }
     }
-    else if (!waveformPeaks.empty())
+    else if (waveformPeaks != nullptr)
     {
         // Show selection instructions when not zoomed
         g.setColour(juce::Colours::grey.withAlpha(0.6f));
@@ -275,6 +272,71 @@ void WaveformComponent::paint(juce::Graphics& g)
     }
 }
 
+void WaveformComponent::drawWaveformTile(juce::Graphics& g, const juce::Rectangle<int>& area)
+{
+    if (area.getWidth() <= 0 || area.getHeight() <= 0 || totalDuration <= 0.0)
+        return;
+    
+    double visibleDuration = totalDuration / zoomFactor;
+    double endTime = juce::jmin(viewStartTime + visibleDuration, totalDuration);
+    
+    if (endTime <= viewStartTime)
+        return;
+    
+    WaveformTile wanted;
+    wanted.peaks = waveformPeaks;
+    wanted.sampleRate = sampleRate;
+    wanted.colour = waveformColour;
+    wanted.pixelsPerSecond = area.getWidth() / (endTime - viewStartTime);
+    wanted.height = area.getHeight();
+    wanted.scale = staticLayerScale;
+    
+    if (!waveformTile.covers(wanted, viewStartTime, endTime)
+        && !(requestedTile.peaks != nullptr && requestedTile.covers(wanted, viewStartTime, endTime)))
+    {
+        // Render half a view either side, so short pans stay sharp
+        wanted.startTime = juce::jmax(0.0, viewStartTime - visibleDuration * 0.5);
+        wanted.endTime = juce::jmin(totalDuration, endTime + visibleDuration * 0.5);
+        requestedTile = wanted;
+        
+        juce::Component::SafePointer<WaveformComponent> safeThis(this);
+        renderer->requestTile(this, wanted, [safeThis](const WaveformTile& tile)
+        {
+            if (safeThis != nullptr)
+                safeThis->waveformTileRendered(tile);
+        });
+    }
+    
+    if (!waveformTile.isValid() || waveformTile.peaks != waveformPeaks)
+        return;
+    
+    // Map the tile's time span onto the current view; a stale tile just gets stretched
+    const double pixelsPerSecond = area.getWidth() / (endTime - viewStartTime);
+    float tileX = (float)(area.getX() + (waveformTile.startTime - viewStartTime) * pixelsPerSecond);
+    float tileWidth = (float)((waveformTile.endTime - waveformTile.startTime) * pixelsPerSecond);
+    
+    juce::Graphics::ScopedSaveState state(g);
+    g.reduceClipRegion(area);
+    g.drawImage(waveformTile.image, juce::Rectangle<float>(tileX, (float)area.getY(), tileWidth, (float)area.getHeight()));
+}
+
+void WaveformComponent::waveformTileRendered(const WaveformTile& tile)
+{
+    // Drop tiles for data that has since been replaced
+    if (tile.peaks != waveformPeaks)
+        return;
+    
+    if (requestedTile.hasSameResolutionAs(tile) && requestedTile.startTime == tile.startTime)
+        requestedTile = {};
+    
+    waveformTile = tile;
+    countImageMemory();
+    invalidateStaticLayer();
+    
+    if (onWaveformTileRendered)
+        onWaveformTileRendered(waveformTile);
+}
+
 void WaveformComponent::drawGrid(juce::Graphics& g, const juce::Rectangle<int>& area)
 {
     // Draw amplitude grid lines (horizontal)
@@ -349,19 +411,17 @@ void WaveformComponent::drawBeatLines(juce::Graphics& g, const juce::Rectangle<i
     }
 }
 
-void WaveformComponent::initializeGridPositions()
+double WaveformComponent::getBeatTime(int beatIndex) const
+{
+    return detectedBPM > 0.0 ? beatIndex * 60.0 / detectedBPM : 0.0;
+}
+
+int WaveformComponent::getNumBeats() const
 {
-    gridPositions.clear();
-    
     if (detectedBPM <= 0.0 || totalDuration <= 0.0)
-        return;
-    
-    double beatInterval = 60.0 / detectedBPM;
+        return 0;
     
-    for (double beatTime = 0.0; beatTime < totalDuration; beatTime += beatInterval)
-    {
-        gridPositions.push_back(beatTime);
-    }
+    return (int)std::ceil(totalDuration * detectedBPM / 60.0);
 }
 
 int WaveformComponent::findGridLineAtPosition(int mouseX, const juce::Rectangle<int>& area)
@@ -393,7 +453,7 @@ void WaveformComponent::updateBPMFromGrid()
         return;
     
     // Calculate new BPM based on dragged grid position
-    double draggedBeatTime = gridPositions[draggedGridIndex];
+    double draggedBeatTime = draggedGridTime;
     double newBeatInterval = draggedBeatTime / draggedGridIndex;
     double newBPM = 60.0 / newBeatInterval;
     
@@ -403,14 +463,13 @@ void WaveformComponent::updateBPMFromGrid()
     if (std::abs(newBPM - detectedBPM) > 0.1)
     {
         detectedBPM = newBPM;
-        initializeGridPositions();
         
         if (onBPMChanged)
         {
             onBPMChanged(detectedBPM);
         }
         
-        repaint();
+        invalidateStaticLayer();
     }
 }
 
@@ -477,6 +536,17 @@ double WaveformComponent::pixelToTime(int pixelX, const juce::Rectangle<int>& ar
     return viewStartTime + normalizedPosition * (endTime - viewStartTime);
 }
 
+double WaveformComponent::snapTime(double timeInSeconds, const juce::MouseEvent& event, const juce::Rectangle<int>& area, bool transientsOnly) const
+{
+    if (snapIndex == nullptr || event.mods.isAltDown() || area.getWidth() <= 0)
+        return timeInSeconds;
+    
+    double reach = snapRadiusPixels * (totalDuration / zoomFactor) / area.getWidth();
+    
+    return transientsOnly ? snapIndex->snapToTransient(timeInSeconds, reach)
+                          : snapIndex->snapEdge(timeInSeconds, reach);
+}
+
 void WaveformComponent::mouseDown(const juce::MouseEvent& event)
 {
     juce::Rectangle<int> area = getLocalBounds().reduced(2);
@@ -495,9 +565,10 @@ void WaveformComponent::mouseDown(const juce::MouseEvent& event)
         draggedGridIndex = gridIndex;
         initialMouseX = event.x;
         
-        if (gridIndex < (int)gridPositions.size())
+        if (gridIndex < getNumBeats())
         {
-            initialGridTime = gridPositions[gridIndex];
+            initialGridTime = getBeatTime(gridIndex);
+            draggedGridTime = initialGridTime;
         }
     }
     else if (event.mods.isShiftDown())
@@ -536,7 +607,7 @@ void WaveformComponent::mouseDown(const juce::MouseEvent& event)
         isResizingSelectionStart = false;
         isResizingSelectionEnd = false;
         
-        double startTime = pixelToTime(event.x, area);
+        double startTime = snapTime(pixelToTime(event.x, area), event, area, false);
         selectionStart = juce::jlimit(0.0, totalDuration, startTime);
         selectionEnd = selectionStart;
         selectionStartX = event.x;
@@ -572,12 +643,12 @@ void WaveformComponent::mouseDrag(const juce::MouseEvent& event)
         // Grid line dragging for BPM adjustment
         juce::Rectangle<int> area = getLocalBounds().reduced(2);
         
-        double newTime = pixelToTime(event.x, area);
+        double newTime = snapTime(pixelToTime(event.x, area), event, area, true);
         newTime = juce::jlimit(0.0, totalDuration, newTime);
         
-        if (draggedGridIndex < (int)gridPositions.size())
+        if (draggedGridIndex < getNumBeats())
         {
-            gridPositions[draggedGridIndex] = newTime;
+            draggedGridTime = newTime;
             updateBPMFromGrid();
         }
     }
@@ -586,7 +657,7 @@ void WaveformComponent::mouseDrag(const juce::MouseEvent& event)
         // Resize selection start edge
         juce::Rectangle<int> area = getLocalBounds().reduced(2);
         
-        double newStartTime = pixelToTime(event.x, area);
+        double newStartTime = snapTime(pixelToTime(event.x, area), event, area, false);
         newStartTime = juce::jlimit(0.0, totalDuration, newStartTime);
         
         // Ensure start doesn't go past the fixed end
@@ -607,14 +678,14 @@ void WaveformComponent::mouseDrag(const juce::MouseEvent& event)
         }
         
         hasSelection = (std::abs(selectionEnd - selectionStart) > 0.01);
-        repaint();
+        invalidateStaticLayer();
     }
     else if (isResizingSelectionEnd)
     {
         // Resize selection end edge
         juce::Rectangle<int> area = getLocalBounds().reduced(2);
         
-        double newEndTime = pixelToTime(event.x, area);
+        double newEndTime = snapTime(pixelToTime(event.x, area), event, area, false);
         newEndTime = juce::jlimit(0.0, totalDuration, newEndTime);
         
         // Ensure end doesn't go before the fixed start
@@ -635,14 +706,14 @@ void WaveformComponent::mouseDrag(const juce::MouseEvent& event)
         }
         
         hasSelection = (std::abs(selectionEnd - selectionStart) > 0.01);
-        repaint();
+        invalidateStaticLayer();
     }
     else if (isSelecting)
     {
         // Selection dragging (new selection)
         juce::Rectangle<int> area = getLocalBounds().reduced(2);
         
-        double endTime = pixelToTime(event.x, area);
+        double endTime = snapTime(pixelToTime(event.x, area), event, area, false);
         endTime = juce::jlimit(0.0, totalDuration, endTime);
         
         // Ensure selection start is always less than end
@@ -657,7 +728,7 @@ void WaveformComponent::mouseDrag(const juce::MouseEvent& event)
         }
         
         hasSelection = (std::abs(selectionEnd - selectionStart) > 0.01); // Minimum 10ms selection
-        repaint();
+        invalidateStaticLayer();
     }
     else if (isDraggingWaveform && zoomFactor > 1.01)
     {
@@ -676,7 +747,7 @@ void WaveformComponent::mouseDrag(const juce::MouseEvent& event)
         double maxViewStart = juce::jmax(0.0, totalDuration - visibleDuration);
         viewStartTime = juce::jlimit(0.0, maxViewStart, viewStartTime);
         
-        repaint();
+        invalidateStaticLayer();
     }
     else if (!isDraggingGrid && !isDraggingWaveform && !isSelecting && !isResizingSelectionStart && !isResizingSelectionEnd)
     {
@@ -756,7 +827,7 @@ void WaveformComponent::setSelectionRange(double startTime, double endTime)
         selectionStart = startTime;
         selectionEnd = endTime;
         hasSelection = true;
-        repaint();
+        invalidateStaticLayer();
     }
 }
 
@@ -765,7 +836,7 @@ void WaveformComponent::clearSelection()
     hasSelection = false;
     selectionStart = 0.0;
     selectionEnd = 0.0;
-    repaint();
+    invalidateStaticLayer();
 }
 
 bool WaveformComponent::isNearSelectionEdge(int mouseX, const juce::Rectangle<int>& area, bool& nearStart, bool& nearEnd)
@@ -784,9 +855,13 @@ bool WaveformComponent::isNearSelectionEdge(int mouseX, const juce::Rectangle<in
     return nearStart || nearEnd;
 }
 
-void WaveformComponent::setWaveformData(const std::vector<float>& peaks, double sr, int samples)
+void WaveformComponent::setWaveformData(std::shared_ptr<const WaveformPeaks> peaks, double sr, int samples)
 {
-    waveformPeaks = peaks;
+    // Immutable and shared with the track and the renderer thread, so nothing is copied
+    waveformPeaks = (peaks != nullptr && !peaks->isEmpty()) ? std::move(peaks) : nullptr;
+    waveformTile = {};
+    requestedTile = {};
+    countImageMemory();
     sampleRate = sr;
     totalSamples = samples;
     totalDuration = samples / sr;
@@ -797,24 +872,30 @@ void WaveformComponent::setWaveformData(const std::vector<float>& peaks, double
     selectionEnd = 0.0;
     isResizingSelectionStart = false;
     isResizingSelectionEnd = false;
-    initializeGridPositions();
-    repaint();
+    invalidateStaticLayer();
 }
 
 void WaveformComponent::setPlayPosition(double positionInSeconds)
 {
     if (currentPosition != positionInSeconds)
     {
+        juce::Rectangle<int> oldBounds = getPlayheadBounds(currentPosition);
         currentPosition = positionInSeconds;
-        repaint();
+        juce::Rectangle<int> newBounds = getPlayheadBounds(currentPosition);
+        
+        // Only the columns the playhead leaves and enters need redrawing
+        if (newBounds != oldBounds)
+        {
+            repaint(oldBounds);
+            repaint(newBounds);
+        }
     }
 }
 
 void WaveformComponent::setDuration(double durationInSeconds)
 {
     totalDuration = durationInSeconds;
-    initializeGridPositions();
-    repaint();
+    invalidateStaticLayer();
 }
 
 void WaveformComponent::setLooping(bool shouldLoop)
@@ -822,7 +903,7 @@ void WaveformComponent::setLooping(bool shouldLoop)
     if (isLooping != shouldLoop)
     {
         isLooping = shouldLoop;
-        repaint();
+        invalidateStaticLayer();
     }
 }
 
@@ -831,8 +912,7 @@ void WaveformComponent::setDetectedBPM(double bpm)
     if (detectedBPM != bpm)
     {
         detectedBPM = bpm;
-        initializeGridPositions();
-        repaint();
+        invalidateStaticLayer();
     }
 }
 
@@ -841,7 +921,7 @@ void WaveformComponent::setWaveformColour(const juce::Colour& colour)
     if (waveformColour != colour)
     {
         waveformColour = colour;
-        repaint();
+        invalidateStaticLayer();
     }
 }
 
@@ -850,15 +930,22 @@ void WaveformComponent::setQuantizeValue(int quantizeValue)
     if (quantizeDivisions != quantizeValue)
     {
         quantizeDivisions = quantizeValue;
-        repaint();
+        invalidateStaticLayer();
     }
 }
 
+double WaveformComponent::getMaxZoomFactor() const
+{
+    // Deep enough to show individual samples about 16 pixels apart
+    const int width = juce::jmax(1, getWidth() - 4);
+    return juce::jmax(20.0, totalDuration * sampleRate * 16.0 / width);
+}
+
 void WaveformComponent::setZoomFactor(double zoom)
 {
-    double newZoom = juce::jlimit(0.1, 20.0, zoom);
+    double newZoom = juce::jlimit(0.1, getMaxZoomFactor(), zoom);
     
-    if (std::abs(zoomFactor - newZoom) > 0.01)
+    if (std::abs(zoomFactor - newZoom) > zoomFactor * 1.0e-4)
     {
         // Adjust view start time to keep zoom centered
         double visibleDuration = totalDuration / zoomFactor;
@@ -879,847 +966,275 @@ void WaveformComponent::setZoomFactor(double zoom)
             viewStartTime = 0.0;
         }
         
-        repaint();
+        invalidateStaticLayer();
+    }
+}
+
+void WaveformComponent::setViewCentre(double timeInSeconds)
+{
+    double visibleDuration = totalDuration / zoomFactor;
+    double newStartTime = juce::jlimit(0.0, juce::jmax(0.0, totalDuration - visibleDuration),
+                                       timeInSeconds - visibleDuration * 0.5);
+    
+    if (newStartTime != viewStartTime)
+    {
+        viewStartTime = newStartTime;
+        invalidateStaticLayer();
     }
 }
 
+void WaveformComponent::setSnapIndex(std::shared_ptr<const SnapIndex> index)
+{
+    snapIndex = std::move(index);
+}
+
 // ============================================================================
-// AudioTrack Implementation
+// WaveformOverviewComponent Implementation
 // ============================================================================
 
-AudioTrack::AudioTrack()
+WaveformOverviewComponent::WaveformOverviewComponent()
     : sampleRate(44100.0),
+      totalDuration(0.0),
+      waveformColour(juce::Colour(0xff0080ff)),
+      viewStartTime(0.0),
+      viewEndTime(0.0),
+      hasSelection(false),
+      selectionStart(0.0),
+      selectionEnd(0.0),
       currentPosition(0.0),
-      stretchRatio(1.0),
-      detectedBPM(0.0),
-      masterBPM(120.0),
-      muted(false),
-      solo(false),
-      looping(true),
-      volume(1.0f),
-      hasCustomLoopRegion(false),
-      loopStartTime(0.0),
-      loopEndTime(0.0)
+      tileRequested(false),
+      tileMemory(MemoryAccounting::waveformImages)
 {
-    formatManager.registerBasicFormats();
-    soundTouch = std::make_unique<soundtouch::SoundTouch>();
+    setOpaque(true);
 }
 
-AudioTrack::~AudioTrack()
+WaveformOverviewComponent::~WaveformOverviewComponent()
 {
-    juce::ScopedLock sl(lock);
-    
-    if (soundTouch)
-    {
-        soundTouch.reset();
-    }
-    
-    audioBuffer.clear();
-    stretchedBuffer.clear();
+    renderer->cancelRequests(this);
+    onNavigate = nullptr;
 }
 
-void AudioTrack::loadAudioFile(const juce::File& file)
+void WaveformOverviewComponent::paint(juce::Graphics& g)
 {
-    juce::ScopedLock sl(lock);
+    g.fillAll(juce::Colour(0xff141414));
+    
+    if (waveformPeaks == nullptr || totalDuration <= 0.0)
+        return;
+    
+    requestTileIfNeeded(g.getInternalContext().getPhysicalPixelScaleFactor());
     
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    const float height = (float)getHeight();
     
-    if (reader != nullptr)
+    if (waveformTile.isValid() && waveformTile.peaks == waveformPeaks)
     {
-        audioBuffer.setSize(reader->numChannels, static_cast<int>(reader->lengthInSamples));
-        reader->read(&audioBuffer, 0, static_cast<int>(reader->lengthInSamples), 0, true, true);
-        
-        sampleRate = reader->sampleRate;
-        fileName = file.getFileNameWithoutExtension();
-        currentPosition = 0.0;
-        stretchRatio = 1.0;
-        
-        // Clear any existing loop region when loading new file
-        hasCustomLoopRegion = false;
-        loopStartTime = 0.0;
-        loopEndTime = 0.0;
-        
-        generateWaveformPeaks();
-        
-        // Advanced BPM detection
-        detectedBPM = detectBPMFromOnsets();
-        
-        // Fallback to autocorrelation if onset detection fails
-        if (detectedBPM < 60.0 || detectedBPM > 200.0)
-        {
-            detectedBPM = detectBPMAutocorrelation();
-        }
-        
-        // Final fallback to pattern-based detection
-        if (detectedBPM < 60.0 || detectedBPM > 200.0)
-        {
-            detectedBPM = detectBPMImproved();
-        }
-        
-        // Ultimate fallback
-        if (detectedBPM < 60.0 || detectedBPM > 200.0)
-        {
-            detectedBPM = 120.0;
-            juce::Logger::writeToLog("BPM detection failed for " + fileName + " - using 120 BPM default. Use manual grid adjustment.");
-        }
+        // Detail-view tiles are taller and only ever get squeezed to fit
+        const float tileX = timeToX(waveformTile.startTime);
+        g.drawImage(waveformTile.image,
+                    juce::Rectangle<float>(tileX, 0.0f, timeToX(waveformTile.endTime) - tileX, height));
+    }
+    
+    if (hasSelection && selectionEnd > selectionStart)
+    {
+        const float startX = timeToX(selectionStart);
+        g.setColour(juce::Colours::yellow.withAlpha(0.25f));
+        g.fillRect(juce::Rectangle<float>(startX, 0.0f, timeToX(selectionEnd) - startX, height));
+    }
+    
+    // Shade what the detail view leaves out
+    if (viewEndTime > viewStartTime && (viewStartTime > 0.0 || viewEndTime < totalDuration))
+    {
+        const float startX = timeToX(viewStartTime);
+        const float endX = juce::jmax(startX + 2.0f, timeToX(viewEndTime));
         
-        initializeSoundTouch();
-        stretchedBuffer.setSize(reader->numChannels, 8192, false, false, true);
+        g.setColour(juce::Colours::black.withAlpha(0.55f));
+        g.fillRect(juce::Rectangle<float>(0.0f, 0.0f, startX, height));
+        g.fillRect(juce::Rectangle<float>(endX, 0.0f, (float)getWidth() - endX, height));
         
-        juce::Logger::writeToLog("Loaded: " + fileName +
-                                " - BPM: " + juce::String(detectedBPM, 1) +
-                                " (Advanced detection with manual adjustment available)");
+        g.setColour(juce::Colours::cyan.withAlpha(0.8f));
+        g.drawRect(juce::Rectangle<float>(startX, 0.0f, endX - startX, height), 1.0f);
     }
+    
+    g.setColour(juce::Colours::yellow);
+    g.drawVerticalLine(juce::roundToInt(timeToX(currentPosition)), 0.0f, height);
 }
 
-double AudioTrack::detectBPMFromOnsets()
+void WaveformOverviewComponent::mouseDown(const juce::MouseEvent& event)
 {
-    if (!isLoaded() || audioBuffer.getNumSamples() < (int)sampleRate)
-        return 120.0;
-    
-    std::vector<float> onsetStrength = calculateOnsetStrength();
-    
-    if (onsetStrength.size() < 10)
-        return 120.0;
-    
-    // Find peaks in onset strength
-    std::vector<double> onsetTimes;
-    const double hopSize = 512.0;
-    const double threshold = 0.3;
+    mouseDrag(event);
+}
+
+void WaveformOverviewComponent::mouseDrag(const juce::MouseEvent& event)
+{
+    if (onNavigate && totalDuration > 0.0 && getWidth() > 0)
+        onNavigate(juce::jlimit(0.0, totalDuration, event.position.x * totalDuration / getWidth()));
+}
+
+void WaveformOverviewComponent::setWaveformData(std::shared_ptr<const WaveformPeaks> peaks, double sr, double durationInSeconds)
+{
+    waveformPeaks = (peaks != nullptr && !peaks->isEmpty()) ? std::move(peaks) : nullptr;
+    sampleRate = sr;
+    totalDuration = durationInSeconds;
+    viewStartTime = 0.0;
+    viewEndTime = durationInSeconds;
+    hasSelection = false;
     
-    if (!onsetStrength.empty())
+    waveformTile = {};
+    tileMemory.set(0);
+    renderer->cancelRequests(this);
+    tileRequested = false;
+    repaint();
+}
+
+void WaveformOverviewComponent::setWaveformColour(const juce::Colour& colour)
+{
+    if (waveformColour != colour)
     {
-        float maxOnset = *std::max_element(onsetStrength.begin(), onsetStrength.end());
-        float adaptiveThreshold = maxOnset * threshold;
-        
-        for (int i = 1; i < (int)onsetStrength.size() - 1; ++i)
-        {
-            if (onsetStrength[i] > adaptiveThreshold &&
-                onsetStrength[i] > onsetStrength[i-1] &&
-                onsetStrength[i] > onsetStrength[i+1])
-            {
-                double onsetTime = (i * hopSize) / sampleRate;
-                onsetTimes.push_back(onsetTime);
-            }
-        }
+        waveformColour = colour;
+        waveformTile = {};
+        tileMemory.set(0);
+        repaint();
     }
-    
-    if (onsetTimes.size() < 4)
-        return 120.0;
-    
-    return findBestBPMCandidate(onsetTimes);
 }
 
-std::vector<float> AudioTrack::calculateOnsetStrength()
+void WaveformOverviewComponent::setVisibleRange(double startTime, double endTime)
 {
-    const int hopSize = 512;
-    const int frameSize = 1024;
-    const int numSamples = audioBuffer.getNumSamples();
-    const int numChannels = audioBuffer.getNumChannels();
-    
-    std::vector<float> onsetStrength;
-    std::vector<float> prevSpectrum(frameSize / 2, 0.0f);
-    
-    for (int pos = 0; pos < numSamples - frameSize; pos += hopSize)
+    if (startTime != viewStartTime || endTime != viewEndTime)
     {
-        std::vector<float> currentSpectrum(frameSize / 2, 0.0f);
-        
-        // Simple spectral magnitude calculation (without FFT for simplicity)
-        for (int bin = 0; bin < frameSize / 2; ++bin)
-        {
-            float magnitude = 0.0f;
-            
-            for (int ch = 0; ch < numChannels; ++ch)
-            {
-                if (pos + bin < numSamples)
-                {
-                    float sample = audioBuffer.getSample(ch, pos + bin);
-                    magnitude += std::abs(sample);
-                }
-            }
-            
-            currentSpectrum[bin] = magnitude / numChannels;
-        }
-        
-        // Calculate spectral flux (onset strength)
-        float flux = 0.0f;
-        for (int bin = 0; bin < frameSize / 2; ++bin)
-        {
-            float diff = currentSpectrum[bin] - prevSpectrum[bin];
-            if (diff > 0)
-                flux += diff;
-        }
-        
-        onsetStrength.push_back(flux);
-        prevSpectrum = currentSpectrum;
+        viewStartTime = startTime;
+        viewEndTime = endTime;
+        repaint();
     }
-    
-    return onsetStrength;
 }
 
-double AudioTrack::findBestBPMCandidate(const std::vector<double>& onsetTimes)
+void WaveformOverviewComponent::setSelectionRange(double startTime, double endTime)
 {
-    if (onsetTimes.size() < 4)
-        return 120.0;
-    
-    // Calculate intervals between consecutive onsets
-    std::vector<double> intervals;
-    for (size_t i = 1; i < onsetTimes.size(); ++i)
+    hasSelection = true;
+    selectionStart = startTime;
+    selectionEnd = endTime;
+    repaint();
+}
+
+void WaveformOverviewComponent::clearSelection()
+{
+    if (hasSelection)
+    {
+        hasSelection = false;
+        repaint();
+    }
+}
+
+void WaveformOverviewComponent::setPlayPosition(double positionInSeconds)
+{
+    if (currentPosition != positionInSeconds)
     {
-        double interval = onsetTimes[i] - onsetTimes[i-1];
-        if (interval > 0.1 && interval < 2.0) // Reasonable beat interval range
+        juce::Rectangle<int> oldBounds = getPlayheadBounds(currentPosition);
+        currentPosition = positionInSeconds;
+        juce::Rectangle<int> newBounds = getPlayheadBounds(currentPosition);
+        
+        if (newBounds != oldBounds)
         {
-            intervals.push_back(interval);
+            repaint(oldBounds);
+            repaint(newBounds);
         }
     }
+}
+
+void WaveformOverviewComponent::offerTile(const WaveformTile& tile)
+{
+    if (!spansWholeTrack(tile))
+        return;
     
-    if (intervals.empty())
-        return 120.0;
-    
-    // Find most common interval (histogram approach)
-    std::sort(intervals.begin(), intervals.end());
-    
-    const double tolerance = 0.05;
-    double bestInterval = 0.0;
-    int maxCount = 0;
+    waveformTile = tile;
+    tileMemory.set(0);
     
-    for (size_t i = 0; i < intervals.size(); ++i)
+    if (tileRequested)
     {
-        int count = 1;
-        double currentInterval = intervals[i];
-        
-        for (size_t j = i + 1; j < intervals.size(); ++j)
-        {
-            if (std::abs(intervals[j] - currentInterval) <= tolerance)
-            {
-                count++;
-            }
-            else
-            {
-                break;
-            }
-        }
-        
-        if (count > maxCount)
-        {
-            maxCount = count;
-            bestInterval = currentInterval;
-        }
-    }
-    
-    if (bestInterval > 0.0)
-    {
-        double bpm = 60.0 / bestInterval;
-        
-        // Octave correction for musical tempos
-        while (bpm < 70.0 && bpm > 0.0) bpm *= 2.0;
-        while (bpm > 180.0) bpm /= 2.0;
-        
-        return bpm;
-    }
-    
-    return 120.0;
-}
-
-double AudioTrack::detectBPMAutocorrelation()
-{
-    const int numSamples = audioBuffer.getNumSamples();
-    if (numSamples < (int)sampleRate) return 120.0;
-    
-    // Use mono sum for analysis
-    std::vector<float> monoSignal(numSamples);
-    const int numChannels = audioBuffer.getNumChannels();
-    
-    for (int i = 0; i < numSamples; ++i)
-    {
-        float sum = 0.0f;
-        for (int ch = 0; ch < numChannels; ++ch)
-        {
-            sum += audioBuffer.getSample(ch, i);
-        }
-        monoSignal[i] = sum / numChannels;
-    }
-    
-    // Calculate onset strength function
-    const int hopSize = 512;
-    const int frameSize = 1024;
-    std::vector<float> onsetStrength;
-    
-    for (int pos = 0; pos < numSamples - frameSize; pos += hopSize)
-    {
-        float energy = 0.0f;
-        float prevEnergy = 0.0f;
-        
-        // Current frame energy
-        for (int i = 0; i < frameSize; ++i)
-        {
-            if (pos + i < numSamples)
-                energy += monoSignal[pos + i] * monoSignal[pos + i];
-        }
-        
-        // Previous frame energy
-        for (int i = 0; i < frameSize; ++i)
-        {
-            if (pos - hopSize + i >= 0 && pos - hopSize + i < numSamples)
-                prevEnergy += monoSignal[pos - hopSize + i] * monoSignal[pos - hopSize + i];
-        }
-        
-        float strength = juce::jmax(0.0f, energy - prevEnergy);
-        onsetStrength.push_back(strength);
-    }
-    
-    if (onsetStrength.size() < 10) return 120.0;
-    
-    // Autocorrelation on onset strength
-    const int minLag = (int)(60.0 * sampleRate / (200.0 * hopSize)); // 200 BPM max
-    const int maxLag = (int)(60.0 * sampleRate / (60.0 * hopSize));   // 60 BPM min
-    
-    double bestCorr = 0.0;
-    int bestLag = minLag;
-    
-    for (int lag = minLag; lag < maxLag && lag < (int)onsetStrength.size() / 2; ++lag)
-    {
-        double correlation = 0.0;
-        int count = 0;
-        
-        for (int i = 0; i < (int)onsetStrength.size() - lag; ++i)
-        {
-            correlation += onsetStrength[i] * onsetStrength[i + lag];
-            count++;
-        }
-        
-        if (count > 0)
-        {
-            correlation /= count;
-            
-            if (correlation > bestCorr)
-            {
-                bestCorr = correlation;
-                bestLag = lag;
-            }
-        }
-    }
-    
-    // Convert lag to BPM
-    double beatInterval = (bestLag * hopSize) / sampleRate;
-    double bpm = 60.0 / beatInterval;
-    
-    // Octave correction for musical tempos
-    while (bpm < 70.0 && bpm > 0.0) bpm *= 2.0;
-    while (bpm > 180.0) bpm /= 2.0;
-    
-    return bpm;
-}
-
-std::vector<double> AudioTrack::calculateBeatTrack()
-{
-    std::vector<double> beatTimes;
-    
-    if (!isLoaded() || audioBuffer.getNumSamples() == 0)
-        return beatTimes;
-    
-    const int hopSize = 512;
-    const int frameSize = 1024;
-    const int numSamples = audioBuffer.getNumSamples();
-    
-    // Calculate spectral flux
-    std::vector<float> spectralFlux;
-    std::vector<float> prevMagnitudes(frameSize / 2, 0.0f);
-    
-    for (int pos = 0; pos < numSamples - frameSize; pos += hopSize)
-    {
-        std::vector<float> magnitudes(frameSize / 2, 0.0f);
-        
-        for (int i = 0; i < frameSize / 2; ++i)
-        {
-            if (pos + i < numSamples)
-            {
-                float sample = audioBuffer.getSample(0, pos + i);
-                magnitudes[i] = std::abs(sample);
-            }
-        }
-        
-        float flux = 0.0f;
-        for (int i = 0; i < frameSize / 2; ++i)
-        {
-            float diff = magnitudes[i] - prevMagnitudes[i];
-            if (diff > 0) flux += diff;
-        }
-        
-        spectralFlux.push_back(flux);
-        prevMagnitudes = magnitudes;
-    }
-    
-    // Peak picking on spectral flux
-    const float threshold = 0.3f;
-    if (!spectralFlux.empty())
-    {
-        float maxFlux = *std::max_element(spectralFlux.begin(), spectralFlux.end());
-        float adaptiveThreshold = maxFlux * threshold;
-        
-        for (int i = 1; i < (int)spectralFlux.size() - 1; ++i)
-        {
-            if (spectralFlux[i] > adaptiveThreshold &&
-                spectralFlux[i] > spectralFlux[i-1] &&
-                spectralFlux[i] > spectralFlux[i+1])
-            {
-                double beatTime = (i * hopSize) / sampleRate;
-                beatTimes.push_back(beatTime);
-            }
-        }
-    }
-    
-    return beatTimes;
-}
-
-double AudioTrack::detectBPMImproved()
-{
-    if (!isLoaded() || audioBuffer.getNumSamples() == 0)
-        return 120.0;
-    
-    const double duration = getDurationInSeconds();
-    
-    // For common musical loop patterns (4, 8, 16, 32 beats)
-    std::vector<double> possibleBPMs;
-    
-    for (int beats : {4, 8, 16, 32})
-    {
-        double bpm = (beats * 60.0) / duration;
-        if (bpm >= 60.0 && bpm <= 200.0)
-        {
-            possibleBPMs.push_back(bpm);
-        }
-    }
-    
-    if (!possibleBPMs.empty())
-    {
-        for (double bpm : possibleBPMs)
-        {
-            if (bpm >= 65.0 && bpm <= 150.0)
-            {
-                return bpm;
-            }
-        }
-        return possibleBPMs[0];
-    }
-    
-    return 120.0;
-}
-
-void AudioTrack::setManualBPM(double bpm)
-{
-    juce::ScopedLock sl(lock);
-    
-    if (bpm >= 60.0 && bpm <= 200.0)
-    {
-        detectedBPM = bpm;
-        juce::Logger::writeToLog("Manual BPM set to: " + juce::String(bpm, 1) + " for " + fileName);
-    }
-}
-
-void AudioTrack::autoSyncToMaster()
-{
-    if (detectedBPM > 0.0 && masterBPM > 0.0)
-    {
-        double syncRatio = detectedBPM / masterBPM;
-        setStretchRatio(syncRatio);
+        renderer->cancelRequests(this);
+        tileRequested = false;
     }
-}
-
-void AudioTrack::initializeSoundTouch()
-{
-    if (soundTouch && audioBuffer.getNumSamples() > 0)
-    {
-        soundTouch->setSampleRate(static_cast<uint32_t>(sampleRate));
-        soundTouch->setChannels(audioBuffer.getNumChannels());
-        soundTouch->setTempo(stretchRatio);
-        soundTouch->setPitch(1.0);
-        soundTouch->clear();
-    }
-}
-
-void AudioTrack::generateWaveformPeaks()
-{
-    waveformPeaks.clear();
     
-    if (audioBuffer.getNumSamples() == 0)
-        return;
-    
-    const int numSamples = audioBuffer.getNumSamples();
-    const int numChannels = audioBuffer.getNumChannels();
-    const int peaksPerSecond = 100;
-    const int samplesPerPeak = juce::jmax(1, (int)(sampleRate / peaksPerSecond));
-    const int numPeaks = (numSamples + samplesPerPeak - 1) / samplesPerPeak;
-    
-    waveformPeaks.reserve(numPeaks);
-    
-    for (int peakIndex = 0; peakIndex < numPeaks; ++peakIndex)
-    {
-        int startSample = peakIndex * samplesPerPeak;
-        int endSample = juce::jmin(startSample + samplesPerPeak, numSamples);
-        
-        float maxPeak = 0.0f;
-        
-        for (int channel = 0; channel < numChannels; ++channel)
-        {
-            const float* channelData = audioBuffer.getReadPointer(channel);
-            
-            for (int sample = startSample; sample < endSample; ++sample)
-            {
-                maxPeak = juce::jmax(maxPeak, std::abs(channelData[sample]));
-            }
-        }
-        
-        waveformPeaks.push_back(maxPeak);
-    }
-}
-
-void AudioTrack::setStretchRatio(double ratio)
-{
-    juce::ScopedLock sl(lock);
-    
-    double newRatio = juce::jlimit(0.25, 4.0, ratio);
-    if (std::abs(newRatio - stretchRatio) > 0.001)
-    {
-        stretchRatio = newRatio;
-    }
-}
-
-void AudioTrack::scaleStretchRatio(double scaleFactor)
-{
-    juce::ScopedLock sl(lock);
-    
-    double newRatio = stretchRatio * scaleFactor;
-    newRatio = juce::jlimit(0.25, 4.0, newRatio);
-    
-    if (std::abs(newRatio - stretchRatio) > 0.001)
-    {
-        stretchRatio = newRatio;
-    }
-}
-
-void AudioTrack::setPosition(double positionInSeconds)
-{
-    juce::ScopedLock sl(lock);
-    
-    // If there's a custom loop region, constrain position within it
-    if (hasCustomLoopRegion && loopEndTime > loopStartTime)
-    {
-        currentPosition = juce::jlimit(loopStartTime, loopEndTime, positionInSeconds);
-    }
-    else
-    {
-        currentPosition = juce::jlimit(0.0, getDurationInSeconds(), positionInSeconds);
-    }
-}
-
-void AudioTrack::reset()
-{
-    juce::ScopedLock sl(lock);
-    
-    // Reset to loop start if there's a custom loop region, otherwise to beginning
-    if (hasCustomLoopRegion && loopStartTime >= 0.0)
-    {
-        currentPosition = loopStartTime;
-    }
-    else
-    {
-        currentPosition = 0.0;
-    }
-    
-    if (soundTouch)
-        soundTouch->clear();
-}
-
-void AudioTrack::setMasterBPM(double newMasterBPM)
-{
-    juce::ScopedLock sl(lock);
-    masterBPM = newMasterBPM;
+    repaint();
 }
 
-void AudioTrack::processBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+void WaveformOverviewComponent::requestTileIfNeeded(float scale)
 {
-    juce::ScopedLock sl(lock);
-    
-    if (!isLoaded() || muted || numSamples <= 0 || startSample < 0)
-    {
+    if (tileRequested || getWidth() <= 0 || getHeight() <= 0)
         return;
-    }
-    
-    const int outputChannels = buffer.getNumChannels();
-    const int inputChannels = audioBuffer.getNumChannels();
-    const int totalSamples = audioBuffer.getNumSamples();
     
-    if (outputChannels <= 0 || inputChannels <= 0 || totalSamples <= 0)
-        return;
+    // Any whole-track tile will do unless it is far from our own width
+    const double pixelsPerSecond = getWidth() / totalDuration;
     
-    if (startSample + numSamples > buffer.getNumSamples())
+    if (spansWholeTrack(waveformTile) && waveformTile.scale == scale
+        && waveformTile.pixelsPerSecond > pixelsPerSecond / 1.5 && waveformTile.pixelsPerSecond < pixelsPerSecond * 1.5)
         return;
     
-    if (std::abs(stretchRatio - 1.0) < 0.02)
-    {
-        processDirectPlayback(buffer, startSample, numSamples);
-    }
-    else
-    {
-        processWithSoundTouch(buffer, startSample, numSamples);
-    }
+    WaveformTile wanted;
+    wanted.peaks = waveformPeaks;
+    wanted.sampleRate = sampleRate;
+    wanted.colour = waveformColour;
+    wanted.startTime = 0.0;
+    wanted.endTime = totalDuration;
+    wanted.pixelsPerSecond = pixelsPerSecond;
+    wanted.height = getHeight();
+    wanted.scale = scale;
+    tileRequested = true;
+    
+    juce::Component::SafePointer<WaveformOverviewComponent> safeThis(this);
+    renderer->requestTile(this, wanted, [safeThis](const WaveformTile& tile)
+    {
+        if (safeThis != nullptr)
+            safeThis->tileRendered(tile);
+    });
 }
 
-void AudioTrack::processDirectPlayback(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+void WaveformOverviewComponent::tileRendered(const WaveformTile& tile)
 {
-    const int outputChannels = buffer.getNumChannels();
-    const int inputChannels = audioBuffer.getNumChannels();
-    const int totalSamples = audioBuffer.getNumSamples();
-    const int channelsToProcess = juce::jmin(outputChannels, inputChannels);
-    
-    // Determine loop bounds
-    double loopStart = 0.0;
-    double loopEnd = getDurationInSeconds();
-    
-    if (hasCustomLoopRegion && loopEndTime > loopStartTime)
-    {
-        loopStart = loopStartTime;
-        loopEnd = loopEndTime;
-    }
-    
-    int loopStartSample = (int)(loopStart * sampleRate);
-    int loopEndSample = juce::jmin((int)(loopEnd * sampleRate), totalSamples);
-    int loopLengthSamples = loopEndSample - loopStartSample;
-    
-    if (loopLengthSamples <= 0)
-        return;
+    tileRequested = false;
     
-    int currentSample = static_cast<int>(currentPosition * sampleRate);
-    
-    // Handle looping within the defined region
-    if (looping)
+    if (tile.peaks == waveformPeaks && tile.colour == waveformColour)
     {
-        if (currentSample < loopStartSample)
-        {
-            currentSample = loopStartSample;
-            currentPosition = loopStart;
-        }
-        else if (currentSample >= loopEndSample)
-        {
-            currentSample = loopStartSample + ((currentSample - loopStartSample) % loopLengthSamples);
-            currentPosition = currentSample / sampleRate;
-        }
-    }
-    else if (currentSample >= loopEndSample)
-    {
-        return; // Stop at end of loop region when not looping
-    }
-    
-    int samplesToRead = juce::jmin(numSamples, loopEndSample - currentSample);
-    if (samplesToRead <= 0)
-        return;
-    
-    for (int ch = 0; ch < channelsToProcess; ++ch)
-    {
-        buffer.addFrom(ch, startSample, audioBuffer, ch, currentSample, samplesToRead, volume);
-    }
-    
-    if (inputChannels == 1 && outputChannels >= 2)
-    {
-        buffer.addFrom(1, startSample, audioBuffer, 0, currentSample, samplesToRead, volume);
-    }
-    
-    currentPosition += (double)samplesToRead / sampleRate;
-    
-    // Loop back to start when reaching end of loop region
-    if (looping && currentPosition >= loopEnd)
-    {
-        currentPosition = loopStart;
+        waveformTile = tile;
+        tileMemory.set(MemoryAccounting::bytesOf(waveformTile.image));
+        repaint();
     }
 }
 
-void AudioTrack::processWithSoundTouch(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+bool WaveformOverviewComponent::spansWholeTrack(const WaveformTile& tile) const
 {
-    const int outputChannels = buffer.getNumChannels();
-    const int inputChannels = audioBuffer.getNumChannels();
-    const int totalSamples = audioBuffer.getNumSamples();
-    const int channelsToProcess = juce::jmin(outputChannels, inputChannels);
-    
-    if (!soundTouch)
-        return;
-    
-    soundTouch->setTempo(stretchRatio);
-    
-    // Determine loop bounds
-    double loopStart = 0.0;
-    double loopEnd = getDurationInSeconds();
-    
-    if (hasCustomLoopRegion && loopEndTime > loopStartTime)
-    {
-        loopStart = loopStartTime;
-        loopEnd = loopEndTime;
-    }
-    
-    int loopStartSample = (int)(loopStart * sampleRate);
-    int loopEndSample = juce::jmin((int)(loopEnd * sampleRate), totalSamples);
-    int loopLengthSamples = loopEndSample - loopStartSample;
-    
-    if (loopLengthSamples <= 0)
-        return;
-    
-    int currentSample = static_cast<int>(currentPosition * sampleRate);
-    
-    // Handle looping within the defined region
-    if (looping)
-    {
-        if (currentSample < loopStartSample)
-        {
-            currentSample = loopStartSample;
-            currentPosition = loopStart;
-            soundTouch->clear();
-        }
-        else if (currentSample >= loopEndSample)
-        {
-            currentSample = loopStartSample + ((currentSample - loopStartSample) % loopLengthSamples);
-            currentPosition = currentSample / sampleRate;
-            soundTouch->clear();
-        }
-    }
-    else if (currentSample >= loopEndSample)
-    {
-        return; // Stop at end of loop region when not looping
-    }
-    
-    int samplesToRead = juce::jmin(numSamples * 2, loopEndSample - currentSample);
-    if (samplesToRead <= 0)
-        return;
-    
-    juce::AudioBuffer<float> inputBuffer(inputChannels, samplesToRead);
-    for (int ch = 0; ch < inputChannels; ++ch)
-    {
-        inputBuffer.copyFrom(ch, 0, audioBuffer, ch, currentSample, samplesToRead);
-    }
-    
-    if (inputChannels == 1)
-    {
-        const float* input = inputBuffer.getReadPointer(0);
-        soundTouch->putSamples(input, samplesToRead);
-    }
-    else
-    {
-        juce::AudioBuffer<float> interleavedInput(1, samplesToRead * inputChannels);
-        float* interleaved = interleavedInput.getWritePointer(0);
-        
-        for (int sample = 0; sample < samplesToRead; ++sample)
-        {
-            for (int ch = 0; ch < inputChannels; ++ch)
-            {
-                interleaved[sample * inputChannels + ch] = inputBuffer.getSample(ch, sample);
-            }
-        }
-        
-        soundTouch->putSamples(interleaved, samplesToRead);
-    }
-    
-    uint32_t receivedSamples = soundTouch->receiveSamples(stretchedBuffer.getWritePointer(0), numSamples);
-    
-    if (receivedSamples > 0)
-    {
-        if (stretchedBuffer.getNumChannels() != inputChannels ||
-            stretchedBuffer.getNumSamples() < (int)receivedSamples)
-        {
-            stretchedBuffer.setSize(inputChannels, receivedSamples, false, false, true);
-        }
-        
-        if (inputChannels == 1)
-        {
-            for (int i = 0; i < (int)receivedSamples && i < numSamples; ++i)
-            {
-                float sample = stretchedBuffer.getSample(0, i);
-                buffer.addSample(0, startSample + i, sample * volume);
-                
-                if (outputChannels >= 2)
-                {
-                    buffer.addSample(1, startSample + i, sample * volume);
-                }
-            }
-        }
-        else
-        {
-            for (int i = 0; i < (int)receivedSamples && i < numSamples; ++i)
-            {
-                for (int ch = 0; ch < channelsToProcess; ++ch)
-                {
-                    float sample = stretchedBuffer.getSample(0, i * inputChannels + ch);
-                    buffer.addSample(ch, startSample + i, sample * volume);
-                }
-            }
-        }
-    }
-    
-    currentPosition += (double)samplesToRead / sampleRate;
+    if (!tile.isValid() || tile.peaks != waveformPeaks || tile.colour != waveformColour || tile.pixelsPerSecond <= 0.0)
+        return false;
     
-    // Loop back to start when reaching end of loop region
-    if (looping && currentPosition >= loopEnd)
-    {
-        currentPosition = loopStart;
-        soundTouch->clear(); // Clear SoundTouch buffer when looping
-    }
-}
-
-double AudioTrack::getDurationInSeconds() const
-{
-    if (audioBuffer.getNumSamples() > 0 && sampleRate > 0)
-        return audioBuffer.getNumSamples() / sampleRate;
-    return 0.0;
+    const double slack = 0.5 / tile.pixelsPerSecond;
+    return tile.startTime <= slack && tile.endTime >= totalDuration - slack;
 }
 
-void AudioTrack::setLoopRegion(double startTime, double endTime)
+float WaveformOverviewComponent::timeToX(double timeInSeconds) const
 {
-    juce::ScopedLock sl(lock);
-    
-    if (startTime >= 0.0 && endTime > startTime && endTime <= getDurationInSeconds())
-    {
-        loopStartTime = startTime;
-        loopEndTime = endTime;
-        hasCustomLoopRegion = true;
-        
-        // Set position to loop start if currently outside the loop region
-        if (currentPosition < loopStartTime || currentPosition > loopEndTime)
-        {
-            currentPosition = loopStartTime;
-        }
-        
-        juce::Logger::writeToLog("Loop region set: " + juce::String(startTime, 2) + "s - " + juce::String(endTime, 2) + "s | Duration: " + juce::String(endTime - startTime, 2) + "s");
-    }
+    return totalDuration > 0.0 ? (float)(timeInSeconds * getWidth() / totalDuration) : 0.0f;
 }
 
-void AudioTrack::clearLoopRegion()
+juce::Rectangle<int> WaveformOverviewComponent::getPlayheadBounds(double positionInSeconds) const
 {
-    juce::ScopedLock sl(lock);
-    
-    hasCustomLoopRegion = false;
-    loopStartTime = 0.0;
-    loopEndTime = 0.0;
-    
-    // Reset position to beginning of full track if we were inside a custom loop
-    if (currentPosition > getDurationInSeconds())
-    {
-        currentPosition = 0.0;
-    }
-    
-    juce::Logger::writeToLog("Loop region cleared - now looping full track (" + juce::String(getDurationInSeconds(), 1) + "s)");
+    return { juce::roundToInt(timeToX(positionInSeconds)) - 1, 0, 3, getHeight() };
 }
 
 // ============================================================================
 // TrackComponent Implementation
 // ============================================================================
 
-TrackComponent::TrackComponent(AudioTrack* track, int trackNumber)
+TrackComponent::TrackComponent(AudioTrack* track, int trackNumber, ViewState& state)
     : audioTrack(track),
       trackNum(trackNumber),
+      viewState(state),
       loadButton("Load"),
       muteButton("M"),
       soloButton("S"),
       loopButton("Loop"),
-      quantizeButton("Q:8"),
+      quantizeButton("Q:" + juce::String(state.quantize)),
       bpmEditButton("Edit"),
+      warpButton("Warp"),
+      alignButton("Align"),
+      spectrogramButton("Spec"),
       zoomInButton("+"),
       zoomOutButton("-"),
       clearSelectionButton("Clear"),
@@ -1731,15 +1246,25 @@ TrackComponent::TrackComponent(AudioTrack* track, int trackNumber)
       stretchLabel("stretchLabel", "Stretch: 1.00x"),
       volumeLabel("volumeLabel", "Vol"),
       zoomLabel("zoomLabel", "Zoom"),
-      currentQuantize(8),
       editingBPM(false),
-      currentZoom(1.0)
+      shownStateVersion(0),
+      hasShownState(false)
 {
     waveformDisplay = std::make_unique<WaveformComponent>();
     addAndMakeVisible(waveformDisplay.get());
+    addAndMakeVisible(overviewDisplay);
+    
+    spectrogramDisplay = std::make_unique<SpectrogramComponent>();
+    addChildComponent(spectrogramDisplay.get());
+    
+    addAndMakeVisible(levelMeterDisplay);
+    
+    if (audioTrack)
+        levelMeterDisplay.setMeter(&audioTrack->getLevelMeter());
     
     waveformDisplay->setWaveformColour(getTrackColour(trackNumber));
-    waveformDisplay->setQuantizeValue(currentQuantize);
+    waveformDisplay->setQuantizeValue(viewState.quantize);
+    overviewDisplay.setWaveformColour(getTrackColour(trackNumber));
     
     addAndMakeVisible(loadButton);
     addAndMakeVisible(muteButton);
@@ -1747,6 +1272,9 @@ TrackComponent::TrackComponent(AudioTrack* track, int trackNumber)
     addAndMakeVisible(loopButton);
     addAndMakeVisible(quantizeButton);
     addAndMakeVisible(bpmEditButton);
+    addAndMakeVisible(warpButton);
+    addAndMakeVisible(alignButton);
+    addAndMakeVisible(spectrogramButton);
     addAndMakeVisible(zoomInButton);
     addAndMakeVisible(zoomOutButton);
     addAndMakeVisible(clearSelectionButton);
@@ -1765,6 +1293,9 @@ TrackComponent::TrackComponent(AudioTrack* track, int trackNumber)
     loopButton.onClick = [this] { loopButtonClicked(); };
     quantizeButton.onClick = [this] { quantizeButtonClicked(); };
     bpmEditButton.onClick = [this] { bpmEditButtonClicked(); };
+    warpButton.onClick = [this] { warpButtonClicked(); };
+    alignButton.onClick = [this] { alignButtonClicked(); };
+    spectrogramButton.onClick = [this] { spectrogramButtonClicked(); };
     zoomInButton.onClick = [this] { zoomInButtonClicked(); };
     zoomOutButton.onClick = [this] { zoomOutButtonClicked(); };
     clearSelectionButton.onClick = [this] { clearSelectionButtonClicked(); };
@@ -1780,12 +1311,22 @@ TrackComponent::TrackComponent(AudioTrack* track, int trackNumber)
     waveformDisplay->onPositionChanged = [this](double position) { onWaveformPositionChanged(position); };
     waveformDisplay->onBPMChanged = [this](double bpm) { onWaveformBPMChanged(bpm); };
     waveformDisplay->onSelectionChanged = [this](double start, double end) { onWaveformSelectionChanged(start, end); };
+    waveformDisplay->onVisibleRangeChanged = [this](double start, double end)
+    {
+        overviewDisplay.setVisibleRange(start, end);
+        spectrogramDisplay->setVisibleRange(start, end);
+    };
+    waveformDisplay->onWaveformTileRendered = [this](const WaveformTile& tile) { overviewDisplay.offerTile(tile); };
+    overviewDisplay.onNavigate = [this](double time) { waveformDisplay->setViewCentre(time); };
     
     muteButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
     soloButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
     loopButton.setColour(juce::TextButton::buttonColourId, juce::Colours::green.darker());
     quantizeButton.setColour(juce::TextButton::buttonColourId, juce::Colours::purple.darker());
     bpmEditButton.setColour(juce::TextButton::buttonColourId, juce::Colours::orange.darker());
+    warpButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
+    alignButton.setColour(juce::TextButton::buttonColourId, juce::Colours::teal.darker());
+    spectrogramButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
     zoomInButton.setColour(juce::TextButton::buttonColourId, juce::Colours::blue.darker());
     zoomOutButton.setColour(juce::TextButton::buttonColourId, juce::Colours::blue.darker());
     clearSelectionButton.setColour(juce::TextButton::buttonColourId, juce::Colours::red.darker());
@@ -1806,6 +1347,28 @@ TrackComponent::TrackComponent(AudioTrack* track, int trackNumber)
     trackLabel.setColour(juce::Label::textColourId, getTrackColour(trackNumber));
     
     loopButton.setToggleState(true, juce::dontSendNotification);
+    
+    spectrogramDisplay->setVisible(viewState.showSpectrogram);
+    spectrogramButton.setToggleState(viewState.showSpectrogram, juce::dontSendNotification);
+    spectrogramButton.setColour(juce::TextButton::buttonColourId,
+                              viewState.showSpectrogram ? juce::Colours::teal : juce::Colours::darkgrey);
+    
+    // A row scrolled back into view picks up where the last one left off
+    if (audioTrack && audioTrack->isLoaded())
+    {
+        updateWaveform();
+        
+        AudioTrack::State state;
+        audioTrack->readState(state);
+        
+        if (state.hasLoopRegion)
+        {
+            waveformDisplay->setSelectionRange(state.loopStart, state.loopEnd);
+            overviewDisplay.setSelectionRange(state.loopStart, state.loopEnd);
+        }
+    }
+    
+    updateTrackInfo();
 }
 
 TrackComponent::~TrackComponent()
@@ -1816,20 +1379,28 @@ TrackComponent::~TrackComponent()
     loopButton.onClick = nullptr;
     quantizeButton.onClick = nullptr;
     bpmEditButton.onClick = nullptr;
+    warpButton.onClick = nullptr;
+    alignButton.onClick = nullptr;
+    spectrogramButton.onClick = nullptr;
     zoomInButton.onClick = nullptr;
     zoomOutButton.onClick = nullptr;
     clearSelectionButton.onClick = nullptr;
     volumeSlider.onValueChange = nullptr;
     stretchSlider.onValueChange = nullptr;
     onTrackLoaded = nullptr;
+    onAlignRequested = nullptr;
+    onLoadRequested = nullptr;
     
     if (waveformDisplay)
     {
         waveformDisplay->onPositionChanged = nullptr;
         waveformDisplay->onBPMChanged = nullptr;
         waveformDisplay->onSelectionChanged = nullptr;
+        waveformDisplay->onVisibleRangeChanged = nullptr;
+        waveformDisplay->onWaveformTileRendered = nullptr;
     }
     
+    overviewDisplay.onNavigate = nullptr;
     audioTrack = nullptr;
 }
 
@@ -1875,7 +1446,14 @@ void TrackComponent::resized()
     
     area.removeFromTop(5);
     
-    waveformDisplay->setBounds(area.removeFromTop(80));
+    juce::Rectangle<int> waveformArea = area.removeFromTop(80);
+    overviewDisplay.setBounds(waveformArea.removeFromTop(14));
+    waveformArea.removeFromTop(2);
+    
+    if (spectrogramDisplay->isVisible())
+        spectrogramDisplay->setBounds(waveformArea.removeFromBottom(32));
+    
+    waveformDisplay->setBounds(waveformArea);
     
     // Zoom controls below waveform
     juce::Rectangle<int> zoomArea = area.removeFromTop(25);
@@ -1900,11 +1478,19 @@ void TrackComponent::resized()
     quantizeButton.setBounds(buttonArea.removeFromLeft(35));
     buttonArea.removeFromLeft(3);
     bpmEditButton.setBounds(buttonArea.removeFromLeft(35));
+    buttonArea.removeFromLeft(3);
+    warpButton.setBounds(buttonArea.removeFromLeft(40));
+    buttonArea.removeFromLeft(3);
+    alignButton.setBounds(buttonArea.removeFromLeft(40));
+    buttonArea.removeFromLeft(3);
+    spectrogramButton.setBounds(buttonArea.removeFromLeft(40));
     
     area.removeFromTop(8);
     
     juce::Rectangle<int> volumeArea = area.removeFromTop(20);
     volumeLabel.setBounds(volumeArea.removeFromLeft(30));
+    levelMeterDisplay.setBounds(volumeArea.removeFromRight(160));
+    volumeArea.removeFromRight(8);
     volumeSlider.setBounds(volumeArea);
     
     area.removeFromTop(5);
@@ -1916,15 +1502,14 @@ void TrackComponent::resized()
 
 void TrackComponent::zoomInButtonClicked()
 {
-    currentZoom = juce::jlimit(0.1, 20.0, currentZoom * 1.5);
+    if (!waveformDisplay)
+        return;
     
-    if (waveformDisplay)
-    {
-        waveformDisplay->setZoomFactor(currentZoom);
-    }
+    viewState.zoom = juce::jlimit(0.1, waveformDisplay->getMaxZoomFactor(), viewState.zoom * 1.5);
+    waveformDisplay->setZoomFactor(viewState.zoom);
     
-    juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) + " zoom: " + juce::String(currentZoom, 1) + "x" +
-                            (currentZoom > 1.01 ? " (drag waveform to pan)" : ""));
+    juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) + " zoom: " + juce::String(viewState.zoom, 1) + "x" +
+                            (viewState.zoom > 1.01 ? " (drag waveform to pan)" : ""));
 }
 
 void TrackComponent::clearSelectionButtonClicked()
@@ -1934,6 +1519,8 @@ void TrackComponent::clearSelectionButtonClicked()
         waveformDisplay->clearSelection();
     }
     
+    overviewDisplay.clearSelection();
+    
     if (audioTrack)
     {
         audioTrack->clearLoopRegion();
@@ -1945,15 +1532,14 @@ void TrackComponent::clearSelectionButtonClicked()
 
 void TrackComponent::zoomOutButtonClicked()
 {
-    currentZoom = juce::jlimit(0.1, 20.0, currentZoom / 1.5);
+    if (!waveformDisplay)
+        return;
     
-    if (waveformDisplay)
-    {
-        waveformDisplay->setZoomFactor(currentZoom);
-    }
+    viewState.zoom = juce::jlimit(0.1, waveformDisplay->getMaxZoomFactor(), viewState.zoom / 1.5);
+    waveformDisplay->setZoomFactor(viewState.zoom);
     
-    juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) + " zoom: " + juce::String(currentZoom, 1) + "x" +
-                            (currentZoom > 1.01 ? " (drag waveform to pan)" : ""));
+    juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) + " zoom: " + juce::String(viewState.zoom, 1) + "x" +
+                            (viewState.zoom > 1.01 ? " (drag waveform to pan)" : ""));
 }
 
 void TrackComponent::onWaveformBPMChanged(double bpm)
@@ -1977,7 +1563,10 @@ void TrackComponent::bpmEditButtonClicked()
 {
     if (audioTrack && audioTrack->isLoaded())
     {
-        showBPMEditor();
+        if (audioTrack->getTempoCandidates().size() > 1)
+            showBPMCandidates();
+        else
+            showBPMEditor();
     }
     else
     {
@@ -1987,11 +1576,68 @@ void TrackComponent::bpmEditButtonClicked()
     }
 }
 
+void TrackComponent::warpButtonClicked()
+{
+    if (audioTrack && audioTrack->isLoaded())
+    {
+        AudioTrack::State state;
+        audioTrack->readState(state);
+        
+        if (!state.hasTempoMap)
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon,
+                                                 "No Tempo Map",
+                                                 "Not enough beats were found in this track to follow its tempo.");
+            return;
+        }
+        
+        const bool follow = !state.tempoMapEnabled;
+        audioTrack->setTempoMapEnabled(follow);
+        warpButton.setToggleState(follow, juce::dontSendNotification);
+        warpButton.setColour(juce::TextButton::buttonColourId,
+                           follow ? juce::Colours::teal : juce::Colours::darkgrey);
+        
+        juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) + " tempo map " +
+                                (follow ? "enabled - following performance drift" : "disabled"));
+    }
+}
+
+void TrackComponent::spectrogramButtonClicked()
+{
+    const bool show = !spectrogramDisplay->isVisible();
+    
+    viewState.showSpectrogram = show;
+    spectrogramDisplay->setVisible(show);
+    spectrogramButton.setToggleState(show, juce::dontSendNotification);
+    spectrogramButton.setColour(juce::TextButton::buttonColourId,
+                              show ? juce::Colours::teal : juce::Colours::darkgrey);
+    resized();
+}
+
+void TrackComponent::alignButtonClicked()
+{
+    if (audioTrack && audioTrack->isLoaded())
+    {
+        if (onAlignRequested)
+        {
+            onAlignRequested();
+        }
+    }
+    else
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon,
+                                             "No Audio Loaded",
+                                             "Load an audio file first to align it.");
+    }
+}
+
 void TrackComponent::showBPMEditor()
 {
     if (!audioTrack) return;
     
-    double currentBPM = audioTrack->getDetectedBPM();
+    AudioTrack::State state;
+    audioTrack->readState(state);
+    const double currentBPM = state.detectedBPM;
     
     juce::String message = "Current detected BPM: " + juce::String(currentBPM, 1) +
                           "\n\nEnter the correct BPM for this track:" +
@@ -2014,17 +1660,7 @@ void TrackComponent::showBPMEditor()
                 
                 if (newBPM >= 60.0 && newBPM <= 200.0)
                 {
-                    if (audioTrack)
-                    {
-                        audioTrack->setManualBPM(newBPM);
-                        updateTrackInfo();
-                        updateWaveform();
-                        
-                        if (onTrackLoaded)
-                        {
-                            onTrackLoaded(newBPM);
-                        }
-                    }
+                    applyBPM(newBPM);
                 }
                 else
                 {
@@ -2037,67 +1673,207 @@ void TrackComponent::showBPMEditor()
         }), true);
 }
 
+void TrackComponent::showBPMCandidates()
+{
+    if (!audioTrack) return;
+    
+    const std::vector<TempoCandidate> candidates = audioTrack->getTempoCandidates();
+    AudioTrack::State state;
+    audioTrack->readState(state);
+    const double currentBPM = state.detectedBPM;
+    
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Detected tempi");
+    
+    for (int i = 0; i < (int)candidates.size(); ++i)
+    {
+        const TempoCandidate& candidate = candidates[(size_t)i];
+        juce::String text = juce::String(candidate.bpm, 1) + " BPM";
+        
+        if (candidate.octaveRatio == 2.0)
+            text += " (double time)";
+        else if (candidate.octaveRatio == 0.5)
+            text += " (half time)";
+        else if (candidate.octaveRatio == 1.5 || candidate.octaveRatio == 0.75)
+            text += " (dotted)";
+        else if (candidate.octaveRatio == 2.0 / 3.0 || candidate.octaveRatio == 4.0 / 3.0)
+            text += " (triplet)";
+        
+        text += " - " + juce::String((int)(candidate.confidence * 100.0)) + "%";
+        
+        menu.addItem(i + 1, text, true, std::abs(candidate.bpm - currentBPM) < 0.05);
+    }
+    
+    menu.addSeparator();
+    menu.addItem((int)candidates.size() + 1, "Enter manually...");
+    
+    juce::Component::SafePointer<TrackComponent> safeThis(this);
+    
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&bpmEditButton),
+        [safeThis, shownCandidates = candidates](int result) {
+            if (safeThis == nullptr || result == 0)
+                return;
+            
+            if (result <= (int)shownCandidates.size())
+                safeThis->applyBPM(shownCandidates[(size_t)(result - 1)].bpm);
+            else
+                safeThis->showBPMEditor();
+        });
+}
+
+void TrackComponent::applyBPM(double bpm)
+{
+    if (!audioTrack) return;
+    
+    audioTrack->setManualBPM(bpm);
+    updateTrackInfo();
+    updateWaveform();
+    
+    if (onTrackLoaded)
+    {
+        onTrackLoaded(bpm);
+    }
+}
+
 void TrackComponent::updateTrackInfo()
 {
-    if (audioTrack && audioTrack->isLoaded())
+    if (audioTrack && audioTrack->isLoadingFile())
     {
-        fileLabel.setText(audioTrack->getFileName(), juce::dontSendNotification);
+        fileLabel.setText("Loading... " + juce::String((int)(audioTrack->getLoadProgress() * 100.0)) + "%",
+                         juce::dontSendNotification);
         
-        double bpm = audioTrack->getDetectedBPM();
-        if (bpm > 0.0)
+        double provisionalBPM = audioTrack->getProvisionalBPM();
+        if (provisionalBPM > 0.0)
         {
-            bpmLabel.setText("BPM: " + juce::String(bpm, 1), juce::dontSendNotification);
-            waveformDisplay->setDetectedBPM(bpm);
+            bpmLabel.setText("BPM: ~" + juce::String(provisionalBPM, 1) + " (" +
+                            juce::String((int)(audioTrack->getProvisionalConfidence() * 100.0)) + "% sure)",
+                            juce::dontSendNotification);
         }
         else
         {
-            bpmLabel.setText("BPM: --", juce::dontSendNotification);
+            bpmLabel.setText("BPM: analysing...", juce::dontSendNotification);
         }
         
-        waveformDisplay->setPlayPosition(audioTrack->getCurrentPosition());
-        stretchSlider.setValue(audioTrack->getStretchRatio(), juce::dontSendNotification);
-        
-        // Update loop indicator based on whether there's a custom loop region
-        if (audioTrack->hasLoopRegion())
+        // The labels were borrowed for progress, so redraw everything once loading ends
+        hasShownState = false;
+        return;
+    }
+    
+    if (audioTrack == nullptr)
+        return;
+    
+    // Nothing to do unless the track published something since the last refresh
+    if (hasShownState && audioTrack->getStateVersion() == shownStateVersion)
+        return;
+    
+    AudioTrack::State state;
+    shownStateVersion = audioTrack->readState(state);
+    
+    const bool refreshAll = !hasShownState;
+    const AudioTrack::State previous = shownState;
+    shownState = state;
+    hasShownState = true;
+    
+    if (refreshAll || state.loaded != previous.loaded || state.loadCount != previous.loadCount)
+    {
+        fileLabel.setText(state.loaded ? audioTrack->getFileName() : juce::String("No file loaded"),
+                         juce::dontSendNotification);
+    }
+    
+    if (refreshAll || state.loaded != previous.loaded || state.detectedBPM != previous.detectedBPM)
+    {
+        if (state.loaded && state.detectedBPM > 0.0)
+        {
+            bpmLabel.setText("BPM: " + juce::String(state.detectedBPM, 1), juce::dontSendNotification);
+            waveformDisplay->setDetectedBPM(state.detectedBPM);
+        }
+        else
         {
-            double loopDuration = audioTrack->getLoopEnd() - audioTrack->getLoopStart();
-            juce::String loopInfo = "Loop: " + juce::String(loopDuration, 1) + "s region";
-            // We could add this info to a label if desired
+            bpmLabel.setText("BPM: --", juce::dontSendNotification);
         }
     }
-    else
+    
+    if (state.loaded)
     {
-        fileLabel.setText("No file loaded", juce::dontSendNotification);
-        bpmLabel.setText("BPM: --", juce::dontSendNotification);
+        // Repaints just the playhead columns, and only when it moves a pixel
+        waveformDisplay->setPlayPosition(state.position);
+        overviewDisplay.setPlayPosition(state.position);
     }
     
-    if (audioTrack)
+    if (refreshAll || state.stretchRatio != previous.stretchRatio)
+        stretchSlider.setValue(state.stretchRatio, juce::dontSendNotification);
+    
+    // Colours follow the state too, since a rebuilt row never saw the clicks that set it
+    if (refreshAll || state.muted != previous.muted)
+    {
+        muteButton.setToggleState(state.muted, juce::dontSendNotification);
+        muteButton.setColour(juce::TextButton::buttonColourId,
+                           state.muted ? juce::Colours::red : juce::Colours::darkgrey);
+    }
+    
+    if (refreshAll || state.solo != previous.solo)
+    {
+        soloButton.setToggleState(state.solo, juce::dontSendNotification);
+        soloButton.setColour(juce::TextButton::buttonColourId,
+                           state.solo ? juce::Colours::yellow : juce::Colours::darkgrey);
+    }
+    
+    if (refreshAll || state.volume != previous.volume)
+        volumeSlider.setValue(state.volume, juce::dontSendNotification);
+    
+    if (refreshAll || state.looping != previous.looping)
+    {
+        loopButton.setToggleState(state.looping, juce::dontSendNotification);
+        loopButton.setColour(juce::TextButton::buttonColourId,
+                           state.looping ? juce::Colours::green : juce::Colours::darkgrey);
+        waveformDisplay->setLooping(state.looping);
+    }
+    
+    if (refreshAll || state.tempoMapEnabled != previous.tempoMapEnabled)
+    {
+        warpButton.setToggleState(state.tempoMapEnabled, juce::dontSendNotification);
+        warpButton.setColour(juce::TextButton::buttonColourId,
+                           state.tempoMapEnabled ? juce::Colours::teal : juce::Colours::darkgrey);
+    }
+    
+    // Effective ratio moves every block while warping, so compare it at display precision
+    if (refreshAll || state.stretchRatio != previous.stretchRatio || state.tempoMapEnabled != previous.tempoMapEnabled
+        || (state.tempoMapEnabled && juce::roundToInt(state.effectiveStretchRatio * 100.0) != juce::roundToInt(previous.effectiveStretchRatio * 100.0)))
     {
-        muteButton.setToggleState(audioTrack->isMuted(), juce::dontSendNotification);
-        soloButton.setToggleState(audioTrack->isSolo(), juce::dontSendNotification);
-        loopButton.setToggleState(audioTrack->isLooping(), juce::dontSendNotification);
-        volumeSlider.setValue(audioTrack->getVolume(), juce::dontSendNotification);
+        juce::String stretchText = "Stretch: " + juce::String(state.stretchRatio, 2) + "x";
         
-        waveformDisplay->setLooping(audioTrack->isLooping());
+        if (state.tempoMapEnabled)
+        {
+            stretchText += " (warp " + juce::String(state.effectiveStretchRatio, 2) + "x)";
+        }
         
-        stretchLabel.setText("Stretch: " + juce::String(audioTrack->getStretchRatio(), 2) + "x",
-                           juce::dontSendNotification);
+        stretchLabel.setText(stretchText, juce::dontSendNotification);
     }
 }
 
+void TrackComponent::updateMeter(bool transportPlaying)
+{
+    // updateTrackInfo has just read the snapshot, so the mute state is current
+    levelMeterDisplay.refresh(transportPlaying && hasShownState && !shownState.muted);
+}
+
 void TrackComponent::updateWaveform()
 {
     if (audioTrack && audioTrack->isLoaded())
     {
-        waveformDisplay->setWaveformData(audioTrack->getWaveformPeaks(),
-                                       44100.0,
-                                       audioTrack->getDurationInSeconds() * 44100.0);
-        waveformDisplay->setDuration(audioTrack->getDurationInSeconds());
-        waveformDisplay->setDetectedBPM(audioTrack->getDetectedBPM());
+        AudioTrack::State state;
+        audioTrack->readState(state);
         
-        // Reset zoom when loading new waveform
-        currentZoom = 1.0;
-        waveformDisplay->setZoomFactor(currentZoom);
+        std::shared_ptr<const WaveformPeaks> peaks = audioTrack->getWaveformPeaks();
+        overviewDisplay.setWaveformData(peaks, audioTrack->getSampleRate(), state.durationInSeconds);
+        waveformDisplay->setWaveformData(peaks,
+                                       audioTrack->getSampleRate(),
+                                       peaks != nullptr ? peaks->getNumSamples() : 0);
+        spectrogramDisplay->setData(audioTrack->getSpectrogram(), peaks);
+        waveformDisplay->setSnapIndex(audioTrack->getSnapIndex());
+        waveformDisplay->setDuration(state.durationInSeconds);
+        waveformDisplay->setDetectedBPM(state.detectedBPM);
+        waveformDisplay->setZoomFactor(viewState.zoom);
     }
 }
 
@@ -2109,116 +1885,243 @@ void TrackComponent::loadButtonClicked()
     
     auto chooserFlags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
     
-    chooser->launchAsync(chooserFlags, [this, chooser](const juce::FileChooser& fc)
+    juce::Component::SafePointer<TrackComponent> safeThis(this);
+    
+    chooser->launchAsync(chooserFlags, [safeThis, chooser](const juce::FileChooser& fc)
     {
         auto file = fc.getResult();
-        if (file.existsAsFile() && audioTrack)
+        if (safeThis != nullptr && file.existsAsFile() && safeThis->onLoadRequested)
         {
-            audioTrack->loadAudioFile(file);
-            
-            if (onTrackLoaded && audioTrack->getDetectedBPM() > 0.0)
-            {
-                onTrackLoaded(audioTrack->getDetectedBPM());
-            }
-            
-            updateTrackInfo();
-            updateWaveform();
+            // The load outlives this row if it scrolls away, so the owner sees it through
+            safeThis->onLoadRequested(file);
+            safeThis->updateTrackInfo();
         }
     });
 }
 
 void TrackComponent::muteButtonClicked()
 {
-    if (audioTrack)
-    {
-        audioTrack->setMuted(!audioTrack->isMuted());
-        muteButton.setToggleState(audioTrack->isMuted(), juce::dontSendNotification);
-        muteButton.setColour(juce::TextButton::buttonColourId,
-                           audioTrack->isMuted() ? juce::Colours::red : juce::Colours::darkgrey);
-    }
+    if (audioTrack)
+    {
+        AudioTrack::State state;
+        audioTrack->readState(state);
+        
+        const bool mute = !state.muted;
+        audioTrack->setMuted(mute);
+        muteButton.setToggleState(mute, juce::dontSendNotification);
+        muteButton.setColour(juce::TextButton::buttonColourId,
+                           mute ? juce::Colours::red : juce::Colours::darkgrey);
+    }
+}
+
+void TrackComponent::soloButtonClicked()
+{
+    if (audioTrack)
+    {
+        AudioTrack::State state;
+        audioTrack->readState(state);
+        
+        const bool solo = !state.solo;
+        audioTrack->setSolo(solo);
+        soloButton.setToggleState(solo, juce::dontSendNotification);
+        soloButton.setColour(juce::TextButton::buttonColourId,
+                           solo ? juce::Colours::yellow : juce::Colours::darkgrey);
+    }
+}
+
+void TrackComponent::loopButtonClicked()
+{
+    if (audioTrack)
+    {
+        AudioTrack::State state;
+        audioTrack->readState(state);
+        
+        const bool loop = !state.looping;
+        audioTrack->setLooping(loop);
+        loopButton.setToggleState(loop, juce::dontSendNotification);
+        loopButton.setColour(juce::TextButton::buttonColourId,
+                           loop ? juce::Colours::green : juce::Colours::darkgrey);
+        
+        if (waveformDisplay)
+            waveformDisplay->setLooping(loop);
+    }
+}
+
+void TrackComponent::volumeSliderChanged()
+{
+    if (audioTrack)
+    {
+        audioTrack->setVolume(static_cast<float>(volumeSlider.getValue()));
+    }
+}
+
+void TrackComponent::stretchSliderChanged()
+{
+    if (audioTrack)
+    {
+        audioTrack->setStretchRatio(stretchSlider.getValue());
+        stretchLabel.setText("Stretch: " + juce::String(stretchSlider.getValue(), 2) + "x",
+                           juce::dontSendNotification);
+    }
+}
+
+void TrackComponent::quantizeButtonClicked()
+{
+    switch (viewState.quantize)
+    {
+        case 4:  viewState.quantize = 8;  break;
+        case 8:  viewState.quantize = 16; break;
+        case 16: viewState.quantize = 32; break;
+        case 32: viewState.quantize = 4;  break;
+        default: viewState.quantize = 8;  break;
+    }
+    
+    quantizeButton.setButtonText("Q:" + juce::String(viewState.quantize));
+    
+    if (waveformDisplay)
+    {
+        waveformDisplay->setQuantizeValue(viewState.quantize);
+    }
+}
+
+void TrackComponent::onWaveformPositionChanged(double position)
+{
+    if (audioTrack)
+    {
+        audioTrack->setPosition(position);
+    }
+}
+
+void TrackComponent::onWaveformSelectionChanged(double startTime, double endTime)
+{
+    if (audioTrack)
+    {
+        audioTrack->setLoopRegion(startTime, endTime);
+        
+        // The track moves loop points onto zero crossings; show where they really are
+        AudioTrack::State state;
+        audioTrack->readState(state);
+        
+        if (state.hasLoopRegion)
+        {
+            startTime = state.loopStart;
+            endTime = state.loopEnd;
+            waveformDisplay->setSelectionRange(startTime, endTime);
+        }
+        
+        juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) +
+                                " loop region set: " + juce::String(startTime, 2) + "s - " + juce::String(endTime, 2) + "s | " +
+                                "Will loop only this region when playing");
+    }
+    
+    overviewDisplay.setSelectionRange(startTime, endTime);
+}
+
+// ============================================================================
+// TrackListComponent Implementation
+// ============================================================================
+
+TrackListComponent::TrackListComponent()
+{
+    setViewedComponent(&rowContainer, false);
+    setScrollBarsShown(true, false);
+}
+
+TrackListComponent::~TrackListComponent()
+{
+    onRowCreated = nullptr;
+    rows.clear();
+    setViewedComponent(nullptr, false);
 }
 
-void TrackComponent::soloButtonClicked()
+void TrackListComponent::resized()
 {
-    if (audioTrack)
-    {
-        audioTrack->setSolo(!audioTrack->isSolo());
-        soloButton.setToggleState(audioTrack->isSolo(), juce::dontSendNotification);
-        soloButton.setColour(juce::TextButton::buttonColourId,
-                           audioTrack->isSolo() ? juce::Colours::yellow : juce::Colours::darkgrey);
-    }
+    juce::Viewport::resized();
+    
+    rowContainer.setSize(getWidth(), (int)audioTracks.size() * rowHeight);
+    updateRows();
 }
 
-void TrackComponent::loopButtonClicked()
+void TrackListComponent::visibleAreaChanged(const juce::Rectangle<int>& newVisibleArea)
 {
-    if (audioTrack)
-    {
-        audioTrack->setLooping(!audioTrack->isLooping());
-        loopButton.setToggleState(audioTrack->isLooping(), juce::dontSendNotification);
-        loopButton.setColour(juce::TextButton::buttonColourId,
-                           audioTrack->isLooping() ? juce::Colours::green : juce::Colours::darkgrey);
-                           
-        waveformDisplay->setLooping(audioTrack->isLooping());
-    }
+    juce::ignoreUnused(newVisibleArea);
+    updateRows();
 }
 
-void TrackComponent::volumeSliderChanged()
+void TrackListComponent::setTracks(const std::vector<AudioTrack*>& tracks)
 {
-    if (audioTrack)
-    {
-        audioTrack->setVolume(static_cast<float>(volumeSlider.getValue()));
-    }
+    rows.clear();
+    audioTracks = tracks;
+    viewStates.assign(tracks.size(), TrackComponent::ViewState());
+    
+    rowContainer.setSize(getWidth(), (int)audioTracks.size() * rowHeight);
+    updateRows();
 }
 
-void TrackComponent::stretchSliderChanged()
+void TrackListComponent::refreshRows(bool transportPlaying)
 {
-    if (audioTrack)
+    for (auto& row : rows)
     {
-        audioTrack->setStretchRatio(stretchSlider.getValue());
-        stretchLabel.setText("Stretch: " + juce::String(stretchSlider.getValue(), 2) + "x",
-                           juce::dontSendNotification);
+        row.second->updateTrackInfo();
+        row.second->updateMeter(transportPlaying);
     }
 }
 
-void TrackComponent::quantizeButtonClicked()
+void TrackListComponent::trackLoaded(int trackIndex)
 {
-    switch (currentQuantize)
-    {
-        case 4:  currentQuantize = 8;  break;
-        case 8:  currentQuantize = 16; break;
-        case 16: currentQuantize = 32; break;
-        case 32: currentQuantize = 4;  break;
-        default: currentQuantize = 8;  break;
-    }
+    if (trackIndex < 0 || trackIndex >= (int)viewStates.size())
+        return;
     
-    quantizeButton.setButtonText("Q:" + juce::String(currentQuantize));
+    // A new file starts fully zoomed out
+    viewStates[(size_t)trackIndex].zoom = 1.0;
     
-    if (waveformDisplay)
+    auto row = rows.find(trackIndex);
+    
+    if (row != rows.end())
     {
-        waveformDisplay->setQuantizeValue(currentQuantize);
+        row->second->updateTrackInfo();
+        row->second->updateWaveform();
     }
 }
 
-void TrackComponent::onWaveformPositionChanged(double position)
+void TrackListComponent::updateRows()
 {
-    if (audioTrack)
+    const int numTracks = (int)audioTracks.size();
+    const juce::Rectangle<int> viewArea = getViewArea();
+    const int firstRow = juce::jmax(0, viewArea.getY() / rowHeight - 1);
+    const int lastRow = juce::jmin(numTracks - 1, viewArea.getBottom() / rowHeight + 1);
+    
+    for (auto row = rows.begin(); row != rows.end();)
     {
-        audioTrack->setPosition(position);
+        if (row->first < firstRow || row->first > lastRow)
+            row = rows.erase(row);
+        else
+            ++row;
     }
-}
-
-void TrackComponent::onWaveformSelectionChanged(double startTime, double endTime)
-{
-    if (audioTrack)
+    
+    for (int i = firstRow; i <= lastRow; ++i)
     {
-        audioTrack->setLoopRegion(startTime, endTime);
+        std::unique_ptr<TrackComponent>& row = rows[i];
         
-        juce::Logger::writeToLog("Track " + juce::String(trackNum + 1) +
-                                " loop region set: " + juce::String(startTime, 2) + "s - " + juce::String(endTime, 2) + "s | " +
-                                "Will loop only this region when playing");
+        if (row == nullptr)
+        {
+            row = std::make_unique<TrackComponent>(audioTracks[(size_t)i], i, viewStates[(size_t)i]);
+            
+            if (onRowCreated)
+                onRowCreated(*row, i);
+            
+            rowContainer.addAndMakeVisible(row.get());
+        }
+        
+        row->setBounds(getRowBounds(i));
     }
 }
 
+juce::Rectangle<int> TrackListComponent::getRowBounds(int trackIndex) const
+{
+    return { 0, trackIndex * rowHeight, getWidth() - 20, rowHeight - 10 };
+}
+
 // ============================================================================
 // TransportComponent Implementation
 // ============================================================================
@@ -2229,6 +2132,9 @@ TransportComponent::TransportComponent()
       recordButton("Rec"),
       autoSyncButton("Auto Sync"),
       metronomeButton("Metro"),
+      bounceButton("Bounce"),
+      stemsButton("Stems"),
+      profilerButton("DSP"),
       tempoSlider(juce::Slider::LinearHorizontal, juce::Slider::TextBoxRight),
       tempoLabel("tempoLabel", "Master BPM:"),
       positionLabel("positionLabel", "00:00"),
@@ -2245,6 +2151,9 @@ TransportComponent::TransportComponent()
     addAndMakeVisible(recordButton);
     addAndMakeVisible(autoSyncButton);
     addAndMakeVisible(metronomeButton);
+    addAndMakeVisible(bounceButton);
+    addAndMakeVisible(stemsButton);
+    addAndMakeVisible(profilerButton);
     addAndMakeVisible(tempoSlider);
     addAndMakeVisible(tempoLabel);
     addAndMakeVisible(positionLabel);
@@ -2255,6 +2164,9 @@ TransportComponent::TransportComponent()
     recordButton.onClick = [this] { recordButtonClicked(); };
     autoSyncButton.onClick = [this] { autoSyncButtonClicked(); };
     metronomeButton.onClick = [this] { metronomeButtonClicked(); };
+    bounceButton.onClick = [this] { bounceButtonClicked(); };
+    stemsButton.onClick = [this] { stemsButtonClicked(); };
+    profilerButton.onClick = [this] { profilerButtonClicked(); };
     
     tempoSlider.setRange(60.0, 200.0, 1.0);
     tempoSlider.setValue(120.0);
@@ -2265,6 +2177,10 @@ TransportComponent::TransportComponent()
     recordButton.setColour(juce::TextButton::buttonColourId, juce::Colours::red.darker());
     autoSyncButton.setColour(juce::TextButton::buttonColourId, juce::Colours::blue.darker());
     metronomeButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
+    bounceButton.setColour(juce::TextButton::buttonColourId, juce::Colours::purple.darker());
+    stemsButton.setColour(juce::TextButton::buttonColourId, juce::Colours::purple.darker());
+    profilerButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
+    profilerButton.setTooltip("Show where the audio callback spends its time and the memory each part holds");
     
     tempoLabel.setFont(juce::Font(14.0f, juce::Font::bold));
     positionLabel.setFont(juce::Font(16.0f, juce::Font::bold));
@@ -2282,12 +2198,18 @@ TransportComponent::~TransportComponent()
     onTempoChanged = nullptr;
     onAutoSync = nullptr;
     onMetronome = nullptr;
+    onBounce = nullptr;
+    onExportStems = nullptr;
+    onToggleProfiler = nullptr;
     
     playButton.onClick = nullptr;
     stopButton.onClick = nullptr;
     recordButton.onClick = nullptr;
     autoSyncButton.onClick = nullptr;
     metronomeButton.onClick = nullptr;
+    bounceButton.onClick = nullptr;
+    stemsButton.onClick = nullptr;
+    profilerButton.onClick = nullptr;
     tempoSlider.onValueChange = nullptr;
 }
 
@@ -2308,7 +2230,7 @@ void TransportComponent::resized()
 {
     juce::Rectangle<int> area = getLocalBounds().reduced(8);
     
-    juce::Rectangle<int> buttonArea = area.removeFromLeft(350);
+    juce::Rectangle<int> buttonArea = area.removeFromLeft(550);
     playButton.setBounds(buttonArea.removeFromLeft(60));
     buttonArea.removeFromLeft(5);
     stopButton.setBounds(buttonArea.removeFromLeft(60));
@@ -2318,6 +2240,12 @@ void TransportComponent::resized()
     autoSyncButton.setBounds(buttonArea.removeFromLeft(80));
     buttonArea.removeFromLeft(5);
     metronomeButton.setBounds(buttonArea.removeFromLeft(60));
+    buttonArea.removeFromLeft(5);
+    bounceButton.setBounds(buttonArea.removeFromLeft(70));
+    buttonArea.removeFromLeft(5);
+    stemsButton.setBounds(buttonArea.removeFromLeft(70));
+    buttonArea.removeFromLeft(5);
+    profilerButton.setBounds(buttonArea.removeFromLeft(45));
     
     area.removeFromLeft(20);
     
@@ -2417,6 +2345,47 @@ void TransportComponent::setMetronomeEnabled(bool enabled)
                              enabled ? juce::Colours::orange : juce::Colours::darkgrey);
 }
 
+void TransportComponent::setBounceProgress(bool isBouncing, double progress)
+{
+    bounceButton.setButtonText(isBouncing ? juce::String(juce::roundToInt(progress * 100.0)) + "%" : juce::String("Bounce"));
+    bounceButton.setColour(juce::TextButton::buttonColourId,
+                           isBouncing ? juce::Colours::purple : juce::Colours::purple.darker());
+    bounceButton.setTooltip(isBouncing ? "Click to cancel the bounce" : "Render the mix to a file");
+}
+
+void TransportComponent::setStemExportProgress(bool isExporting, double progress)
+{
+    stemsButton.setButtonText(isExporting ? juce::String(juce::roundToInt(progress * 100.0)) + "%" : juce::String("Stems"));
+    stemsButton.setColour(juce::TextButton::buttonColourId,
+                          isExporting ? juce::Colours::purple : juce::Colours::purple.darker());
+    stemsButton.setTooltip(isExporting ? "Click to cancel the export" : "Export each track to its own file");
+}
+
+void TransportComponent::setProfilerVisible(bool isVisible)
+{
+    profilerButton.setToggleState(isVisible, juce::dontSendNotification);
+    profilerButton.setColour(juce::TextButton::buttonColourId,
+                             isVisible ? juce::Colours::green.darker() : juce::Colours::darkgrey);
+}
+
+void TransportComponent::bounceButtonClicked()
+{
+    if (onBounce)
+        onBounce();
+}
+
+void TransportComponent::stemsButtonClicked()
+{
+    if (onExportStems)
+        onExportStems();
+}
+
+void TransportComponent::profilerButtonClicked()
+{
+    if (onToggleProfiler)
+        onToggleProfiler();
+}
+
 void TransportComponent::tempoSliderChanged()
 {
     if (onTempoChanged)
@@ -2428,17 +2397,11 @@ void TransportComponent::tempoSliderChanged()
 // ============================================================================
 
 MainComponent::MainComponent()
-    : masterTempo(120.0),
-      previousMasterTempo(120.0),
-      currentPlayPosition(0.0),
-      isPlaying(false),
+    : bouncer(engine),
+      stemExporter(engine),
       isRecording(false),
       autoSyncEnabled(true),
-      metronomeEnabled(false),
-      metronomePhase(0.0),
-      metronomeBeatInterval(60.0 / 120.0),
-      lastBeatTime(0.0),
-      metronomeVolume(0.5f)
+      vBlankAttachment(this, [this] { refreshDisplay(); })
 {
     setupTracks();
     setupTransport();
@@ -2446,15 +2409,16 @@ MainComponent::MainComponent()
     
     setSize(1200, 900);
     setAudioChannels(0, 2);
-    
-    startTimer(50);
 }
 
 MainComponent::~MainComponent()
 {
-    stopTimer();
+    vBlankAttachment = {};
     shutdownAudio();
     
+    // Peaks for the whole session, to compare runs without opening the panel
+    juce::Logger::writeToLog(MemoryAccounting::getSummary());
+    
     if (transportComponent)
     {
         transportComponent->onPlay = nullptr;
@@ -2463,71 +2427,26 @@ MainComponent::~MainComponent()
         transportComponent->onTempoChanged = nullptr;
         transportComponent->onAutoSync = nullptr;
         transportComponent->onMetronome = nullptr;
+        transportComponent->onBounce = nullptr;
+        transportComponent->onExportStems = nullptr;
+        transportComponent->onToggleProfiler = nullptr;
     }
     
-    for (auto& track : audioTracks)
-    {
-        if (track)
-        {
-            track.reset();
-        }
-    }
-    
-    for (auto& trackComp : trackComponents)
-    {
-        if (trackComp)
-        {
-            trackComp.reset();
-        }
-    }
+    // Rows point at the engine's tracks, so they go first
+    trackList.setTracks({});
+    trackList.onRowCreated = nullptr;
     
     transportComponent.reset();
 }
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    juce::ignoreUnused(samplesPerBlockExpected, sampleRate);
+    engine.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    juce::ScopedLock sl(audioLock);
-    
-    bufferToFill.clearActiveBufferRegion();
-    
-    if (!isPlaying)
-        return;
-    
-    const int numSamples = bufferToFill.numSamples;
-    
-    bool hasSolo = false;
-    for (auto& track : audioTracks)
-    {
-        if (track && track->isSolo())
-        {
-            hasSolo = true;
-            break;
-        }
-    }
-    
-    for (auto& track : audioTracks)
-    {
-        if (track && track->isLoaded())
-        {
-            if (track->isMuted() || (hasSolo && !track->isSolo()))
-                continue;
-                
-            track->processBlock(*bufferToFill.buffer, bufferToFill.startSample, numSamples);
-        }
-    }
-    
-    if (metronomeEnabled)
-    {
-        processMetronome(*bufferToFill.buffer, numSamples);
-    }
-    
-    const double sampleRate = 44100.0;
-    currentPlayPosition += numSamples / sampleRate;
+    engine.processBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
 }
 
 void MainComponent::releaseResources()
@@ -2550,76 +2469,57 @@ void MainComponent::resized()
     
     area.removeFromTop(25);
     
-    transportComponent->setBounds(area.removeFromTop(80));
-    
-    tracksViewport.setBounds(area);
+    juce::Rectangle<int> transportArea = area.removeFromTop(80);
+    masterMeterDisplay.setBounds(transportArea.removeFromRight(200).reduced(10, 25));
+    transportComponent->setBounds(transportArea);
     
-    int trackHeight = 250;
-    tracksContainer.setSize(getWidth(), maxTracks * trackHeight);
-    
-    for (int i = 0; i < maxTracks; ++i)
+    if (profilerPanel.isVisible())
     {
-        trackComponents[i]->setBounds(0, i * trackHeight, getWidth() - 20, trackHeight - 10);
+        juce::Rectangle<int> diagnosticsArea = area.removeFromBottom(ProfilerComponent::preferredHeight);
+        memoryPanel.setBounds(diagnosticsArea.removeFromRight(MemoryComponent::preferredWidth));
+        profilerPanel.setBounds(diagnosticsArea);
     }
+    
+    trackList.setBounds(area);
 }
 
-void MainComponent::timerCallback()
+void MainComponent::refreshDisplay()
 {
+    TraceRecorder::Scope trace("refreshDisplay", "ui");
+    
+    // Called once per display frame; only rows on screen exist, and those whose track's
+    // state version has not moved return straight away
     if (transportComponent)
     {
-        transportComponent->setPosition(currentPlayPosition);
+        transportComponent->setPosition(engine.getPlayPosition());
+        transportComponent->setBounceProgress(bouncer.isRendering(), bouncer.getProgress());
+        transportComponent->setStemExportProgress(stemExporter.isExporting(), stemExporter.getProgress());
     }
     
-    for (auto& trackComp : trackComponents)
+    masterMeterDisplay.refresh(engine.isPlaying());
+    trackList.refreshRows(engine.isPlaying());
+    
+    if (profilerPanel.isVisible())
     {
-        if (trackComp)
-        {
-            trackComp->updateTrackInfo();
-        }
+        profilerPanel.setDeviceXRunCount(deviceManager.getXRunCount());
+        profilerPanel.refresh();
+        memoryPanel.refresh();
     }
 }
 
 void MainComponent::play()
 {
-    juce::ScopedLock sl(audioLock);
-    
-    if (!isPlaying)
-    {
-        isPlaying = true;
-        
-        for (auto& track : audioTracks)
-        {
-            if (track)
-            {
-                track->setPosition(currentPlayPosition);
-            }
-        }
-    }
-    else
-    {
-        isPlaying = false;
-    }
+    engine.setPlaying(!engine.isPlaying());
     
     if (transportComponent)
     {
-        transportComponent->setPlaying(isPlaying);
+        transportComponent->setPlaying(engine.isPlaying());
     }
 }
 
 void MainComponent::stop()
 {
-    juce::ScopedLock sl(audioLock);
-    
-    isPlaying = false;
-    currentPlayPosition = 0.0;
-    
-    for (auto& track : audioTracks)
-    {
-        if (track)
-        {
-            track->reset();
-        }
-    }
+    engine.stop();
     
     if (transportComponent)
     {
@@ -2640,67 +2540,12 @@ void MainComponent::record()
 
 void MainComponent::setTempo(double bpm)
 {
-    juce::ScopedLock sl(audioLock);
-    
-    double scaleFactor = bpm / previousMasterTempo;
-    
-    for (auto& track : audioTracks)
-    {
-        if (track && track->isLoaded())
-        {
-            track->scaleStretchRatio(scaleFactor);
-        }
-    }
-    
-    previousMasterTempo = masterTempo;
-    masterTempo = bpm;
-    
-    metronomeBeatInterval = 60.0 / bpm;
-    
-    for (auto& track : audioTracks)
-    {
-        if (track)
-        {
-            track->setMasterBPM(bpm);
-        }
-    }
-    
-    if (transportComponent)
-    {
-        transportComponent->setTempo(bpm);
-    }
-}
-
-void MainComponent::setInitialMasterBPM(double bpm, AudioTrack* definingTrack)
-{
-    juce::ScopedLock sl(audioLock);
-    
-    previousMasterTempo = masterTempo;
-    masterTempo = bpm;
-    
-    metronomeBeatInterval = 60.0 / bpm;
-    
-    if (definingTrack)
-    {
-        definingTrack->setStretchRatio(1.0);
-        definingTrack->setMasterBPM(bpm);
-    }
-    
-    for (auto& track : audioTracks)
-    {
-        if (track && track.get() != definingTrack)
-        {
-            track->setMasterBPM(bpm);
-        }
-    }
+    engine.setTempo(bpm);
     
     if (transportComponent)
     {
         transportComponent->setTempo(bpm);
     }
-    
-    juce::Logger::writeToLog("Initial Master BPM set to: " + juce::String(bpm, 1) +
-                            " by first loaded track (stretch factor: 1.00)");
 }
 
 void MainComponent::autoSyncAllTracks()
@@ -2709,7 +2554,7 @@ void MainComponent::autoSyncAllTracks()
     
     if (autoSyncEnabled)
     {
-        double avgBPM = findAverageBPM();
+        double avgBPM = engine.findAverageBPM();
         if (avgBPM > 0.0)
         {
             setTempo(avgBPM);
@@ -2717,156 +2562,242 @@ void MainComponent::autoSyncAllTracks()
     }
 }
 
-void MainComponent::updatePlayPosition()
+void MainComponent::loadTrack(int trackIndex, const juce::File& file)
 {
-    juce::ScopedLock sl(audioLock);
+    juce::Component::SafePointer<MainComponent> safeThis(this);
     
-    for (auto& track : audioTracks)
+    // Decoding runs in the background; the BPM label shows the provisional estimate meanwhile
+    engine.loadTrack(trackIndex, file, [safeThis, trackIndex]
     {
-        if (track)
+        if (safeThis != nullptr)
         {
-            track->setPosition(currentPlayPosition);
+            safeThis->trackFileLoaded(trackIndex);
         }
-    }
-}
-
-void MainComponent::setTrackPosition(int trackIndex, double position)
-{
-    if (trackIndex >= 0 && trackIndex < maxTracks && audioTracks[trackIndex])
-    {
-        audioTracks[trackIndex]->setPosition(position);
-        currentPlayPosition = position;
-    }
+    });
 }
 
-double MainComponent::findAverageBPM()
+void MainComponent::trackFileLoaded(int trackIndex)
 {
-    std::vector<double> bpms;
-    
-    for (auto& track : audioTracks)
-    {
-        if (track && track->isLoaded())
-        {
-            double bpm = track->getDetectedBPM();
-            if (bpm > 60.0 && bpm < 200.0)
-            {
-                bpms.push_back(bpm);
-            }
-        }
-    }
+    TraceRecorder::Scope trace("trackFileLoaded UI", "ui");
     
-    if (bpms.empty())
-        return 0.0;
+    engine.trackFileLoaded(trackIndex);
     
-    double sum = 0.0;
-    for (double bpm : bpms)
+    if (transportComponent)
     {
-        sum += bpm;
+        transportComponent->setTempo(engine.getMasterTempo());
     }
     
-    return sum / bpms.size();
+    trackList.trackLoaded(trackIndex);
 }
 
-void MainComponent::syncNewTrackToMaster(AudioTrack* track)
+void MainComponent::toggleMetronome()
 {
-    if (track && track->isLoaded())
+    engine.setMetronomeEnabled(!engine.isMetronomeEnabled());
+    
+    if (transportComponent)
     {
-        track->setMasterBPM(masterTempo);
-        track->autoSyncToMaster();
+        transportComponent->setMetronomeEnabled(engine.isMetronomeEnabled());
     }
 }
 
-void MainComponent::toggleMetronome()
+void MainComponent::bounce()
 {
-    metronomeEnabled = !metronomeEnabled;
+    if (bouncer.isRendering())
+    {
+        bouncer.cancel();
+        return;
+    }
     
-    if (transportComponent)
+    if (stemExporter.isExporting())
+        return;
+    
+    const double defaultLength = getLongestLoopLength();
+    
+    if (defaultLength <= 0.0)
     {
-        transportComponent->setMetronomeEnabled(metronomeEnabled);
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Bounce", "Load a track first.");
+        return;
     }
     
-    metronomePhase = 0.0;
-    lastBeatTime = 0.0;
+    auto* window = new juce::AlertWindow("Bounce", "Renders the mix from the start, as fast as possible.",
+                                         juce::AlertWindow::NoIcon);
+    window->addTextEditor("length", juce::String(defaultLength, 1), "Length (seconds):");
+    window->addButton("Choose File...", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+    
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    
+    window->enterModalState(true, juce::ModalCallbackFunction::create([safeThis, window](int result)
+    {
+        if (result == 0 || safeThis == nullptr)
+            return;
+        
+        const double lengthInSeconds = window->getTextEditorContents("length").getDoubleValue();
+        
+        if (lengthInSeconds <= 0.0)
+            return;
+        
+        auto chooser = std::make_shared<juce::FileChooser>("Bounce to...", juce::File(), "*.wav;*.aiff;*.flac");
+        
+        chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                 | juce::FileBrowserComponent::warnAboutOverwriting,
+                             [safeThis, chooser, lengthInSeconds](const juce::FileChooser& fc)
+        {
+            juce::File file = fc.getResult();
+            
+            if (safeThis != nullptr && file != juce::File())
+            {
+                safeThis->startBounce(file.hasFileExtension("wav;aif;aiff;flac") ? file : file.withFileExtension("wav"),
+                                      lengthInSeconds);
+            }
+        });
+    }), true);
 }
 
-void MainComponent::processMetronome(juce::AudioBuffer<float>& buffer, int numSamples)
+void MainComponent::startBounce(const juce::File& file, double lengthInSeconds)
 {
-    if (!metronomeEnabled || !isPlaying)
-        return;
+    OfflineRenderer::Settings settings;
+    settings.lengthInSeconds = lengthInSeconds;
     
-    const double sampleRate = 44100.0;
-    metronomeBeatInterval = 60.0 / masterTempo;
+    // The bounce starts from the top and leaves the transport stopped
+    stop();
     
-    for (int sample = 0; sample < numSamples; ++sample)
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    
+    bouncer.renderAsync(file, settings, [safeThis, file](juce::Result result)
     {
-        double currentTime = currentPlayPosition + (sample / sampleRate);
+        if (safeThis == nullptr)
+            return;
+        
+        safeThis->stop();
         
-        double timeSinceLastBeat = currentTime - lastBeatTime;
-        if (timeSinceLastBeat >= metronomeBeatInterval)
+        if (result.failed())
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Bounce", result.getErrorMessage());
+        }
+        else
         {
-            lastBeatTime = currentTime;
-            metronomePhase = 0.0;
+            juce::Logger::writeToLog("Bounced the mix to " + file.getFullPathName());
         }
+    });
+}
+
+double MainComponent::getLongestLoopLength() const
+{
+    double longest = 0.0;
+    
+    for (int i = 0; i < StretcherEngine::maxTracks; ++i)
+    {
+        AudioTrack* track = engine.getTrack(i);
+        
+        if (track == nullptr)
+            continue;
         
-        float clickSample = generateClickSound(metronomePhase);
+        AudioTrack::State state;
+        track->readState(state);
         
-        if (buffer.getNumChannels() >= 1)
-            buffer.addSample(0, sample, clickSample * metronomeVolume);
-        if (buffer.getNumChannels() >= 2)
-            buffer.addSample(1, sample, clickSample * metronomeVolume);
+        if (!state.loaded)
+            continue;
         
-        metronomePhase += 1.0 / sampleRate;
+        // Source time plays back stretchRatio times faster
+        const double sourceLength = state.hasLoopRegion ? state.loopEnd - state.loopStart : state.durationInSeconds;
+        longest = juce::jmax(longest, sourceLength / juce::jmax(0.01, state.stretchRatio));
     }
+    
+    return longest;
 }
 
-float MainComponent::generateClickSound(double phase)
+void MainComponent::exportStems()
 {
-    const double clickDuration = 0.01;
+    if (stemExporter.isExporting())
+    {
+        stemExporter.cancel();
+        return;
+    }
     
-    if (phase > clickDuration)
-        return 0.0f;
+    if (bouncer.isRendering())
+        return;
     
-    const double frequency = 2000.0;
-    double envelope = 1.0 - (phase / clickDuration);
-    envelope = envelope * envelope;
+    if (getLongestLoopLength() <= 0.0)
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Export Stems", "Load a track first.");
+        return;
+    }
     
-    double sineWave = std::sin(2.0 * juce::MathConstants<double>::pi * frequency * phase);
+    auto chooser = std::make_shared<juce::FileChooser>("Export stems to...");
+    juce::Component::SafePointer<MainComponent> safeThis(this);
     
-    return static_cast<float>(sineWave * envelope * 0.3);
+    chooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+                         [safeThis, chooser](const juce::FileChooser& fc)
+    {
+        juce::File folder = fc.getResult();
+        
+        if (safeThis == nullptr || folder == juce::File())
+            return;
+        
+        // Tracks render from their loop starts and leave the transport stopped
+        safeThis->stop();
+        
+        safeThis->stemExporter.exportStemsAsync(folder, {}, [safeThis, folder](juce::Result result)
+        {
+            if (safeThis == nullptr)
+                return;
+            
+            safeThis->stop();
+            
+            if (result.failed())
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Export Stems", result.getErrorMessage());
+            }
+            else
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Export Stems",
+                                                       "Stems written to " + folder.getFullPathName());
+            }
+        });
+    });
 }
 
-void MainComponent::onTrackLoaded(double trackBPM)
+void MainComponent::toggleProfiler()
 {
-    int tracksWithAudio = 0;
-    AudioTrack* loadedTrack = nullptr;
+    profilerPanel.setVisible(!profilerPanel.isVisible());
+    memoryPanel.setVisible(profilerPanel.isVisible());
+    resized();
     
-    for (auto& track : audioTracks)
+    if (transportComponent)
     {
-        if (track && track->isLoaded())
-        {
-            tracksWithAudio++;
-            loadedTrack = track.get();
-        }
+        transportComponent->setProfilerVisible(profilerPanel.isVisible());
     }
+}
+
+void MainComponent::onTrackLoaded(double trackBPM)
+{
+    engine.trackTempoDetected(trackBPM);
     
-    if (tracksWithAudio == 1 && trackBPM > 0.0 && loadedTrack)
+    if (transportComponent)
     {
-        setInitialMasterBPM(trackBPM, loadedTrack);
+        transportComponent->setTempo(engine.getMasterTempo());
     }
 }
 
 void MainComponent::setupTracks()
 {
-    for (int i = 0; i < maxTracks; ++i)
+    std::vector<AudioTrack*> tracks;
+    
+    for (int i = 0; i < StretcherEngine::maxTracks; ++i)
     {
-        audioTracks[i] = std::make_unique<AudioTrack>();
-        audioTracks[i]->setMasterBPM(masterTempo);
-        trackComponents[i] = std::make_unique<TrackComponent>(audioTracks[i].get(), i);
-        
-        trackComponents[i]->onTrackLoaded = [this](double bpm) { onTrackLoaded(bpm); };
-        
-        tracksContainer.addAndMakeVisible(trackComponents[i].get());
+        tracks.push_back(engine.getTrack(i));
     }
+    
+    // Rows are built as they scroll into view
+    trackList.onRowCreated = [this](TrackComponent& row, int i)
+    {
+        row.onTrackLoaded = [this](double bpm) { onTrackLoaded(bpm); };
+        row.onAlignRequested = [this, i] { engine.alignTrackToMix(i); };
+        row.onLoadRequested = [this, i](const juce::File& file) { loadTrack(i, file); };
+    };
+    
+    trackList.setTracks(tracks);
 }
 
 void MainComponent::setupTransport()
@@ -2880,11 +2811,20 @@ void MainComponent::setupTransport()
     transportComponent->onTempoChanged = [this](double bpm) { setTempo(bpm); };
     transportComponent->onAutoSync = [this] { autoSyncAllTracks(); };
     transportComponent->onMetronome = [this] { toggleMetronome(); };
+    transportComponent->onBounce = [this] { bounce(); };
+    transportComponent->onExportStems = [this] { exportStems(); };
+    transportComponent->onToggleProfiler = [this] { toggleProfiler(); };
 }
 
 void MainComponent::setupLayout()
 {
-    addAndMakeVisible(tracksViewport);
-    tracksViewport.setViewedComponent(&tracksContainer, false);
-    tracksViewport.setScrollBarsShown(true, false);
+    addAndMakeVisible(trackList);
+    
+    masterMeterDisplay.setMeter(&engine.getMasterMeter());
+    addAndMakeVisible(masterMeterDisplay);
+    
+    // Hidden until asked for; the engine profiles and memory is counted either way
+    profilerPanel.setProfiler(&engine.getProfiler());
+    addChildComponent(profilerPanel);
+    addChildComponent(memoryPanel);
 }
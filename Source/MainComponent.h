@@ -1,10 +1,19 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include <soundtouch/SoundTouch.h>
+#include "StretcherEngine.h"
+#include "OfflineRenderer.h"
+#include "StemExporter.h"
+#include "WaveformRenderer.h"
+#include "LevelMeterComponent.h"
+#include "SpectrogramComponent.h"
+#include "ProfilerComponent.h"
+#include "MemoryComponent.h"
 #include <vector>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <map>
 
 class WaveformComponent : public juce::Component
 {
@@ -19,7 +28,7 @@ public:
     void mouseExit(const juce::MouseEvent& event) override;
     void mouseUp(const juce::MouseEvent& event) override;
     
-    void setWaveformData(const std::vector<float>& peaks, double sampleRate, int totalSamples);
+    void setWaveformData(std::shared_ptr<const WaveformPeaks> peaks, double sampleRate, int totalSamples);
     void setPlayPosition(double positionInSeconds);
     void setDuration(double durationInSeconds);
     void setLooping(bool shouldLoop);
@@ -28,7 +37,14 @@ public:
     void setQuantizeValue(int quantizeValue);
     void setZoomFactor(double zoom);
     
+    // Pans so the view is centred on the given time, as far as the track allows
+    void setViewCentre(double timeInSeconds);
+    
+    // Selection edges and dragged grid lines snap to this; holding Alt bypasses it
+    void setSnapIndex(std::shared_ptr<const SnapIndex> index);
+    
     double getZoomFactor() const { return zoomFactor; }
+    double getMaxZoomFactor() const;
     double getDetectedBPM() const { return detectedBPM; }
     
     // Selection methods
@@ -41,9 +57,11 @@ public:
     std::function<void(double)> onPositionChanged;
     std::function<void(double)> onBPMChanged;
     std::function<void(double, double)> onSelectionChanged;
+    std::function<void(double, double)> onVisibleRangeChanged;
+    std::function<void(const WaveformTile&)> onWaveformTileRendered;
 
 private:
-    std::vector<float> waveformPeaks;
+    std::shared_ptr<const WaveformPeaks> waveformPeaks;
     double currentPosition;
     double totalDuration;
     double sampleRate;
@@ -55,12 +73,12 @@ private:
     double zoomFactor;
     double viewStartTime;  // For zoom - what time we're viewing from
     
-    // Grid dragging for BPM adjustment
-    std::vector<double> gridPositions;
+    // Grid dragging for BPM adjustment; beat n sits at n * 60 / detectedBPM
     int draggedGridIndex;
     bool isDraggingGrid;
     double initialMouseX;
     double initialGridTime;
+    double draggedGridTime;
     juce::MouseCursor currentCursor;
     
     // Pan/scroll for zoom navigation
@@ -80,106 +98,114 @@ private:
     bool isResizingSelectionEnd;
     double fixedSelectionBound;
     
+    // Snap targets, reach in pixels so it feels the same at every zoom
+    std::shared_ptr<const SnapIndex> snapIndex;
+    static constexpr int snapRadiusPixels = 8;
+    
+    // Waveform, grid, beat lines, selection and overlays, re-rendered only when
+    // something other than the play position changes
+    juce::Image staticLayer;
+    bool staticLayerValid;
+    float staticLayerScale;
+    double notifiedStartTime;
+    double notifiedEndTime;
+    
+    // The waveform itself is rasterized off the message thread. Until the tile for the
+    // current view arrives, the last one is drawn stretched to fit.
+    juce::SharedResourcePointer<WaveformRenderer> renderer;
+    WaveformTile waveformTile;
+    WaveformTile requestedTile;
+    MemoryAccounting::Allocation imageMemory;
+    
+    void renderStaticLayer(int imageWidth, int imageHeight, float scale);
+    void countImageMemory();
+    void drawWaveformTile(juce::Graphics& g, const juce::Rectangle<int>& area);
+    void waveformTileRendered(const WaveformTile& tile);
+    void invalidateStaticLayer();
+    void drawStaticLayers(juce::Graphics& g);
+    void drawPlayhead(juce::Graphics& g, const juce::Rectangle<int>& area);
+    juce::Rectangle<int> getPlayheadBounds(double positionInSeconds) const;
+    
     void updatePositionFromMouse(const juce::MouseEvent& event);
     void drawGrid(juce::Graphics& g, const juce::Rectangle<int>& area);
     void drawBeatLines(juce::Graphics& g, const juce::Rectangle<int>& area);
-    void initializeGridPositions();
+    double getBeatTime(int beatIndex) const;
+    int getNumBeats() const;
     int findGridLineAtPosition(int mouseX, const juce::Rectangle<int>& area);
     void updateBPMFromGrid();
     void updateCursor(const juce::MouseEvent& event);
     double timeToPixel(double timeInSeconds, const juce::Rectangle<int>& area) const;
     double pixelToTime(int pixelX, const juce::Rectangle<int>& area) const;
+    double snapTime(double timeInSeconds, const juce::MouseEvent& event, const juce::Rectangle<int>& area, bool transientsOnly) const;
     bool isNearSelectionEdge(int mouseX, const juce::Rectangle<int>& area, bool& nearStart, bool& nearEnd);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformComponent)
 };
 
-class AudioTrack
+// Whole-track strip above a WaveformComponent, with the detail view's range highlighted.
+// Clicking or dragging recentres the detail view. It draws from the same peaks, and
+// while the detail view is zoomed out it reuses the detail view's tile, so it only asks
+// the shared renderer for a tile of its own when the detail view opens zoomed in.
+class WaveformOverviewComponent : public juce::Component
 {
 public:
-    AudioTrack();
-    ~AudioTrack();
+    WaveformOverviewComponent();
+    ~WaveformOverviewComponent() override;
     
-    void loadAudioFile(const juce::File& file);
-    void setStretchRatio(double ratio);
-    void scaleStretchRatio(double scaleFactor);
-    void setPosition(double positionInSeconds);
-    void reset();
-    void setMasterBPM(double masterBPM);
-    void setManualBPM(double bpm);
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    
+    void setWaveformData(std::shared_ptr<const WaveformPeaks> peaks, double sampleRate, double durationInSeconds);
+    void setWaveformColour(const juce::Colour& colour);
+    void setVisibleRange(double startTime, double endTime);
+    void setSelectionRange(double startTime, double endTime);
+    void clearSelection();
+    void setPlayPosition(double positionInSeconds);
     
-    void processBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    // Adopts a detail-view tile if it spans the whole track
+    void offerTile(const WaveformTile& tile);
     
-    bool isLoaded() const { return audioBuffer.getNumSamples() > 0; }
-    double getDurationInSeconds() const;
-    double getCurrentPosition() const { return currentPosition; }
-    double getStretchRatio() const { return stretchRatio; }
-    juce::String getFileName() const { return fileName; }
-    double getDetectedBPM() const { return detectedBPM; }
-    const std::vector<float>& getWaveformPeaks() const { return waveformPeaks; }
-    
-    void setMuted(bool shouldBeMuted) { muted = shouldBeMuted; }
-    void setSolo(bool shouldBeSolo) { solo = shouldBeSolo; }
-    void setVolume(float newVolume) { volume = newVolume; }
-    void setLooping(bool shouldLoop) { looping = shouldLoop; }
-    void autoSyncToMaster();
-    
-    // Selection-based looping
-    void setLoopRegion(double startTime, double endTime);
-    void clearLoopRegion();
-    bool hasLoopRegion() const { return hasCustomLoopRegion; }
-    double getLoopStart() const { return loopStartTime; }
-    double getLoopEnd() const { return loopEndTime; }
-    
-    bool isMuted() const { return muted; }
-    bool isSolo() const { return solo; }
-    float getVolume() const { return volume; }
-    bool isLooping() const { return looping; }
+    std::function<void(double)> onNavigate;
 
 private:
-    juce::AudioBuffer<float> audioBuffer;
-    std::unique_ptr<soundtouch::SoundTouch> soundTouch;
-    juce::AudioFormatManager formatManager;
-    std::vector<float> waveformPeaks;
-    juce::AudioBuffer<float> stretchedBuffer;
-    
+    std::shared_ptr<const WaveformPeaks> waveformPeaks;
     double sampleRate;
+    double totalDuration;
+    juce::Colour waveformColour;
+    double viewStartTime;
+    double viewEndTime;
+    bool hasSelection;
+    double selectionStart;
+    double selectionEnd;
     double currentPosition;
-    double stretchRatio;
-    double detectedBPM;
-    double masterBPM;
-    juce::String fileName;
-    
-    bool muted;
-    bool solo;
-    bool looping;
-    float volume;
-    
-    // Loop region selection
-    bool hasCustomLoopRegion;
-    double loopStartTime;
-    double loopEndTime;
-    
-    juce::CriticalSection lock;
-    
-    // Improved BPM detection methods
-    double detectBPMImproved();
-    double detectBPMAutocorrelation();
-    std::vector<double> calculateBeatTrack();
-    double detectBPMFromOnsets();
-    std::vector<float> calculateOnsetStrength();
-    double findBestBPMCandidate(const std::vector<double>& onsetTimes);
-    
-    void generateWaveformPeaks();
-    void processDirectPlayback(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
-    void processWithSoundTouch(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
-    void initializeSoundTouch();
+    
+    juce::SharedResourcePointer<WaveformRenderer> renderer;
+    WaveformTile waveformTile;
+    bool tileRequested;
+    MemoryAccounting::Allocation tileMemory;    // Only tiles it rendered itself; offered ones belong to the detail view
+    
+    void requestTileIfNeeded(float scale);
+    void tileRendered(const WaveformTile& tile);
+    bool spansWholeTrack(const WaveformTile& tile) const;
+    float timeToX(double timeInSeconds) const;
+    juce::Rectangle<int> getPlayheadBounds(double positionInSeconds) const;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformOverviewComponent)
 };
 
 class TrackComponent : public juce::Component
 {
 public:
-    TrackComponent(AudioTrack* track, int trackNumber);
+    // View settings that outlive the component while its row is scrolled out of the list
+    struct ViewState
+    {
+        int quantize = 8;
+        double zoom = 1.0;
+        bool showSpectrogram = false;
+    };
+    
+    TrackComponent(AudioTrack* track, int trackNumber, ViewState& viewState);
     ~TrackComponent() override;
     
     void paint(juce::Graphics& g) override;
@@ -187,22 +213,32 @@ public:
     
     void updateTrackInfo();
     void updateWaveform();
+    void updateMeter(bool transportPlaying);
     
     static juce::Colour getTrackColour(int trackNumber);
     
     std::function<void(double)> onTrackLoaded;
+    std::function<void()> onAlignRequested;
+    std::function<void(const juce::File&)> onLoadRequested;
 
 private:
     AudioTrack* audioTrack;
     int trackNum;
+    ViewState& viewState;
     
     std::unique_ptr<WaveformComponent> waveformDisplay;
+    WaveformOverviewComponent overviewDisplay;
+    std::unique_ptr<SpectrogramComponent> spectrogramDisplay;
+    LevelMeterComponent levelMeterDisplay;
     juce::TextButton loadButton;
     juce::TextButton muteButton;
     juce::TextButton soloButton;
     juce::TextButton loopButton;
     juce::TextButton quantizeButton;
     juce::TextButton bpmEditButton;
+    juce::TextButton warpButton;
+    juce::TextButton alignButton;
+    juce::TextButton spectrogramButton;
     juce::TextButton zoomInButton;
     juce::TextButton zoomOutButton;
     juce::TextButton clearSelectionButton;
@@ -215,9 +251,12 @@ private:
     juce::Label volumeLabel;
     juce::Label zoomLabel;
     
-    int currentQuantize;
     bool editingBPM;
-    double currentZoom;
+    
+    // Last track state pushed into the controls, so only what changed is touched
+    AudioTrack::State shownState;
+    juce::uint32 shownStateVersion;
+    bool hasShownState;
     
     void loadButtonClicked();
     void muteButtonClicked();
@@ -225,6 +264,9 @@ private:
     void loopButtonClicked();
     void quantizeButtonClicked();
     void bpmEditButtonClicked();
+    void warpButtonClicked();
+    void alignButtonClicked();
+    void spectrogramButtonClicked();
     void zoomInButtonClicked();
     void zoomOutButtonClicked();
     void clearSelectionButtonClicked();
@@ -234,10 +276,50 @@ private:
     void onWaveformBPMChanged(double bpm);
     void onWaveformSelectionChanged(double startTime, double endTime);
     void showBPMEditor();
+    void showBPMCandidates();
+    void applyBPM(double bpm);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackComponent)
 };
 
+// Scrolling list of tracks that only keeps TrackComponents for the rows on screen, plus
+// one either side so small scrolls rebuild nothing. Everything a row shows comes back
+// from its AudioTrack and the list's view state, so rows can come and go freely while
+// the engine keeps playing every track.
+class TrackListComponent : public juce::Viewport
+{
+public:
+    static constexpr int rowHeight = 250;
+    
+    TrackListComponent();
+    ~TrackListComponent() override;
+    
+    void resized() override;
+    void visibleAreaChanged(const juce::Rectangle<int>& newVisibleArea) override;
+    
+    void setTracks(const std::vector<AudioTrack*>& tracks);
+    
+    // Pushes track state into the rows that currently exist
+    void refreshRows(bool transportPlaying);
+    
+    // A track finished loading a new file
+    void trackLoaded(int trackIndex);
+    
+    // Hooks up a row's callbacks as it is created
+    std::function<void(TrackComponent&, int)> onRowCreated;
+
+private:
+    juce::Component rowContainer;
+    std::vector<AudioTrack*> audioTracks;
+    std::vector<TrackComponent::ViewState> viewStates;
+    std::map<int, std::unique_ptr<TrackComponent>> rows;
+    
+    void updateRows();
+    juce::Rectangle<int> getRowBounds(int trackIndex) const;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackListComponent)
+};
+
 class TransportComponent : public juce::Component
 {
 public:
@@ -253,12 +335,20 @@ public:
     std::function<void(double)> onTempoChanged;
     std::function<void()> onAutoSync;
     std::function<void()> onMetronome;
+    std::function<void()> onBounce;
+    std::function<void()> onExportStems;
+    std::function<void()> onToggleProfiler;
     
     void setPlaying(bool isPlaying);
     void setRecording(bool isRecording);
     void setTempo(double bpm);
     void setPosition(double positionInSeconds);
     void setMetronomeEnabled(bool enabled);
+    
+    // While a bounce runs its button shows the progress and cancels it
+    void setBounceProgress(bool isBouncing, double progress);
+    void setStemExportProgress(bool isExporting, double progress);
+    void setProfilerVisible(bool isVisible);
 
 private:
     juce::TextButton playButton;
@@ -266,6 +356,9 @@ private:
     juce::TextButton recordButton;
     juce::TextButton autoSyncButton;
     juce::TextButton metronomeButton;
+    juce::TextButton bounceButton;
+    juce::TextButton stemsButton;
+    juce::TextButton profilerButton;
     juce::Slider tempoSlider;
     juce::Label tempoLabel;
     juce::Label positionLabel;
@@ -283,13 +376,15 @@ private:
     void recordButtonClicked();
     void autoSyncButtonClicked();
     void metronomeButtonClicked();
+    void bounceButtonClicked();
+    void stemsButtonClicked();
+    void profilerButtonClicked();
     void tempoSliderChanged();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TransportComponent)
 };
 
-class MainComponent : public juce::AudioAppComponent,
-                      public juce::Timer
+class MainComponent : public juce::AudioAppComponent
 {
 public:
     MainComponent();
@@ -302,49 +397,41 @@ public:
     void paint(juce::Graphics& g) override;
     void resized() override;
     
-    void timerCallback() override;
+    void refreshDisplay();
     
     void onTrackLoaded(double trackBPM);
 
 private:
-    static constexpr int maxTracks = 8;
-    
-    std::array<std::unique_ptr<AudioTrack>, maxTracks> audioTracks;
-    std::array<std::unique_ptr<TrackComponent>, maxTracks> trackComponents;
+    // Tracks, mixing, transport and metronome; this component only adds the UI
+    StretcherEngine engine;
+    OfflineRenderer bouncer;
+    StemExporter stemExporter;
     
     std::unique_ptr<TransportComponent> transportComponent;
-    juce::Viewport tracksViewport;
-    juce::Component tracksContainer;
+    TrackListComponent trackList;
+    LevelMeterComponent masterMeterDisplay;
+    ProfilerComponent profilerPanel;
+    MemoryComponent memoryPanel;
     
-    double masterTempo;
-    double previousMasterTempo;
-    double currentPlayPosition;
-    bool isPlaying;
     bool isRecording;
     bool autoSyncEnabled;
-    bool metronomeEnabled;
-    
-    // Metronome variables
-    double metronomePhase;
-    double metronomeBeatInterval;
-    double lastBeatTime;
-    double metronomeVolume;
     
-    juce::CriticalSection audioLock;
+    // UI refresh runs with the display rather than on a fixed timer
+    juce::VBlankAttachment vBlankAttachment;
     
     void play();
     void stop();
     void record();
     void setTempo(double bpm);
-    void setInitialMasterBPM(double bpm, AudioTrack* definingTrack);
     void autoSyncAllTracks();
-    void updatePlayPosition();
-    void setTrackPosition(int trackIndex, double position);
-    double findAverageBPM();
-    void syncNewTrackToMaster(AudioTrack* track);
+    void loadTrack(int trackIndex, const juce::File& file);
+    void trackFileLoaded(int trackIndex);
     void toggleMetronome();
-    void processMetronome(juce::AudioBuffer<float>& buffer, int numSamples);
-    float generateClickSound(double phase);
+    void bounce();
+    void startBounce(const juce::File& file, double lengthInSeconds);
+    double getLongestLoopLength() const;
+    void exportStems();
+    void toggleProfiler();
     
     void setupTracks();
     void setupTransport();
@@ -0,0 +1,155 @@
+#include "MemoryAccounting.h"
+#include <atomic>
+
+namespace
+{
+    struct Counter
+    {
+        std::atomic<juce::int64> current { 0 };
+        std::atomic<juce::int64> peak { 0 };
+
+        void add(juce::int64 delta) noexcept
+        {
+            const juce::int64 now = current.fetch_add(delta, std::memory_order_relaxed) + delta;
+            juce::int64 highest = peak.load(std::memory_order_relaxed);
+
+            while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void resetPeak() noexcept
+        {
+            peak = current.load();
+        }
+    };
+
+    // Constant-initialised, so Allocations in other statics can use them at any time
+    Counter counters[MemoryAccounting::numSubsystems];
+    Counter total;
+
+    void charge(MemoryAccounting::Subsystem subsystem, juce::int64 delta) noexcept
+    {
+        if (delta == 0)
+            return;
+
+        counters[subsystem].add(delta);
+        total.add(delta);
+    }
+
+    juce::String formatBytes(juce::int64 bytes)
+    {
+        if (bytes >= 1024 * 1024)
+            return juce::String(bytes / (1024.0 * 1024.0), 1) + " MB";
+
+        return juce::String(bytes / 1024.0, 1) + " KB";
+    }
+}
+
+MemoryAccounting::Allocation::Allocation(Subsystem subsystemToCharge) noexcept
+    : subsystem(subsystemToCharge),
+      bytes(0)
+{
+}
+
+// A copied container is a second allocation, so a copy counts again
+MemoryAccounting::Allocation::Allocation(const Allocation& other) noexcept
+    : subsystem(other.subsystem),
+      bytes(0)
+{
+    set(other.bytes);
+}
+
+MemoryAccounting::Allocation& MemoryAccounting::Allocation::operator=(const Allocation& other) noexcept
+{
+    set(other.bytes);
+    return *this;
+}
+
+MemoryAccounting::Allocation::~Allocation() noexcept
+{
+    set(0);
+}
+
+void MemoryAccounting::Allocation::set(size_t newBytes) noexcept
+{
+    charge(subsystem, (juce::int64)newBytes - (juce::int64)bytes);
+    bytes = newBytes;
+}
+
+size_t MemoryAccounting::bytesOf(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    return (size_t)buffer.getNumChannels() * (size_t)buffer.getNumSamples() * sizeof(float);
+}
+
+MemoryAccounting::Usage MemoryAccounting::getUsage(Subsystem subsystem) noexcept
+{
+    Usage usage;
+    usage.currentBytes = counters[subsystem].current.load();
+    usage.peakBytes = counters[subsystem].peak.load();
+    return usage;
+}
+
+std::array<MemoryAccounting::Usage, MemoryAccounting::numSubsystems> MemoryAccounting::getAllUsage() noexcept
+{
+    std::array<Usage, numSubsystems> usage;
+
+    for (int i = 0; i < numSubsystems; ++i)
+        usage[(size_t)i] = getUsage((Subsystem)i);
+
+    return usage;
+}
+
+MemoryAccounting::Usage MemoryAccounting::getTotalUsage() noexcept
+{
+    Usage usage;
+    usage.currentBytes = total.current.load();
+    usage.peakBytes = total.peak.load();
+    return usage;
+}
+
+void MemoryAccounting::resetPeaks() noexcept
+{
+    for (Counter& counter : counters)
+        counter.resetPeak();
+
+    total.resetPeak();
+}
+
+juce::String MemoryAccounting::getSubsystemName(Subsystem subsystem)
+{
+    switch (subsystem)
+    {
+        case decodedAudio:          return "Decoded audio";
+        case waveformPeaks:         return "Waveform peaks";
+        case spectrograms:          return "Spectrograms";
+        case snapIndices:           return "Snap indices";
+        case scratchBuffers:        return "Scratch buffers";
+        case soundTouchBacklog:     return "SoundTouch backlog";
+        case waveformImages:        return "Waveform images";
+        case spectrogramImages:     return "Spectrogram images";
+        case traceBuffers:          return "Trace buffers";
+        case numSubsystems:         break;
+    }
+
+    return {};
+}
+
+juce::String MemoryAccounting::getSummary()
+{
+    juce::String summary = "Memory, current / peak:";
+
+    for (int i = 0; i < numSubsystems; ++i)
+    {
+        const Usage usage = getUsage((Subsystem)i);
+
+        if (usage.peakBytes > 0)
+            summary << "\n  " << getSubsystemName((Subsystem)i) << ": " << formatBytes(usage.currentBytes) << " / "
+                    << formatBytes(usage.peakBytes);
+    }
+
+    const Usage totalUsage = getTotalUsage();
+    summary << "\n  Total: " << formatBytes(totalUsage.currentBytes) << " / " << formatBytes(totalUsage.peakBytes);
+
+    return summary;
+}
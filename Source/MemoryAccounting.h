@@ -0,0 +1,86 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+// Bytes held by each part of a session, current and peak. Whatever owns a large
+// buffer keeps an Allocation next to it and sets it whenever the buffer changes size.
+// The Allocation hands its bytes back when destroyed, so shared data is counted until
+// its last owner lets go. The counters are atomics, so the audio thread may update
+// them too; that's how a growing SoundTouch backlog shows up.
+//
+// Sizes are what the containers hold or reserve, not what the allocator rounds them
+// up to, so the totals are a lower bound.
+namespace MemoryAccounting
+{
+    enum Subsystem
+    {
+        decodedAudio,
+        waveformPeaks,
+        spectrograms,
+        snapIndices,
+        scratchBuffers,         // Stretching and offline render blocks
+        soundTouchBacklog,      // Samples queued inside SoundTouch
+        waveformImages,
+        spectrogramImages,
+        traceBuffers,
+        numSubsystems
+    };
+
+    struct Usage
+    {
+        juce::int64 currentBytes = 0;
+        juce::int64 peakBytes = 0;
+    };
+
+    class Allocation
+    {
+    public:
+        explicit Allocation(Subsystem subsystemToCharge) noexcept;
+        Allocation(const Allocation& other) noexcept;
+        Allocation& operator=(const Allocation& other) noexcept;
+        ~Allocation() noexcept;
+
+        void set(size_t newBytes) noexcept;
+        size_t getBytes() const noexcept { return bytes; }
+
+    private:
+        Subsystem subsystem;
+        size_t bytes;
+    };
+
+    template <typename ElementType>
+    size_t bytesOf(const std::vector<ElementType>& vector) noexcept
+    {
+        return vector.capacity() * sizeof(ElementType);
+    }
+
+    size_t bytesOf(const juce::AudioBuffer<float>& buffer) noexcept;
+
+   #if JUCE_MODULE_AVAILABLE_juce_graphics
+    // Inline, since the engine library is built without juce_graphics
+    inline size_t bytesOf(const juce::Image& image) noexcept
+    {
+        if (!image.isValid())
+            return 0;
+
+        const size_t bytesPerPixel = image.getFormat() == juce::Image::SingleChannel ? 1
+                                   : image.getFormat() == juce::Image::RGB ? 3 : 4;
+
+        return (size_t)image.getWidth() * (size_t)image.getHeight() * bytesPerPixel;
+    }
+   #endif
+
+    Usage getUsage(Subsystem subsystem) noexcept;
+    std::array<Usage, numSubsystems> getAllUsage() noexcept;
+    Usage getTotalUsage() noexcept;
+
+    // Peaks start again from the current values
+    void resetPeaks() noexcept;
+
+    juce::String getSubsystemName(Subsystem subsystem);
+
+    // One line per subsystem with anything counted, then the total
+    juce::String getSummary();
+}
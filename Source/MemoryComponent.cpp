@@ -0,0 +1,131 @@
+#include "MemoryComponent.h"
+#include <cmath>
+#include <cstdlib>
+
+MemoryComponent::MemoryComponent()
+    : usage(MemoryAccounting::getAllUsage()),
+      totalUsage(MemoryAccounting::getTotalUsage()),
+      totalBaseline(0),
+      resetButton("Reset")
+{
+    // Growth counts from an empty session until the first reset
+    baseline.fill(0);
+
+    addAndMakeVisible(resetButton);
+    resetButton.onClick = [this] { resetButtonClicked(); };
+    resetButton.setTooltip("Restart the peaks and measure growth from now");
+
+    setOpaque(true);
+}
+
+MemoryComponent::~MemoryComponent()
+{
+    resetButton.onClick = nullptr;
+}
+
+void MemoryComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff1a1a1a));
+    g.setColour(juce::Colours::white.withAlpha(0.1f));
+    g.drawRect(getLocalBounds());
+
+    juce::Rectangle<int> area = getLocalBounds().reduced(8);
+    const int rowHeight = 11;
+
+    juce::Rectangle<int> headerArea = area.removeFromTop(20).withTrimmedRight(50);
+    g.setFont(juce::Font(11.0f, juce::Font::bold));
+    g.setColour(juce::Colours::white.withAlpha(0.7f));
+    g.drawText("Memory", headerArea.removeFromLeft(105), juce::Justification::left);
+    g.drawText("now / peak / growth", headerArea, juce::Justification::right);
+
+    // Only what has held anything, so the rows fit the DSP panel's height
+    for (int i = 0; i < MemoryAccounting::numSubsystems; ++i)
+    {
+        if (usage[(size_t)i].peakBytes > 0 && area.getHeight() >= rowHeight * 2)
+            drawRow(g, area.removeFromTop(rowHeight), MemoryAccounting::getSubsystemName((MemoryAccounting::Subsystem)i),
+                    usage[(size_t)i], baseline[(size_t)i]);
+    }
+
+    g.setColour(juce::Colours::white.withAlpha(0.2f));
+    g.drawHorizontalLine(area.getY() + 1, (float)area.getX(), (float)area.getRight());
+    area.removeFromTop(3);
+
+    drawRow(g, area.removeFromTop(rowHeight), "Total", totalUsage, totalBaseline);
+}
+
+void MemoryComponent::resized()
+{
+    resetButton.setBounds(getLocalBounds().reduced(8).removeFromTop(18).removeFromRight(46));
+}
+
+void MemoryComponent::refresh()
+{
+    if (!isShowing())
+        return;
+
+    const auto newUsage = MemoryAccounting::getAllUsage();
+    const MemoryAccounting::Usage newTotal = MemoryAccounting::getTotalUsage();
+
+    if (newTotal.currentBytes != totalUsage.currentBytes || newTotal.peakBytes != totalUsage.peakBytes)
+    {
+        usage = newUsage;
+        totalUsage = newTotal;
+        repaint();
+        return;
+    }
+
+    // The total can stand still while memory moves between subsystems
+    for (size_t i = 0; i < usage.size(); ++i)
+    {
+        if (newUsage[i].currentBytes != usage[i].currentBytes || newUsage[i].peakBytes != usage[i].peakBytes)
+        {
+            usage = newUsage;
+            repaint();
+            return;
+        }
+    }
+}
+
+void MemoryComponent::resetButtonClicked()
+{
+    MemoryAccounting::resetPeaks();
+
+    usage = MemoryAccounting::getAllUsage();
+    totalUsage = MemoryAccounting::getTotalUsage();
+
+    for (size_t i = 0; i < usage.size(); ++i)
+        baseline[i] = usage[i].currentBytes;
+
+    totalBaseline = totalUsage.currentBytes;
+    repaint();
+}
+
+void MemoryComponent::drawRow(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& name,
+                              const MemoryAccounting::Usage& rowUsage, juce::int64 rowBaseline) const
+{
+    const juce::int64 growth = rowUsage.currentBytes - rowBaseline;
+
+    g.setFont(juce::Font(10.0f));
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+    g.drawText(name, area.removeFromLeft(105), juce::Justification::left);
+
+    g.setColour(growth > 0 ? juce::Colours::orange : juce::Colours::white.withAlpha(0.5f));
+    g.drawText((growth > 0 ? "+" : "") + formatBytes(growth), area.removeFromRight(56), juce::Justification::right);
+
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+    g.drawText(formatBytes(rowUsage.peakBytes), area.removeFromRight(56), juce::Justification::right);
+    g.drawText(formatBytes(rowUsage.currentBytes), area.removeFromRight(56), juce::Justification::right);
+}
+
+juce::String MemoryComponent::formatBytes(juce::int64 bytes)
+{
+    const juce::int64 magnitude = std::abs(bytes);
+
+    if (magnitude >= 1024 * 1024 * 1024)
+        return juce::String(bytes / (1024.0 * 1024.0 * 1024.0), 2) + " GB";
+
+    if (magnitude >= 1024 * 1024)
+        return juce::String(bytes / (1024.0 * 1024.0), 1) + " MB";
+
+    return juce::String((juce::int64)std::llround(bytes / 1024.0)) + " KB";
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryAccounting.h"
+#include <array>
+
+// What each subsystem holds now, the most it has held, and how much it has grown
+// since the panel was last reset, so a leak shows as growth that never comes back
+// down. Shown beside the DSP panel; the owner calls refresh() at display rate and it
+// only repaints when a number has changed.
+class MemoryComponent : public juce::Component
+{
+public:
+    MemoryComponent();
+    ~MemoryComponent() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    void refresh();
+
+    static constexpr int preferredWidth = 290;
+
+private:
+    std::array<MemoryAccounting::Usage, MemoryAccounting::numSubsystems> usage;
+    std::array<juce::int64, MemoryAccounting::numSubsystems> baseline;
+    MemoryAccounting::Usage totalUsage;
+    juce::int64 totalBaseline;
+
+    juce::TextButton resetButton;
+
+    void resetButtonClicked();
+
+    void drawRow(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& name,
+                 const MemoryAccounting::Usage& rowUsage, juce::int64 rowBaseline) const;
+
+    static juce::String formatBytes(juce::int64 bytes);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MemoryComponent)
+};
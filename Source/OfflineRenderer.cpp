@@ -0,0 +1,151 @@
+#include "OfflineRenderer.h"
+#include "TraceRecorder.h"
+
+// Runs one render off the message thread, then reports back on it
+class OfflineRenderer::RenderThread : public juce::Thread
+{
+public:
+    RenderThread(OfflineRenderer& owner, const juce::File& file, const Settings& renderSettings,
+                 std::function<void(juce::Result)> callback)
+        : juce::Thread("Offline Render"),
+          renderer(owner),
+          outputFile(file),
+          settings(renderSettings),
+          onFinished(std::move(callback))
+    {
+    }
+
+    void run() override
+    {
+        juce::Result result = renderer.render(outputFile, settings);
+
+        if (onFinished)
+        {
+            auto callback = onFinished;
+            juce::MessageManager::callAsync([callback, result] { callback(result); });
+        }
+    }
+
+private:
+    OfflineRenderer& renderer;
+    juce::File outputFile;
+    Settings settings;
+    std::function<void(juce::Result)> onFinished;
+};
+
+OfflineRenderer::OfflineRenderer(StretcherEngine& engineToRender)
+    : engine(engineToRender),
+      rendering(false),
+      shouldCancel(false),
+      progress(0.0)
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    if (renderThread)
+    {
+        cancel();
+        renderThread->stopThread(10000);
+    }
+}
+
+void OfflineRenderer::renderAsync(const juce::File& outputFile, const Settings& settings, std::function<void(juce::Result)> onFinished)
+{
+    if (renderThread)
+    {
+        cancel();
+        renderThread->stopThread(10000);
+    }
+
+    renderThread = std::make_unique<RenderThread>(*this, outputFile, settings, std::move(onFinished));
+    renderThread->startThread();
+}
+
+juce::Result OfflineRenderer::render(const juce::File& outputFile, const Settings& settings)
+{
+    TraceRecorder::Scope trace("renderMix", "render");
+
+    const double sampleRate = engine.getSampleRate();
+    const juce::int64 totalSamples = (juce::int64)(settings.lengthInSeconds * sampleRate);
+
+    if (totalSamples <= 0 || settings.numChannels <= 0)
+        return juce::Result::fail("Nothing to render");
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    juce::AudioFormat* format = formatManager.findFormatForFileExtension(outputFile.getFileExtension());
+
+    if (format == nullptr)
+        return juce::Result::fail("Unsupported file type: " + outputFile.getFileName());
+
+    outputFile.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream(outputFile.createOutputStream());
+
+    if (stream == nullptr)
+        return juce::Result::fail("Could not open " + outputFile.getFullPathName() + " for writing");
+
+    juce::AudioFormatWriter* writer = format->createWriterFor(stream.get(), sampleRate, (unsigned int)settings.numChannels,
+                                                              settings.bitsPerSample, {}, 0);
+
+    if (writer == nullptr)
+        return juce::Result::fail(format->getFormatName() + " cannot be written at " + juce::String(settings.bitsPerSample) + " bits");
+
+    stream.release(); // The writer owns the stream now
+
+    // A few seconds of buffering lets the renderer run ahead while the disk catches up
+    juce::TimeSliceThread writerThread("Offline Render Writer");
+    writerThread.startThread();
+    auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(writer, writerThread,
+                                                                                    (int)(sampleRate * 4.0));
+
+    const int numThreads = settings.numThreads > 0 ? settings.numThreads : juce::SystemStats::getNumCpus();
+    juce::ThreadPool pool(numThreads);
+    juce::AudioBuffer<float> buffer(settings.numChannels, blockSize);
+
+    rendering = true;
+    shouldCancel = false;
+    progress = 0.0;
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    engine.beginOfflineRender(blockSize, settings.numChannels);
+
+    juce::int64 samplesRendered = 0;
+
+    while (samplesRendered < totalSamples && !shouldCancel)
+    {
+        const int numSamples = (int)juce::jmin((juce::int64)blockSize, totalSamples - samplesRendered);
+        engine.renderBlock(buffer, numSamples, numThreads > 1 ? &pool : nullptr);
+
+        // The writer's FIFO only refuses a block when it is full; wait for it to drain
+        while (!threadedWriter->write(buffer.getArrayOfReadPointers(), numSamples) && !shouldCancel)
+            juce::Thread::sleep(1);
+
+        samplesRendered += numSamples;
+        progress = (double)samplesRendered / (double)totalSamples;
+    }
+
+    engine.endOfflineRender();
+
+    // Deleting the threaded writer flushes what is still buffered
+    threadedWriter.reset();
+    writerThread.stopThread(1000);
+
+    const bool cancelled = shouldCancel.load();
+    rendering = false;
+
+    if (cancelled)
+    {
+        outputFile.deleteFile();
+        return juce::Result::fail("Render cancelled");
+    }
+
+    const double elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    juce::Logger::writeToLog("Rendered " + juce::String(settings.lengthInSeconds, 1) + "s to " + outputFile.getFileName() +
+                             " in " + juce::String(elapsedSeconds, 2) + "s (" +
+                             juce::String(settings.lengthInSeconds / juce::jmax(1.0e-6, elapsedSeconds), 1) +
+                             "x real time, " + juce::String(numThreads) + " threads)");
+
+    return juce::Result::ok();
+}
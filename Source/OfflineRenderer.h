@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StretcherEngine.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Bounces a StretcherEngine's mix to an audio file as fast as the CPU allows. It runs
+// the same tracks, stretching and metronome as live playback, renders the tracks of each
+// block on a thread pool, and hands the result to a buffered writer on its own thread,
+// so neither the disk nor a single core sets the pace. The format follows the file
+// extension: .wav, .aif/.aiff or .flac.
+class OfflineRenderer
+{
+public:
+    struct Settings
+    {
+        double lengthInSeconds = 60.0;
+        int numChannels = 2;
+        int bitsPerSample = 24;
+        int numThreads = 0;                 // 0 uses one per core
+    };
+
+    explicit OfflineRenderer(StretcherEngine& engineToRender);
+    ~OfflineRenderer();
+
+    // Renders from the start of the transport on the calling thread. Live output is
+    // silent meanwhile, and the transport is left stopped and rewound.
+    juce::Result render(const juce::File& outputFile, const Settings& settings);
+
+    // Renders on a background thread and calls back on the message thread
+    void renderAsync(const juce::File& outputFile, const Settings& settings, std::function<void(juce::Result)> onFinished);
+
+    bool isRendering() const { return rendering.load(); }
+    double getProgress() const { return progress.load(); }
+    void cancel() { shouldCancel = true; }
+
+    // Largest block AudioTrack's stretch buffer takes in stereo
+    static constexpr int blockSize = 4096;
+
+private:
+    class RenderThread;
+
+    StretcherEngine& engine;
+    std::unique_ptr<RenderThread> renderThread;
+    std::atomic<bool> rendering;
+    std::atomic<bool> shouldCancel;
+    std::atomic<double> progress;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
@@ -0,0 +1,318 @@
+#include "ProfilerComponent.h"
+#include "TraceRecorder.h"
+#include <cmath>
+
+ProfilerComponent::ProfilerComponent()
+    : profiler(nullptr),
+      report(std::make_unique<AudioProfiler::Report>()),
+      shownVersion(0),
+      deviceXRuns(-1),
+      enableButton("On"),
+      resetButton("Reset"),
+      exportButton("CSV..."),
+      traceButton("Trace...")
+{
+    addAndMakeVisible(enableButton);
+    addAndMakeVisible(resetButton);
+    addAndMakeVisible(exportButton);
+    addAndMakeVisible(traceButton);
+
+    enableButton.onClick = [this] { enableButtonClicked(); };
+    resetButton.onClick = [this] { resetButtonClicked(); };
+    exportButton.onClick = [this] { exportButtonClicked(); };
+    traceButton.onClick = [this] { traceButtonClicked(); };
+
+    enableButton.setClickingTogglesState(true);
+    enableButton.setToggleState(false, juce::dontSendNotification);
+    enableButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green.darker());
+    enableButton.setTooltip("Profile the audio callback");
+    exportButton.setTooltip("Save the statistics as CSV");
+    traceButton.setTooltip("Save a timeline of loads, analysis and renders for chrome://tracing or ui.perfetto.dev");
+
+    setOpaque(true);
+}
+
+ProfilerComponent::~ProfilerComponent()
+{
+    enableButton.onClick = nullptr;
+    resetButton.onClick = nullptr;
+    exportButton.onClick = nullptr;
+    traceButton.onClick = nullptr;
+}
+
+void ProfilerComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff1a1a1a));
+    g.setColour(juce::Colours::white.withAlpha(0.1f));
+    g.drawRect(getLocalBounds());
+
+    drawSummary(g, getSummaryArea());
+    drawHistogram(g, getHistogramArea());
+
+    // Stages on the left, tracks on the right, one row each for whatever has run
+    juce::Rectangle<int> breakdownArea = getBreakdownArea();
+    juce::Rectangle<int> stageArea = breakdownArea.removeFromLeft(breakdownArea.getWidth() / 2).withTrimmedRight(10);
+    juce::Rectangle<int> trackArea = breakdownArea;
+    const int rowHeight = 14;
+
+    g.setFont(juce::Font(11.0f, juce::Font::bold));
+    g.setColour(juce::Colours::white.withAlpha(0.7f));
+    g.drawText("Stage (mean / worst)", stageArea.removeFromTop(rowHeight), juce::Justification::left);
+    g.drawText("Track (mean / worst)", trackArea.removeFromTop(rowHeight), juce::Justification::left);
+
+    for (int stage = 0; stage < AudioProfiler::numStages; ++stage)
+    {
+        if (report->stages[stage].numBlocks > 0)
+            drawTimingRow(g, stageArea.removeFromTop(rowHeight), AudioProfiler::getStageName((AudioProfiler::Stage)stage),
+                          report->stages[stage]);
+    }
+
+    for (int track = 0; track < AudioProfiler::maxTracks; ++track)
+    {
+        if (report->tracks[track].numBlocks > 0 && trackArea.getHeight() >= rowHeight)
+            drawTimingRow(g, trackArea.removeFromTop(rowHeight), "Track " + juce::String(track + 1), report->tracks[track]);
+    }
+}
+
+void ProfilerComponent::resized()
+{
+    juce::Rectangle<int> buttonArea = getSummaryArea().removeFromBottom(22);
+    enableButton.setBounds(buttonArea.removeFromLeft(36));
+    buttonArea.removeFromLeft(4);
+    resetButton.setBounds(buttonArea.removeFromLeft(46));
+    buttonArea.removeFromLeft(4);
+    exportButton.setBounds(buttonArea.removeFromLeft(46));
+    buttonArea.removeFromLeft(4);
+    traceButton.setBounds(buttonArea.removeFromLeft(50));
+}
+
+void ProfilerComponent::setProfiler(AudioProfiler* profilerToShow)
+{
+    profiler = profilerToShow;
+    *report = AudioProfiler::Report();
+    shownVersion = 0;
+
+    if (profiler != nullptr)
+        enableButton.setToggleState(profiler->isEnabled(), juce::dontSendNotification);
+
+    repaint();
+}
+
+void ProfilerComponent::refresh()
+{
+    if (profiler == nullptr || !isShowing())
+        return;
+
+    if (profiler->getReportVersion() != shownVersion)
+    {
+        shownVersion = profiler->getReport(*report);
+        repaint();
+    }
+}
+
+void ProfilerComponent::setDeviceXRunCount(int count)
+{
+    if (count != deviceXRuns)
+    {
+        deviceXRuns = count;
+        repaint(getSummaryArea());
+    }
+}
+
+void ProfilerComponent::enableButtonClicked()
+{
+    if (profiler != nullptr)
+        profiler->setEnabled(enableButton.getToggleState());
+}
+
+void ProfilerComponent::resetButtonClicked()
+{
+    if (profiler != nullptr)
+        profiler->reset();
+}
+
+void ProfilerComponent::exportButtonClicked()
+{
+    if (profiler == nullptr)
+        return;
+
+    // One file per machine makes headroom easy to compare
+    const juce::File defaultFile = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                       .getChildFile("STRETCHER profile " + juce::SystemStats::getComputerName() + ".csv");
+
+    chooser = std::make_shared<juce::FileChooser>("Export profile to...", defaultFile, "*.csv");
+
+    juce::Component::SafePointer<ProfilerComponent> safeThis(this);
+
+    chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                             | juce::FileBrowserComponent::warnAboutOverwriting,
+                         [safeThis](const juce::FileChooser& fc)
+    {
+        juce::File file = fc.getResult();
+
+        if (safeThis == nullptr || safeThis->profiler == nullptr || file == juce::File())
+            return;
+
+        juce::Result result = safeThis->profiler->exportCSV(file.withFileExtension("csv"));
+
+        if (result.failed())
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Export Profile", result.getErrorMessage());
+    });
+}
+
+void ProfilerComponent::traceButtonClicked()
+{
+    const juce::File defaultFile = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                       .getChildFile("STRETCHER trace " + juce::Time::getCurrentTime().formatted("%Y-%m-%d %H%M%S") + ".json");
+
+    chooser = std::make_shared<juce::FileChooser>("Save trace to...", defaultFile, "*.json");
+
+    chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                             | juce::FileBrowserComponent::warnAboutOverwriting,
+                         [](const juce::FileChooser& fc)
+    {
+        juce::File file = fc.getResult();
+
+        if (file == juce::File())
+            return;
+
+        juce::Result result = TraceRecorder::exportJSON(file.withFileExtension("json"));
+
+        if (result.failed())
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Save Trace", result.getErrorMessage());
+    });
+}
+
+// ============================================================================
+// Drawing
+// ============================================================================
+
+juce::Rectangle<int> ProfilerComponent::getSummaryArea() const
+{
+    return getLocalBounds().reduced(8).removeFromLeft(190);
+}
+
+juce::Rectangle<int> ProfilerComponent::getHistogramArea() const
+{
+    return getLocalBounds().reduced(8).withTrimmedLeft(205).removeFromLeft(240);
+}
+
+juce::Rectangle<int> ProfilerComponent::getBreakdownArea() const
+{
+    return getLocalBounds().reduced(8).withTrimmedLeft(465);
+}
+
+void ProfilerComponent::drawSummary(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    const AudioProfiler::Timing& block = report->block;
+    const double meanLoad = block.getMeanLoad();
+    const int lineHeight = 17;
+
+    g.setFont(juce::Font(14.0f, juce::Font::bold));
+    g.setColour(getLoadColour(meanLoad));
+    g.drawText("DSP " + juce::String(juce::roundToInt(meanLoad * 100.0)) + "%  worst " +
+                   juce::String(juce::roundToInt(block.worstLoad * 100.0)) + "%",
+               area.removeFromTop(lineHeight + 2), juce::Justification::left);
+
+    g.setFont(juce::Font(12.0f));
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+
+    // Headroom is what the worst block left, since one slow block is all a crackle takes
+    g.drawText("Headroom " + juce::String(juce::jmax(0, juce::roundToInt((1.0 - block.worstLoad) * 100.0))) + "%",
+               area.removeFromTop(lineHeight), juce::Justification::left);
+
+    g.setColour(block.numOverruns > 0 ? juce::Colours::red : juce::Colours::white.withAlpha(0.8f));
+    g.drawText("Overruns " + juce::String((juce::int64)block.numOverruns) + " of " + juce::String((juce::int64)block.numBlocks) +
+                   (deviceXRuns >= 0 ? ", device xruns " + juce::String(deviceXRuns) : juce::String()),
+               area.removeFromTop(lineHeight), juce::Justification::left);
+
+    g.setColour(juce::Colours::white.withAlpha(0.6f));
+
+    if (report->sampleRate > 0.0)
+    {
+        g.drawText(juce::String(report->blockSize) + " samples at " + juce::String(report->sampleRate / 1000.0, 1) + " kHz = " +
+                       juce::String(report->blockSize * 1000.0 / report->sampleRate, 2) + " ms",
+                   area.removeFromTop(lineHeight), juce::Justification::left);
+    }
+    else
+    {
+        g.drawText("Waiting for audio", area.removeFromTop(lineHeight), juce::Justification::left);
+    }
+}
+
+void ProfilerComponent::drawHistogram(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    g.setFont(juce::Font(11.0f, juce::Font::bold));
+    g.setColour(juce::Colours::white.withAlpha(0.7f));
+    g.drawText("Block load", area.removeFromTop(14), juce::Justification::left);
+
+    juce::Rectangle<int> labelArea = area.removeFromBottom(12);
+
+    g.setColour(juce::Colours::black);
+    g.fillRect(area);
+
+    const AudioProfiler::Timing& block = report->block;
+    juce::uint32 largestCount = 0;
+
+    for (juce::uint32 count : block.histogram)
+        largestCount = juce::jmax(largestCount, count);
+
+    // Counts on a log scale, so a handful of slow blocks still shows next to thousands of quick ones
+    const float binWidth = area.getWidth() / (float)AudioProfiler::numLoadBins;
+    const float logLargest = std::log1p((float)largestCount);
+
+    for (int bin = 0; bin < AudioProfiler::numLoadBins; ++bin)
+    {
+        const juce::uint32 count = block.histogram[bin];
+
+        if (count == 0 || logLargest <= 0.0f)
+            continue;
+
+        const float height = juce::jmax(1.0f, area.getHeight() * std::log1p((float)count) / logLargest);
+
+        g.setColour(bin >= 10 ? juce::Colours::red : getLoadColour(bin / 10.0));
+        g.fillRect(area.getX() + bin * binWidth + 1.0f, area.getBottom() - height, binWidth - 2.0f, height);
+    }
+
+    // The deadline
+    const float deadlineX = area.getX() + binWidth * 10.0f;
+    g.setColour(juce::Colours::white.withAlpha(0.5f));
+    g.drawVerticalLine(juce::roundToInt(deadlineX), (float)area.getY(), (float)area.getBottom());
+
+    g.setFont(juce::Font(10.0f));
+    g.drawText("0%", labelArea.withWidth(30), juce::Justification::left);
+    g.drawText("50%", juce::Rectangle<int>(juce::roundToInt(area.getX() + binWidth * 5.0f) - 15, labelArea.getY(), 30,
+                                           labelArea.getHeight()), juce::Justification::centred);
+    g.drawText("100%", juce::Rectangle<int>(juce::roundToInt(deadlineX) - 15, labelArea.getY(), 30, labelArea.getHeight()),
+               juce::Justification::centred);
+}
+
+void ProfilerComponent::drawTimingRow(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& name,
+                                      const AudioProfiler::Timing& timing) const
+{
+    g.setFont(juce::Font(11.0f));
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+    g.drawText(name, area.removeFromLeft(105), juce::Justification::left);
+    g.drawText(juce::String(timing.getMeanSeconds() * 1000.0, 2) + " / " + juce::String(timing.worstSeconds * 1000.0, 2) + " ms",
+               area.removeFromRight(95), juce::Justification::right);
+
+    // Share of the deadline: mean as a bar, worst as a tick
+    juce::Rectangle<int> barArea = area.reduced(4, 3);
+    g.setColour(juce::Colours::black);
+    g.fillRect(barArea);
+
+    const double meanLoad = timing.getMeanLoad();
+    g.setColour(getLoadColour(meanLoad));
+    g.fillRect(barArea.withWidth(juce::roundToInt(barArea.getWidth() * juce::jmin(1.0, meanLoad))));
+
+    const int worstX = barArea.getX() + juce::roundToInt(barArea.getWidth() * juce::jmin(1.0, timing.worstLoad));
+    g.setColour(timing.numOverruns > 0 ? juce::Colours::red : juce::Colours::white);
+    g.fillRect(juce::jmax(barArea.getX(), worstX - 1), barArea.getY(), 2, barArea.getHeight());
+}
+
+juce::Colour ProfilerComponent::getLoadColour(double load)
+{
+    return load > 0.8 ? juce::Colours::red
+         : load > 0.5 ? juce::Colours::yellow
+         : juce::Colours::green;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioProfiler.h"
+#include <memory>
+
+// DSP load at a glance: the callback's mean and worst share of its deadline, overruns,
+// a histogram of block load, and bars for each track and stage. The owner calls
+// refresh() at display rate; it only repaints when the profiler has published new
+// numbers. The statistics can be reset and exported as CSV from the panel, and the
+// TraceRecorder timeline of loads, analysis and renders saved as Chrome trace JSON.
+class ProfilerComponent : public juce::Component
+{
+public:
+    ProfilerComponent();
+    ~ProfilerComponent() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    void setProfiler(AudioProfiler* profilerToShow);
+    void refresh();
+
+    // Glitches the device driver itself reported, when it can tell
+    void setDeviceXRunCount(int count);
+
+    static constexpr int preferredHeight = 150;
+
+private:
+    AudioProfiler* profiler;
+    std::unique_ptr<AudioProfiler::Report> report;
+    juce::uint32 shownVersion;
+    int deviceXRuns;
+
+    juce::TextButton enableButton;
+    juce::TextButton resetButton;
+    juce::TextButton exportButton;
+    juce::TextButton traceButton;
+    std::shared_ptr<juce::FileChooser> chooser;
+
+    void enableButtonClicked();
+    void resetButtonClicked();
+    void exportButtonClicked();
+    void traceButtonClicked();
+
+    juce::Rectangle<int> getSummaryArea() const;
+    juce::Rectangle<int> getHistogramArea() const;
+    juce::Rectangle<int> getBreakdownArea() const;
+
+    void drawSummary(juce::Graphics& g, juce::Rectangle<int> area) const;
+    void drawHistogram(juce::Graphics& g, juce::Rectangle<int> area) const;
+    void drawTimingRow(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& name,
+                       const AudioProfiler::Timing& timing) const;
+
+    static juce::Colour getLoadColour(double load);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProfilerComponent)
+};
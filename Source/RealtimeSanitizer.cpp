@@ -0,0 +1,344 @@
+// The interceptors below redefine read() and friends, which fortified glibc headers
+// declare as inline wrappers, so fortification has to go before anything is included
+#if defined(STRETCHER_REALTIME_SANITIZER) && STRETCHER_REALTIME_SANITIZER && defined(__linux__)
+ #undef _FORTIFY_SOURCE
+#endif
+
+#include "RealtimeSanitizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#if STRETCHER_REALTIME_SANITIZER && (JUCE_LINUX || JUCE_MAC)
+ #define STRETCHER_REALTIME_INTERCEPTORS 1
+ #include <cstdarg>
+ #include <cstdio>
+ #include <dlfcn.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <unistd.h>
+ #if JUCE_MAC
+  #include <malloc/malloc.h>
+ #endif
+#else
+ #define STRETCHER_REALTIME_INTERCEPTORS 0
+#endif
+
+namespace
+{
+    // Per thread, so marking the audio thread costs nothing but an increment
+    thread_local int audioDepth = 0;
+    thread_local int permitDepth = 0;
+
+    struct Registry
+    {
+        juce::CriticalSection lock;
+        std::vector<RealtimeSanitizer::Violation> violations;
+        bool abortOnViolation = false;
+    };
+
+    Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+}
+
+RealtimeSanitizer::ScopedAudioThread::ScopedAudioThread() noexcept
+{
+   #if STRETCHER_REALTIME_SANITIZER
+    ++audioDepth;
+   #endif
+}
+
+RealtimeSanitizer::ScopedAudioThread::~ScopedAudioThread() noexcept
+{
+   #if STRETCHER_REALTIME_SANITIZER
+    --audioDepth;
+   #endif
+}
+
+RealtimeSanitizer::ScopedPermit::ScopedPermit() noexcept
+{
+    ++permitDepth;
+}
+
+RealtimeSanitizer::ScopedPermit::~ScopedPermit() noexcept
+{
+    --permitDepth;
+}
+
+bool RealtimeSanitizer::isCheckedThread() noexcept
+{
+    return audioDepth > 0 && permitDepth == 0;
+}
+
+void RealtimeSanitizer::notify(Kind kind, const char* call) noexcept
+{
+    if (!isAvailable() || !isCheckedThread())
+        return;
+
+    // Recording allocates and locks; none of that is the audio code's doing
+    ScopedPermit permit;
+
+    const juce::String stackTrace = juce::SystemStats::getStackBacktrace();
+    Registry& registry = getRegistry();
+    bool shouldAbort = false;
+
+    {
+        juce::ScopedLock sl(registry.lock);
+
+        auto existing = std::find_if(registry.violations.begin(), registry.violations.end(), [&](const Violation& violation)
+        {
+            return violation.kind == kind && violation.stackTrace == stackTrace;
+        });
+
+        if (existing != registry.violations.end())
+            ++existing->count;
+        else
+            registry.violations.push_back({ kind, call, stackTrace, 1 });
+
+        shouldAbort = registry.abortOnViolation;
+    }
+
+    if (shouldAbort)
+    {
+        std::cerr << "Real-time violation: " << getKindName(kind) << " (" << call << ") on the audio thread\n"
+                  << stackTrace << std::endl;
+        std::abort();
+    }
+}
+
+std::vector<RealtimeSanitizer::Violation> RealtimeSanitizer::getViolations()
+{
+    ScopedPermit permit;
+    Registry& registry = getRegistry();
+
+    juce::ScopedLock sl(registry.lock);
+    return registry.violations;
+}
+
+void RealtimeSanitizer::clearViolations()
+{
+    ScopedPermit permit;
+    Registry& registry = getRegistry();
+
+    juce::ScopedLock sl(registry.lock);
+    registry.violations.clear();
+}
+
+void RealtimeSanitizer::setAbortOnViolation(bool shouldAbort)
+{
+    ScopedPermit permit;
+    Registry& registry = getRegistry();
+
+    juce::ScopedLock sl(registry.lock);
+    registry.abortOnViolation = shouldAbort;
+}
+
+juce::String RealtimeSanitizer::getKindName(Kind kind)
+{
+    switch (kind)
+    {
+        case Kind::allocation:      return "allocation";
+        case Kind::deallocation:    return "deallocation";
+        case Kind::lock:            return "lock";
+        case Kind::lockWait:        return "lock wait";
+        case Kind::fileAccess:      return "file access";
+        case Kind::logging:         return "logging";
+    }
+
+    return {};
+}
+
+#if STRETCHER_REALTIME_INTERCEPTORS
+
+// ============================================================================
+// Interceptors. Each one reports the call, then forwards to the real function, found
+// with dlsym() on first use. The caches are constant-initialised atomics, since a
+// function-local static with a guard could itself end up in pthread_mutex_lock.
+// ============================================================================
+
+namespace
+{
+    using RealtimeSanitizer::Kind;
+    using RealtimeSanitizer::notify;
+
+    template <typename FunctionType>
+    FunctionType findNext(std::atomic<void*>& cache, const char* name) noexcept
+    {
+        void* function = cache.load(std::memory_order_acquire);
+
+        if (function == nullptr)
+        {
+            // The lookup may allocate; that's the sanitizer's doing, not the caller's
+            RealtimeSanitizer::ScopedPermit permit;
+            function = dlsym(RTLD_NEXT, name);
+            cache.store(function, std::memory_order_release);
+        }
+
+        return reinterpret_cast<FunctionType>(function);
+    }
+}
+
+#if JUCE_LINUX
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void __libc_free(void* pointer);
+}
+#endif
+
+extern "C" void* malloc(size_t size)
+{
+    notify(Kind::allocation, "malloc");
+
+   #if JUCE_LINUX
+    return __libc_malloc(size);
+   #else
+    return malloc_zone_malloc(malloc_default_zone(), size);
+   #endif
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    notify(Kind::allocation, "calloc");
+
+   #if JUCE_LINUX
+    return __libc_calloc(count, size);
+   #else
+    return malloc_zone_calloc(malloc_default_zone(), count, size);
+   #endif
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+    notify(Kind::allocation, "realloc");
+
+   #if JUCE_LINUX
+    return __libc_realloc(pointer, size);
+   #else
+    if (pointer == nullptr)
+        return malloc_zone_malloc(malloc_default_zone(), size);
+
+    malloc_zone_t* zone = malloc_zone_from_ptr(pointer);
+    return malloc_zone_realloc(zone != nullptr ? zone : malloc_default_zone(), pointer, size);
+   #endif
+}
+
+extern "C" void free(void* pointer)
+{
+    if (pointer == nullptr)
+        return;
+
+    notify(Kind::deallocation, "free");
+
+   #if JUCE_LINUX
+    __libc_free(pointer);
+   #else
+    if (malloc_zone_t* zone = malloc_zone_from_ptr(pointer))
+        malloc_zone_free(zone, pointer);
+   #endif
+}
+
+// libc++ on macOS allocates inside its own dylib, where the malloc above can't see it
+void* operator new(std::size_t size)
+{
+    if (void* pointer = std::malloc(size > 0 ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept             { std::free(pointer); }
+void operator delete[](void* pointer) noexcept           { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept   { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+// A lock is reported whether or not it was free; one that was held is also a wait
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    static std::atomic<void*> next { nullptr };
+
+    if (RealtimeSanitizer::isCheckedThread())
+    {
+        if (pthread_mutex_trylock(mutex) == 0)
+        {
+            notify(Kind::lock, "pthread_mutex_lock");
+            return 0;
+        }
+
+        notify(Kind::lockWait, "pthread_mutex_lock");
+    }
+
+    return findNext<int (*)(pthread_mutex_t*)>(next, "pthread_mutex_lock")(mutex);
+}
+
+extern "C" int open(const char* path, int flags, ...)
+{
+    static std::atomic<void*> next { nullptr };
+    int mode = 0;
+
+    if ((flags & O_CREAT) != 0)
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, int);
+        va_end(args);
+    }
+
+    notify(Kind::fileAccess, "open");
+    return findNext<int (*)(const char*, int, ...)>(next, "open")(path, flags, mode);
+}
+
+extern "C" ssize_t read(int fileDescriptor, void* buffer, size_t size)
+{
+    static std::atomic<void*> next { nullptr };
+
+    notify(Kind::fileAccess, "read");
+    return findNext<ssize_t (*)(int, void*, size_t)>(next, "read")(fileDescriptor, buffer, size);
+}
+
+extern "C" ssize_t write(int fileDescriptor, const void* buffer, size_t size)
+{
+    static std::atomic<void*> next { nullptr };
+
+    notify(Kind::fileAccess, "write");
+    return findNext<ssize_t (*)(int, const void*, size_t)>(next, "write")(fileDescriptor, buffer, size);
+}
+
+// Standard streams, std::cerr included, go through these rather than write()
+extern "C" FILE* fopen(const char* path, const char* mode)
+{
+    static std::atomic<void*> next { nullptr };
+
+    notify(Kind::fileAccess, "fopen");
+    return findNext<FILE* (*)(const char*, const char*)>(next, "fopen")(path, mode);
+}
+
+extern "C" size_t fread(void* buffer, size_t size, size_t count, FILE* stream)
+{
+    static std::atomic<void*> next { nullptr };
+
+    notify(Kind::fileAccess, "fread");
+    return findNext<size_t (*)(void*, size_t, size_t, FILE*)>(next, "fread")(buffer, size, count, stream);
+}
+
+extern "C" size_t fwrite(const void* buffer, size_t size, size_t count, FILE* stream)
+{
+    static std::atomic<void*> next { nullptr };
+
+    notify(Kind::fileAccess, "fwrite");
+    return findNext<size_t (*)(const void*, size_t, size_t, FILE*)>(next, "fwrite")(buffer, size, count, stream);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Set to 1 in a debug or test build to compile the interceptors in
+#ifndef STRETCHER_REALTIME_SANITIZER
+ #define STRETCHER_REALTIME_SANITIZER 0
+#endif
+
+// Catches the audio thread doing things that can block: allocating or freeing memory,
+// taking a lock, touching a file or logging. StretcherEngine::processBlock() marks its
+// thread for the length of each block. With STRETCHER_REALTIME_SANITIZER set to 1 the
+// process's malloc, free, pthread_mutex_lock and file calls are intercepted on Linux and
+// macOS, and every one made from a marked thread is recorded with a stack trace. Repeats
+// from the same call stack are counted rather than recorded again.
+//
+// Without the flag the markers compile to nothing and no violations are ever recorded.
+namespace RealtimeSanitizer
+{
+    enum class Kind
+    {
+        allocation,
+        deallocation,
+        lock,               // Took a lock that was free; it could have had to wait
+        lockWait,           // Had to wait for a lock another thread held
+        fileAccess,
+        logging
+    };
+
+    struct Violation
+    {
+        Kind kind;
+        juce::String call;
+        juce::String stackTrace;
+        int count = 0;
+    };
+
+    constexpr bool isAvailable() { return STRETCHER_REALTIME_SANITIZER != 0; }
+
+    // Marks the calling thread as real-time until destroyed. Nests.
+    class ScopedAudioThread
+    {
+    public:
+        ScopedAudioThread() noexcept;
+        ~ScopedAudioThread() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAudioThread)
+    };
+
+    // Suspends checking on the calling thread, for work the audio thread is allowed to do
+    class ScopedPermit
+    {
+    public:
+        ScopedPermit() noexcept;
+        ~ScopedPermit() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedPermit)
+    };
+
+    bool isCheckedThread() noexcept;
+
+    // Records a violation if the calling thread is marked and not permitted. The
+    // interceptors call this; so can anything that knows it should not run in real time.
+    void notify(Kind kind, const char* call) noexcept;
+
+    std::vector<Violation> getViolations();
+    void clearViolations();
+
+    // Prints the first violation with its stack and aborts, like a compiler sanitizer
+    void setAbortOnViolation(bool shouldAbort);
+
+    juce::String getKindName(Kind kind);
+}
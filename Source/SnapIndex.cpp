@@ -0,0 +1,173 @@
+#include "SnapIndex.h"
+#include "Spectrogram.h"
+#include "TempoAnalysis.h"
+#include <algorithm>
+#include <cmath>
+
+SnapIndex::SnapIndex()
+    : sampleRate(44100.0),
+      memory(MemoryAccounting::snapIndices)
+{
+}
+
+void SnapIndex::build(const std::vector<float>& samples, const std::vector<float>& onsetStrength, double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    crossingOffsets.clear();
+    transients.clear();
+
+    const juce::int64 numSamples = (juce::int64)samples.size();
+    const size_t numPages = (size_t)(numSamples >> pageBits) + 1;
+
+    // Count crossings per page one slot along, then accumulate into start indices
+    pageStarts.assign(numPages + 1, 0);
+
+    for (juce::int64 i = 1; i < numSamples; ++i)
+    {
+        if (samples[(size_t)i - 1] < 0.0f && samples[(size_t)i] >= 0.0f)
+        {
+            crossingOffsets.push_back((juce::uint16)(i & ((1 << pageBits) - 1)));
+            ++pageStarts[(size_t)(i >> pageBits) + 1];
+        }
+    }
+
+    for (size_t page = 1; page <= numPages; ++page)
+        pageStarts[page] += pageStarts[page - 1];
+
+    crossingOffsets.shrink_to_fit();
+
+    // Onset frames only place a hit within one FFT window; the attack is where the
+    // signal first reaches half the window's peak
+    for (double onsetTime : TempoAnalysis::pickOnsetTimes(onsetStrength, sampleRate))
+    {
+        const juce::int64 windowStart = juce::jlimit((juce::int64)0, numSamples, (juce::int64)std::llround(onsetTime * sampleRate));
+        const juce::int64 windowEnd = juce::jmin(numSamples, windowStart + Spectrogram::fftSize);
+
+        if (windowEnd <= windowStart)
+            continue;
+
+        float peak = 0.0f;
+        for (juce::int64 i = windowStart; i < windowEnd; ++i)
+            peak = juce::jmax(peak, std::abs(samples[(size_t)i]));
+
+        juce::int64 attack = windowStart;
+        while (attack < windowEnd - 1 && std::abs(samples[(size_t)attack]) < peak * 0.5f)
+            ++attack;
+
+        transients.push_back(attack);
+    }
+
+    std::sort(transients.begin(), transients.end());
+    transients.erase(std::unique(transients.begin(), transients.end()), transients.end());
+
+    memory.set(MemoryAccounting::bytesOf(crossingOffsets) + MemoryAccounting::bytesOf(pageStarts)
+               + MemoryAccounting::bytesOf(transients));
+}
+
+double SnapIndex::snapToZeroCrossing(double timeInSeconds, double maxDistance) const
+{
+    const juce::int64 crossing = findNearestCrossing((juce::int64)std::llround(timeInSeconds * sampleRate),
+                                                     (juce::int64)(juce::jmax(0.0, maxDistance) * sampleRate));
+    return crossing >= 0 ? crossing / sampleRate : timeInSeconds;
+}
+
+double SnapIndex::snapToTransient(double timeInSeconds, double maxDistance) const
+{
+    const juce::int64 transient = findNearestTransient((juce::int64)std::llround(timeInSeconds * sampleRate),
+                                                       (juce::int64)(juce::jmax(0.0, maxDistance) * sampleRate));
+    return transient >= 0 ? transient / sampleRate : timeInSeconds;
+}
+
+double SnapIndex::snapEdge(double timeInSeconds, double maxDistance) const
+{
+    const juce::int64 position = (juce::int64)std::llround(timeInSeconds * sampleRate);
+    const juce::int64 reach = (juce::int64)(juce::jmax(0.0, maxDistance) * sampleRate);
+    const juce::int64 transient = findNearestTransient(position, reach);
+
+    if (transient >= 0)
+    {
+        const size_t next = findFirstCrossingFrom(transient + 1);
+
+        if (next > 0)
+        {
+            const juce::int64 crossing = getCrossing(next - 1);
+
+            if (transient - crossing <= (juce::int64)(0.005 * sampleRate))
+                return crossing / sampleRate;
+        }
+
+        return transient / sampleRate;
+    }
+
+    const juce::int64 crossing = findNearestCrossing(position, reach);
+    return crossing >= 0 ? crossing / sampleRate : timeInSeconds;
+}
+
+juce::int64 SnapIndex::getCrossing(size_t index) const
+{
+    // Empty pages share their start with the next page, so the last match owns the index
+    const auto page = std::upper_bound(pageStarts.begin(), pageStarts.end(), (juce::uint32)index) - pageStarts.begin() - 1;
+    return ((juce::int64)page << pageBits) + crossingOffsets[index];
+}
+
+size_t SnapIndex::findFirstCrossingFrom(juce::int64 samplePosition) const
+{
+    if (samplePosition <= 0)
+        return 0;
+
+    const juce::int64 page = samplePosition >> pageBits;
+
+    if (page >= (juce::int64)pageStarts.size() - 1)
+        return crossingOffsets.size();
+
+    const auto first = crossingOffsets.begin() + pageStarts[(size_t)page];
+    const auto last = crossingOffsets.begin() + pageStarts[(size_t)page + 1];
+    const auto found = std::lower_bound(first, last, (juce::uint16)(samplePosition & ((1 << pageBits) - 1)));
+
+    // Past the page's last crossing this lands on the next page's first, as wanted
+    return (size_t)(found - crossingOffsets.begin());
+}
+
+juce::int64 SnapIndex::findNearestCrossing(juce::int64 samplePosition, juce::int64 maxDistance) const
+{
+    const size_t next = findFirstCrossingFrom(samplePosition);
+    juce::int64 best = -1;
+    juce::int64 bestDistance = maxDistance + 1;
+
+    if (next < crossingOffsets.size())
+    {
+        const juce::int64 crossing = getCrossing(next);
+        if (crossing - samplePosition < bestDistance)
+        {
+            best = crossing;
+            bestDistance = crossing - samplePosition;
+        }
+    }
+
+    if (next > 0)
+    {
+        const juce::int64 crossing = getCrossing(next - 1);
+        if (samplePosition - crossing < bestDistance)
+            best = crossing;
+    }
+
+    return best;
+}
+
+juce::int64 SnapIndex::findNearestTransient(juce::int64 samplePosition, juce::int64 maxDistance) const
+{
+    const auto next = std::lower_bound(transients.begin(), transients.end(), samplePosition);
+    juce::int64 best = -1;
+    juce::int64 bestDistance = maxDistance + 1;
+
+    if (next != transients.end() && *next - samplePosition < bestDistance)
+    {
+        best = *next;
+        bestDistance = *next - samplePosition;
+    }
+
+    if (next != transients.begin() && samplePosition - *(next - 1) < bestDistance)
+        best = *(next - 1);
+
+    return best;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryAccounting.h"
+#include <vector>
+
+// Points in a file where an edit or loop point sounds clean: rising zero crossings of the
+// mono mix, and transients picked from the onset envelope. Built once at load, then only
+// read, so it can be shared with the UI. Lookups are binary searches, which keeps
+// snapping instant while dragging, even on hour-long files.
+class SnapIndex
+{
+public:
+    SnapIndex();
+
+    // The onset envelope has one value per Spectrogram::hopSize samples
+    void build(const std::vector<float>& samples, const std::vector<float>& onsetStrength, double sampleRate);
+
+    bool isEmpty() const { return crossingOffsets.empty() && transients.empty(); }
+    int getNumZeroCrossings() const { return (int)crossingOffsets.size(); }
+    int getNumTransients() const { return (int)transients.size(); }
+
+    // The nearest point within maxDistance seconds, or the time unchanged if there is none
+    double snapToZeroCrossing(double timeInSeconds, double maxDistance) const;
+    double snapToTransient(double timeInSeconds, double maxDistance) const;
+
+    // For selection edges: a transient within reach wins, otherwise the nearest zero
+    // crossing. A transient is moved back onto the rising zero crossing just before its
+    // attack, so a loop cut there neither clicks nor clips the hit.
+    double snapEdge(double timeInSeconds, double maxDistance) const;
+
+private:
+    // Crossings are kept as 16-bit offsets into pages of 65536 samples. pageStarts[p] is
+    // the index of the first crossing at or after page p, with one extra entry at the end.
+    static constexpr int pageBits = 16;
+
+    std::vector<juce::uint16> crossingOffsets;
+    std::vector<juce::uint32> pageStarts;
+    std::vector<juce::int64> transients;
+    double sampleRate;
+    MemoryAccounting::Allocation memory;
+
+    juce::int64 getCrossing(size_t index) const;
+    size_t findFirstCrossingFrom(juce::int64 samplePosition) const;
+    juce::int64 findNearestCrossing(juce::int64 samplePosition, juce::int64 maxDistance) const;
+    juce::int64 findNearestTransient(juce::int64 samplePosition, juce::int64 maxDistance) const;
+};
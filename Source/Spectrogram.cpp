@@ -0,0 +1,121 @@
+#include "Spectrogram.h"
+#include <cmath>
+
+Spectrogram::Analyser::Analyser(double sampleRate)
+    : fft(fftOrder),
+      window((size_t)fftSize),
+      fftData((size_t)fftSize * 2),
+      bandEdges((size_t)numBands + 1)
+{
+    const double twoPi = juce::MathConstants<double>::twoPi;
+
+    for (int i = 0; i < fftSize; ++i)
+        window[(size_t)i] = (float)(0.5 - 0.5 * std::cos(twoPi * i / fftSize));
+
+    // Log-spaced band edges, each band at least one bin wide
+    const double lowestFrequency = 30.0;
+    const double nyquist = sampleRate * 0.5;
+    const int lastBin = fftSize / 2;
+
+    for (int band = 0; band <= numBands; ++band)
+    {
+        double frequency = lowestFrequency * std::pow(nyquist / lowestFrequency, (double)band / numBands);
+        int bin = (int)std::round(frequency * fftSize / sampleRate);
+
+        if (band > 0)
+            bin = juce::jmax(bin, bandEdges[(size_t)band - 1] + 1);
+
+        bandEdges[(size_t)band] = juce::jmin(bin, lastBin + 1);
+    }
+}
+
+void Spectrogram::Analyser::analyseFrame(const float* samples, int numSamples, int firstSample, float* bandDecibels)
+{
+    std::fill(fftData.begin(), fftData.end(), 0.0f);
+
+    const int start = juce::jmax(0, firstSample);
+    const int end = juce::jmin(numSamples, firstSample + fftSize);
+
+    for (int i = start; i < end; ++i)
+        fftData[(size_t)(i - firstSample)] = samples[i] * window[(size_t)(i - firstSample)];
+
+    fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    // A full-scale sine under a Hann window peaks at fftSize / 4
+    const float magnitudeScale = 4.0f / fftSize;
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const int firstBin = bandEdges[(size_t)band];
+        const int lastBin = juce::jmax(firstBin + 1, bandEdges[(size_t)band + 1]);
+        float power = 0.0f;
+
+        for (int bin = firstBin; bin < lastBin; ++bin)
+        {
+            float magnitude = fftData[(size_t)bin] * magnitudeScale;
+            power += magnitude * magnitude;
+        }
+
+        power /= (float)(lastBin - firstBin);
+        bandDecibels[band] = juce::jmax(floorDecibels, 10.0f * std::log10(power + 1.0e-12f));
+    }
+}
+
+Spectrogram::Spectrogram()
+    : sampleRate(44100.0),
+      numFrames(0),
+      memory(MemoryAccounting::spectrograms)
+{
+}
+
+void Spectrogram::build(const std::vector<float>& samples, double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    levels.clear();
+    onsetStrength.clear();
+    numFrames = 0;
+
+    const int numSamples = (int)samples.size();
+
+    if (numSamples <= fftSize)
+    {
+        memory.set(0);
+        return;
+    }
+
+    numFrames = (numSamples - fftSize + hopSize - 1) / hopSize;
+    levels.resize((size_t)numFrames * numBands);
+    onsetStrength.resize((size_t)numFrames);
+    memory.set(MemoryAccounting::bytesOf(levels) + MemoryAccounting::bytesOf(onsetStrength));
+
+    Analyser analyser(sampleRate);
+    std::vector<float> bands((size_t)numBands);
+    std::vector<float> compressed((size_t)numBands);
+    std::vector<float> previousCompressed((size_t)numBands, 0.0f);
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        analyser.analyseFrame(samples.data(), numSamples, frame * hopSize, bands.data());
+
+        // Rise in log-compressed amplitude summed across bands; decays and steady tones
+        // contribute nothing. Flux on decibels lets noise in quiet bands swamp the hits.
+        float flux = 0.0f;
+        juce::uint8* frameLevels = levels.data() + (size_t)frame * numBands;
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            compressed[(size_t)band] = std::log1p(100.0f * juce::Decibels::decibelsToGain(bands[(size_t)band], floorDecibels));
+            flux += juce::jmax(0.0f, compressed[(size_t)band] - previousCompressed[(size_t)band]);
+            frameLevels[band] = quantise(bands[(size_t)band]);
+        }
+
+        onsetStrength[(size_t)frame] = flux;
+        std::swap(compressed, previousCompressed);
+    }
+}
+
+juce::uint8 Spectrogram::quantise(float decibels)
+{
+    float normalised = (decibels - floorDecibels) / -floorDecibels;
+    return (juce::uint8)juce::jlimit(0, 255, juce::roundToInt(normalised * 255.0f));
+}
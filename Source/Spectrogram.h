@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryAccounting.h"
+#include <vector>
+
+// Short-time spectrum of a file's mono mix in log-spaced bands, computed once at load.
+// The same transform feeds the onset detector (spectral flux between frames), so the
+// spectrogram view adds no FFT work of its own at the hop resolution.
+class Spectrogram
+{
+public:
+    static constexpr int fftOrder = 10;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = 512;
+    static constexpr int numBands = 64;
+    static constexpr float floorDecibels = -80.0f;
+
+    // FFT and scratch space for one thread
+    class Analyser
+    {
+    public:
+        explicit Analyser(double sampleRate);
+
+        // Band levels in dB of the frame starting at firstSample, lowest band first.
+        // Samples outside [0, numSamples) count as silence.
+        void analyseFrame(const float* samples, int numSamples, int firstSample, float* bandDecibels);
+
+    private:
+        juce::dsp::FFT fft;
+        std::vector<float> window;
+        std::vector<float> fftData;     // Twice fftSize, as the frequency-only transform needs
+        std::vector<int> bandEdges;     // numBands + 1 FFT bins, log-spaced from 30 Hz
+    };
+
+    Spectrogram();
+
+    void build(const std::vector<float>& samples, double sampleRate);
+
+    bool isEmpty() const { return numFrames == 0; }
+    int getNumFrames() const { return numFrames; }
+    double getSampleRate() const { return sampleRate; }
+    double getFramesPerSecond() const { return sampleRate / hopSize; }
+
+    // Quantised band levels (0 at floorDecibels up to 255 at full scale) of a frame
+    const juce::uint8* getFrame(int frameIndex) const { return levels.data() + (size_t)frameIndex * numBands; }
+
+    // Half-wave rectified spectral flux, one value per frame
+    const std::vector<float>& getOnsetStrength() const { return onsetStrength; }
+
+    static juce::uint8 quantise(float decibels);
+
+private:
+    double sampleRate;
+    int numFrames;
+    std::vector<juce::uint8> levels;
+    std::vector<float> onsetStrength;
+    MemoryAccounting::Allocation memory;
+};
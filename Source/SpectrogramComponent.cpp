@@ -0,0 +1,305 @@
+#include "SpectrogramComponent.h"
+#include <array>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+    // Dark to bright, so quiet bins sink into the background
+    const std::array<juce::Colour, 256>& getPalette()
+    {
+        static const std::array<juce::Colour, 256> palette = []
+        {
+            const std::pair<float, juce::Colour> stops[] =
+            {
+                { 0.0f,  juce::Colour(0xff000000) },
+                { 0.35f, juce::Colour(0xff1a0a4a) },
+                { 0.6f,  juce::Colour(0xff8a1f7a) },
+                { 0.8f,  juce::Colour(0xfff0702a) },
+                { 1.0f,  juce::Colour(0xfffff2a0) }
+            };
+
+            std::array<juce::Colour, 256> colours;
+
+            for (int i = 0; i < 256; ++i)
+            {
+                float position = i / 255.0f;
+                size_t stop = 1;
+
+                while (stop < 4 && stops[stop].first < position)
+                    ++stop;
+
+                float proportion = (position - stops[stop - 1].first) / (stops[stop].first - stops[stop - 1].first);
+                colours[(size_t)i] = stops[stop - 1].second.interpolatedWith(stops[stop].second, proportion);
+            }
+
+            return colours;
+        }();
+
+        return palette;
+    }
+}
+
+SpectrogramComponent::SpectrogramComponent()
+    : viewStartTime(0.0),
+      viewEndTime(0.0),
+      useCounter(0),
+      currentLevel(INT_MIN),
+      tileScale(1.0f),
+      tileMemory(MemoryAccounting::spectrogramImages),
+      generation(std::make_shared<std::atomic<int>>(0))
+{
+    setOpaque(true);
+}
+
+SpectrogramComponent::~SpectrogramComponent()
+{
+    // Queued jobs see the new generation and return without rendering
+    ++*generation;
+}
+
+void SpectrogramComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff101010));
+
+    if (spectrogram == nullptr || spectrogram->isEmpty() || viewEndTime <= viewStartTime || getWidth() <= 0)
+        return;
+
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (scale != tileScale)
+    {
+        tileScale = scale;
+        discardTiles();
+    }
+
+    const double pixelsPerSecond = getWidth() / (viewEndTime - viewStartTime);
+    const int level = juce::roundToInt(std::log2(pixelsPerSecond) * 4.0);
+
+    if (level != currentLevel)
+    {
+        // Tiles already queued for the old zoom are no longer worth rendering
+        currentLevel = level;
+        ++*generation;
+        pendingTiles.clear();
+    }
+
+    const double levelPixelsPerSecond = getLevelPixelsPerSecond(level);
+    const double tileDuration = tileWidth / levelPixelsPerSecond;
+    const int firstTile = juce::jmax(0, (int)std::floor(viewStartTime / tileDuration));
+    const int lastTile = (int)std::floor(viewEndTime / tileDuration);
+    const float height = (float)getHeight();
+
+    for (int index = firstTile; index <= lastTile; ++index)
+    {
+        const TileKey key { level, index };
+        const double tileStart = index * tileDuration;
+        const double tileEnd = tileStart + tileDuration;
+        const juce::Rectangle<float> destination((float)((tileStart - viewStartTime) * pixelsPerSecond), 0.0f,
+                                                 (float)(tileDuration * pixelsPerSecond), height);
+
+        auto found = tiles.find(key);
+
+        if (found != tiles.end())
+        {
+            found->second.lastUsed = ++useCounter;
+            g.drawImage(found->second.image, destination);
+            continue;
+        }
+
+        requestTile(key, levelPixelsPerSecond);
+
+        // Stand in with whatever other zoom levels have for this stretch
+        juce::Graphics::ScopedSaveState state(g);
+        g.reduceClipRegion(destination.getSmallestIntegerContainer());
+
+        for (const auto& tile : tiles)
+        {
+            if (tile.first.level != level && tile.second.endTime > tileStart && tile.second.startTime < tileEnd)
+            {
+                g.drawImage(tile.second.image,
+                            juce::Rectangle<float>((float)((tile.second.startTime - viewStartTime) * pixelsPerSecond), 0.0f,
+                                                   (float)((tile.second.endTime - tile.second.startTime) * pixelsPerSecond), height));
+            }
+        }
+    }
+
+    evictOldTiles();
+}
+
+void SpectrogramComponent::resized()
+{
+    discardTiles();
+}
+
+void SpectrogramComponent::setData(std::shared_ptr<const Spectrogram> newSpectrogram,
+                                   std::shared_ptr<const WaveformPeaks> newPeaks)
+{
+    spectrogram = std::move(newSpectrogram);
+    peaks = std::move(newPeaks);
+    discardTiles();
+    repaint();
+}
+
+void SpectrogramComponent::setVisibleRange(double startTime, double endTime)
+{
+    if (startTime != viewStartTime || endTime != viewEndTime)
+    {
+        viewStartTime = startTime;
+        viewEndTime = endTime;
+        repaint();
+    }
+}
+
+double SpectrogramComponent::getLevelPixelsPerSecond(int level)
+{
+    return std::pow(2.0, level / 4.0);
+}
+
+void SpectrogramComponent::requestTile(const TileKey& key, double levelPixelsPerSecond)
+{
+    if (pendingTiles.count(key) > 0)
+        return;
+
+    pendingTiles.insert(key);
+
+    const double startTime = key.index * tileWidth / levelPixelsPerSecond;
+    const double endTime = startTime + tileWidth / levelPixelsPerSecond;
+    const double secondsPerPixel = 1.0 / (levelPixelsPerSecond * tileScale);
+    const int width = juce::roundToInt(tileWidth * tileScale);
+    const int height = juce::roundToInt(getHeight() * tileScale);
+    const int tileGeneration = generation->load();
+
+    std::shared_ptr<const Spectrogram> tileSpectrogram = spectrogram;
+    std::shared_ptr<const WaveformPeaks> tilePeaks = peaks;
+    std::shared_ptr<std::atomic<int>> currentGeneration = generation;
+    juce::Component::SafePointer<SpectrogramComponent> safeThis(this);
+
+    pool->threads.addJob([=]
+    {
+        if (currentGeneration->load() != tileGeneration)
+            return;
+
+        juce::Image image = renderTile(*tileSpectrogram, tilePeaks.get(), startTime, secondsPerPixel, width, height);
+
+        juce::MessageManager::callAsync([safeThis, key, tileGeneration, image, startTime, endTime]
+        {
+            if (safeThis != nullptr)
+                safeThis->tileRendered(key, tileGeneration, image, startTime, endTime);
+        });
+    });
+}
+
+void SpectrogramComponent::tileRendered(const TileKey& key, int tileGeneration, const juce::Image& image,
+                                        double startTime, double endTime)
+{
+    if (tileGeneration != generation->load())
+        return;
+
+    pendingTiles.erase(key);
+    tiles[key] = { image, startTime, endTime, ++useCounter };
+    countTileMemory();
+    repaint();
+}
+
+void SpectrogramComponent::discardTiles()
+{
+    tiles.clear();
+    pendingTiles.clear();
+    ++*generation;
+    countTileMemory();
+}
+
+void SpectrogramComponent::evictOldTiles()
+{
+    while ((int)tiles.size() > maxCachedTiles)
+    {
+        auto oldest = tiles.begin();
+
+        for (auto it = tiles.begin(); it != tiles.end(); ++it)
+        {
+            if (it->second.lastUsed < oldest->second.lastUsed)
+                oldest = it;
+        }
+
+        tiles.erase(oldest);
+    }
+
+    countTileMemory();
+}
+
+void SpectrogramComponent::countTileMemory()
+{
+    size_t bytes = 0;
+
+    for (const auto& entry : tiles)
+        bytes += MemoryAccounting::bytesOf(entry.second.image);
+
+    tileMemory.set(bytes);
+}
+
+juce::Image SpectrogramComponent::renderTile(const Spectrogram& spectrogram, const WaveformPeaks* peaks,
+                                             double startTime, double secondsPerPixel, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return {};
+
+    juce::Image image(juce::Image::RGB, width, height, false, juce::SoftwareImageType());
+    juce::Image::BitmapData pixels(image, juce::Image::BitmapData::writeOnly);
+
+    const auto& palette = getPalette();
+    const double sampleRate = spectrogram.getSampleRate();
+    const int numFrames = spectrogram.getNumFrames();
+    const double frameOffset = Spectrogram::fftSize * 0.5; // Frames are timed at their centre
+
+    // Past one frame per column, analyse the samples under each column directly
+    const bool analyseColumns = secondsPerPixel * spectrogram.getFramesPerSecond() < 1.0
+                                && peaks != nullptr && !peaks->isEmpty();
+    std::unique_ptr<Spectrogram::Analyser> analyser;
+
+    if (analyseColumns)
+        analyser = std::make_unique<Spectrogram::Analyser>(sampleRate);
+
+    std::array<juce::uint8, Spectrogram::numBands> column {};
+    std::array<float, Spectrogram::numBands> bandDecibels {};
+
+    for (int x = 0; x < width; ++x)
+    {
+        const double columnStart = startTime + x * secondsPerPixel;
+        const double columnEnd = columnStart + secondsPerPixel;
+
+        if (analyseColumns)
+        {
+            const double centreSample = (columnStart + columnEnd) * 0.5 * sampleRate;
+            analyser->analyseFrame(peaks->getSamples().data(), peaks->getNumSamples(),
+                                   (int)std::round(centreSample - frameOffset), bandDecibels.data());
+
+            for (int band = 0; band < Spectrogram::numBands; ++band)
+                column[(size_t)band] = Spectrogram::quantise(bandDecibels[(size_t)band]);
+        }
+        else
+        {
+            // Loudest of the frames the column spans, so short hits survive zooming out
+            const int firstFrame = (int)std::floor((columnStart * sampleRate - frameOffset) / Spectrogram::hopSize + 0.5);
+            const int endFrame = juce::jmax(firstFrame + 1, (int)std::floor((columnEnd * sampleRate - frameOffset) / Spectrogram::hopSize + 0.5));
+
+            column.fill(0);
+
+            for (int frame = juce::jmax(0, firstFrame); frame < juce::jmin(endFrame, numFrames); ++frame)
+            {
+                const juce::uint8* levels = spectrogram.getFrame(frame);
+
+                for (int band = 0; band < Spectrogram::numBands; ++band)
+                    column[(size_t)band] = juce::jmax(column[(size_t)band], levels[band]);
+            }
+        }
+
+        for (int y = 0; y < height; ++y)
+        {
+            const int band = (height - 1 - y) * Spectrogram::numBands / height;
+            pixels.setPixelColour(x, y, palette[(size_t)column[(size_t)band]]);
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Spectrogram.h"
+#include "WaveformPeaks.h"
+#include "MemoryAccounting.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+
+// Worker threads shared by every spectrogram lane
+struct SpectrogramTilePool
+{
+    juce::ThreadPool threads { juce::ThreadPoolOptions()
+                                   .withThreadName("Spectrogram Tiles")
+                                   .withNumberOfThreads(juce::jmax(1, juce::SystemStats::getNumCpus() - 1)) };
+};
+
+// Optional spectrogram lane under a track's waveform. The view is split into fixed-width
+// tiles per zoom level (quarter-octave steps of pixels per second); tiles are rendered on
+// the thread pool and cached, so repaints and pans only blit. While a tile is missing,
+// any cached tile from another zoom level that overlaps it is drawn stretched instead.
+class SpectrogramComponent : public juce::Component
+{
+public:
+    SpectrogramComponent();
+    ~SpectrogramComponent() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    // The peaks' mono mix is used to compute extra frames when zoomed in past the hop size
+    void setData(std::shared_ptr<const Spectrogram> spectrogram, std::shared_ptr<const WaveformPeaks> peaks);
+    void setVisibleRange(double startTime, double endTime);
+
+    // Renders one tile; safe to call on any thread
+    static juce::Image renderTile(const Spectrogram& spectrogram, const WaveformPeaks* peaks,
+                                  double startTime, double secondsPerPixel, int width, int height);
+
+private:
+    struct TileKey
+    {
+        int level;
+        int index;
+
+        bool operator<(const TileKey& other) const
+        {
+            return level != other.level ? level < other.level : index < other.index;
+        }
+    };
+
+    struct CachedTile
+    {
+        juce::Image image;
+        double startTime;
+        double endTime;
+        juce::uint32 lastUsed;
+    };
+
+    static constexpr int tileWidth = 128;        // Logical pixels
+    static constexpr int maxCachedTiles = 96;
+
+    juce::SharedResourcePointer<SpectrogramTilePool> pool;
+
+    std::shared_ptr<const Spectrogram> spectrogram;
+    std::shared_ptr<const WaveformPeaks> peaks;
+    double viewStartTime;
+    double viewEndTime;
+
+    std::map<TileKey, CachedTile> tiles;
+    std::set<TileKey> pendingTiles;
+    juce::uint32 useCounter;
+    int currentLevel;
+    float tileScale;
+    MemoryAccounting::Allocation tileMemory;
+
+    // Bumped whenever queued tiles become useless, so workers skip them
+    std::shared_ptr<std::atomic<int>> generation;
+
+    static double getLevelPixelsPerSecond(int level);
+    void requestTile(const TileKey& key, double levelPixelsPerSecond);
+    void tileRendered(const TileKey& key, int tileGeneration, const juce::Image& image, double startTime, double endTime);
+    void discardTiles();
+    void evictOldTiles();
+    void countTileMemory();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramComponent)
+};
@@ -0,0 +1,207 @@
+#include "StemExporter.h"
+#include "TraceRecorder.h"
+#include <vector>
+
+// Runs one export off the message thread, then reports back on it
+class StemExporter::ExportThread : public juce::Thread
+{
+public:
+    ExportThread(StemExporter& owner, const juce::File& folder, const Settings& exportSettings,
+                 std::function<void(juce::Result)> callback)
+        : juce::Thread("Stem Export"),
+          exporter(owner),
+          outputFolder(folder),
+          settings(exportSettings),
+          onFinished(std::move(callback))
+    {
+    }
+
+    void run() override
+    {
+        juce::Result result = exporter.exportStems(outputFolder, settings);
+
+        if (onFinished)
+        {
+            auto callback = onFinished;
+            juce::MessageManager::callAsync([callback, result] { callback(result); });
+        }
+    }
+
+private:
+    StemExporter& exporter;
+    juce::File outputFolder;
+    Settings settings;
+    std::function<void(juce::Result)> onFinished;
+};
+
+StemExporter::StemExporter(StretcherEngine& engineToExport)
+    : engine(engineToExport),
+      exporting(false),
+      shouldCancel(false),
+      progress(0.0),
+      samplesRendered(0)
+{
+}
+
+StemExporter::~StemExporter()
+{
+    if (exportThread)
+    {
+        cancel();
+        exportThread->stopThread(10000);
+    }
+}
+
+void StemExporter::exportStemsAsync(const juce::File& folder, const Settings& settings, std::function<void(juce::Result)> onFinished)
+{
+    if (exportThread)
+    {
+        cancel();
+        exportThread->stopThread(10000);
+    }
+
+    exportThread = std::make_unique<ExportThread>(*this, folder, settings, std::move(onFinished));
+    exportThread->startThread();
+}
+
+juce::Result StemExporter::exportStems(const juce::File& folder, const Settings& settings)
+{
+    TraceRecorder::Scope trace("exportStems", "render");
+
+    if (!folder.isDirectory() && !folder.createDirectory())
+        return juce::Result::fail("Could not create " + folder.getFullPathName());
+
+    const double sampleRate = engine.getSampleRate();
+    std::vector<Stem> stems;
+    juce::int64 totalSamples = 0;
+
+    for (int i = 0; i < StretcherEngine::maxTracks; ++i)
+    {
+        AudioTrack* track = engine.getTrack(i);
+
+        if (track == nullptr || !track->isLoaded() || track->isLoadingFile())
+            continue;
+
+        // One pass of the loop region, with any followed tempo map integrated over it. Its
+        // settings are fixed here, so edits made while the stems render don't change them.
+        Stem stem;
+        stem.track = track;
+        stem.pass = track->getLoopPass(blockSize);
+
+        const juce::String name = juce::File::createLegalFileName(stem.pass.name);
+        stem.file = folder.getChildFile(juce::String::formatted("%02d ", i + 1) + name + settings.fileExtension);
+
+        if (stem.pass.lengthInSamples > 0)
+        {
+            totalSamples += stem.pass.lengthInSamples;
+            stems.push_back(stem);
+        }
+    }
+
+    if (stems.empty())
+        return juce::Result::fail("No tracks are loaded");
+
+    exporting = true;
+    shouldCancel = false;
+    progress = 0.0;
+    samplesRendered = 0;
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    engine.beginOfflineRender(blockSize, settings.numChannels);
+
+    juce::StringArray errors;
+    juce::CriticalSection errorLock;
+
+    {
+        const int numThreads = settings.numThreads > 0 ? settings.numThreads : juce::SystemStats::getNumCpus();
+        juce::ThreadPool pool(juce::jmin(numThreads, (int)stems.size()));
+
+        for (const Stem& stem : stems)
+        {
+            pool.addJob([this, &stem, &settings, &errors, &errorLock, totalSamples]
+            {
+                juce::String error = renderStem(stem, settings, totalSamples);
+
+                if (error.isNotEmpty())
+                {
+                    juce::ScopedLock sl(errorLock);
+                    errors.add(error);
+                }
+            });
+        }
+
+        // Destroying the pool would drop any job still queued, so wait for all of them
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(5);
+    }
+
+    engine.endOfflineRender();
+
+    const bool cancelled = shouldCancel.load();
+    exporting = false;
+
+    if (cancelled)
+    {
+        for (const Stem& stem : stems)
+            stem.file.deleteFile();
+
+        return juce::Result::fail("Stem export cancelled");
+    }
+
+    if (!errors.isEmpty())
+        return juce::Result::fail(errors.joinIntoString("\n"));
+
+    const double elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+    juce::Logger::writeToLog("Exported " + juce::String((int)stems.size()) + " stems (" +
+                             juce::String(totalSamples / sampleRate, 1) + "s of audio) to " + folder.getFullPathName() +
+                             " in " + juce::String(elapsedSeconds, 2) + "s");
+
+    return juce::Result::ok();
+}
+
+juce::String StemExporter::renderStem(const Stem& stem, const Settings& settings, juce::int64 totalSamples)
+{
+    TraceRecorder::Scope trace("renderStem", "render");
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    juce::AudioFormat* format = formatManager.findFormatForFileExtension(settings.fileExtension);
+
+    if (format == nullptr)
+        return "Unsupported file type: " + settings.fileExtension;
+
+    stem.file.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream(stem.file.createOutputStream());
+
+    if (stream == nullptr)
+        return "Could not open " + stem.file.getFullPathName() + " for writing";
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), engine.getSampleRate(),
+                                                                            (unsigned int)settings.numChannels,
+                                                                            settings.bitsPerSample, {}, 0));
+
+    if (writer == nullptr)
+        return format->getFormatName() + " cannot be written at " + juce::String(settings.bitsPerSample) + " bits";
+
+    stream.release(); // The writer owns the stream now
+
+    juce::Result result = stem.track->renderLoopPass(stem.pass, settings.numChannels,
+                                                     [this, &stem, &writer, totalSamples](const juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        if (shouldCancel)
+            return juce::Result::fail("Stem export cancelled");
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+            return juce::Result::fail("Could not write " + stem.file.getFullPathName());
+
+        progress = (double)(samplesRendered += numSamples) / (double)totalSamples;
+        return juce::Result::ok();
+    });
+
+    // A cancelled export deletes its files and reports once for all stems
+    if (result.failed() && !shouldCancel)
+        return result.getErrorMessage();
+
+    return {};
+}
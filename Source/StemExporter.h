@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StretcherEngine.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Writes every loaded track to its own file, stretched to the master tempo and trimmed
+// to exactly one pass of its loop region. Each stem renders on its own pool thread
+// with the track's ratio, tempo map and volume, so it sounds as the track does in the
+// mix, and the whole export runs far faster than real time. SoundTouch's latency is
+// dropped and its tail flushed, so every stem starts on its loop start and lines up
+// with the others in a DAW. Mute and solo are ignored: a mix engineer wants every part.
+class StemExporter
+{
+public:
+    struct Settings
+    {
+        juce::String fileExtension = ".wav";    // .wav, .aiff or .flac
+        int numChannels = 2;
+        int bitsPerSample = 24;
+        int numThreads = 0;                     // 0 uses one per core
+    };
+
+    explicit StemExporter(StretcherEngine& engineToExport);
+    ~StemExporter();
+
+    // Exports on the calling thread into the folder, one "NN name" file per track. Live
+    // output is silent meanwhile, and the transport is left stopped and rewound.
+    juce::Result exportStems(const juce::File& folder, const Settings& settings);
+
+    // Exports on a background thread and calls back on the message thread
+    void exportStemsAsync(const juce::File& folder, const Settings& settings, std::function<void(juce::Result)> onFinished);
+
+    bool isExporting() const { return exporting.load(); }
+    double getProgress() const { return progress.load(); }
+    void cancel() { shouldCancel = true; }
+
+    static constexpr int blockSize = 4096;
+
+private:
+    class ExportThread;
+
+    struct Stem
+    {
+        AudioTrack* track = nullptr;
+        juce::File file;
+        AudioTrack::LoopPass pass;      // Taken before rendering starts, so UI edits don't reach it
+    };
+
+    StretcherEngine& engine;
+    std::unique_ptr<ExportThread> exportThread;
+    std::atomic<bool> exporting;
+    std::atomic<bool> shouldCancel;
+    std::atomic<double> progress;
+    std::atomic<juce::int64> samplesRendered;
+
+    juce::String renderStem(const Stem& stem, const Settings& settings, juce::int64 totalSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemExporter)
+};
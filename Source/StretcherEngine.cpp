@@ -0,0 +1,624 @@
+#include "StretcherEngine.h"
+#include "RealtimeSanitizer.h"
+#include "TraceRecorder.h"
+#include <cmath>
+#include <vector>
+
+StretcherEngine::StretcherEngine()
+    : sampleRate(44100.0),
+      masterTempo(120.0),
+      previousMasterTempo(120.0),
+      currentPlayPosition(0.0),
+      playing(false),
+      metronomeEnabled(false),
+      renderingOffline(false),
+      pendingTrackJobs(0),
+      trackBufferMemory(MemoryAccounting::scratchBuffers),
+      metronomePhase(0.0),
+      metronomeBeatInterval(60.0 / 120.0),
+      lastBeatTime(0.0),
+      metronomeVolume(0.5f),
+      displayPlayPosition(0.0)
+{
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        auto& track = audioTracks[(size_t)i];
+        track = std::make_unique<AudioTrack>();
+        track->setMasterBPM(masterTempo);
+        track->setProfiler(&profiler, i);
+    }
+}
+
+StretcherEngine::~StretcherEngine()
+{
+    for (auto& track : audioTracks)
+    {
+        track.reset();
+    }
+}
+
+void StretcherEngine::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    juce::ScopedLock sl(lock);
+
+    if (newSampleRate > 0.0)
+        sampleRate = newSampleRate;
+
+    for (auto& track : audioTracks)
+    {
+        track->prepareToPlay(samplesPerBlockExpected);
+    }
+}
+
+void StretcherEngine::processBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    RealtimeSanitizer::ScopedAudioThread audioThread;
+
+    // An offline render owns the transport; don't wait on its lock
+    if (renderingOffline)
+    {
+        buffer.clear(startSample, numSamples);
+        return;
+    }
+
+    // Timed from before the lock, since waiting for it eats into the deadline too
+    const juce::int64 blockStart = profiler.beginBlock();
+
+    juce::ScopedLock sl(lock);
+
+    if (renderingOffline)
+        buffer.clear(startSample, numSamples);
+    else
+        mixBlock(buffer, startSample, numSamples, nullptr);
+
+    profiler.endBlock(blockStart, numSamples, sampleRate);
+}
+
+void StretcherEngine::mixBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, juce::ThreadPool* pool)
+{
+    // Offline renders have no deadline, and no block is open to fold their times into
+    AudioProfiler* const blockProfiler = renderingOffline ? nullptr : &profiler;
+    AudioProfiler::StageTimer timer(blockProfiler, AudioProfiler::engineSlot, AudioProfiler::mix);
+
+    buffer.clear(startSample, numSamples);
+
+    if (!playing)
+        return;
+
+    bool hasSolo = false;
+    for (auto& track : audioTracks)
+    {
+        if (track->isSolo())
+        {
+            hasSolo = true;
+            break;
+        }
+    }
+
+    // Tracks time their own stages
+    timer.stop();
+
+    if (pool != nullptr)
+    {
+        renderTracksConcurrently(buffer, numSamples, *pool, hasSolo);
+    }
+    else
+    {
+        for (int i = 0; i < maxTracks; ++i)
+        {
+            AudioTrack& track = *audioTracks[(size_t)i];
+
+            if (track.isLoaded())
+            {
+                if (track.isMuted() || (hasSolo && !track.isSolo()))
+                    continue;
+
+                const juce::int64 trackStart = blockProfiler != nullptr ? blockProfiler->now() : 0;
+                track.processBlock(buffer, startSample, numSamples);
+
+                if (blockProfiler != nullptr)
+                    blockProfiler->addTrackTime(i, trackStart);
+            }
+        }
+    }
+
+    if (metronomeEnabled)
+    {
+        timer.next(AudioProfiler::metronome);
+        processMetronome(buffer, startSample, numSamples);
+    }
+
+    timer.next(AudioProfiler::mix);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+        masterMeter.addSamples(ch, buffer.getReadPointer(ch, startSample), numSamples);
+    }
+
+    masterMeter.publish();
+
+    currentPlayPosition += numSamples / sampleRate;
+    displayPlayPosition = currentPlayPosition;
+}
+
+AudioTrack* StretcherEngine::getTrack(int trackIndex) const
+{
+    if (trackIndex < 0 || trackIndex >= maxTracks)
+        return nullptr;
+
+    return audioTracks[(size_t)trackIndex].get();
+}
+
+// ============================================================================
+// Transport
+// ============================================================================
+
+void StretcherEngine::setPlaying(bool shouldPlay)
+{
+    juce::ScopedLock sl(lock);
+
+    if (shouldPlay && !playing)
+    {
+        for (auto& track : audioTracks)
+        {
+            track->setTransportPosition(currentPlayPosition);
+        }
+    }
+
+    playing = shouldPlay;
+}
+
+void StretcherEngine::stop()
+{
+    juce::ScopedLock sl(lock);
+
+    playing = false;
+    currentPlayPosition = 0.0;
+    displayPlayPosition = 0.0;
+
+    for (auto& track : audioTracks)
+    {
+        track->reset();
+    }
+}
+
+void StretcherEngine::setPlayPosition(double positionInSeconds)
+{
+    juce::ScopedLock sl(lock);
+
+    currentPlayPosition = juce::jmax(0.0, positionInSeconds);
+    displayPlayPosition = currentPlayPosition;
+
+    for (auto& track : audioTracks)
+    {
+        track->setTransportPosition(currentPlayPosition);
+    }
+}
+
+void StretcherEngine::setTrackPosition(int trackIndex, double positionInSeconds)
+{
+    AudioTrack* track = getTrack(trackIndex);
+
+    if (track == nullptr)
+        return;
+
+    juce::ScopedLock sl(lock);
+
+    track->setPosition(positionInSeconds);
+    currentPlayPosition = positionInSeconds;
+    displayPlayPosition = positionInSeconds;
+}
+
+// ============================================================================
+// Tempo
+// ============================================================================
+
+void StretcherEngine::setTempo(double bpm)
+{
+    juce::ScopedLock sl(lock);
+
+    double scaleFactor = bpm / previousMasterTempo;
+
+    for (auto& track : audioTracks)
+    {
+        if (track->isLoaded())
+        {
+            track->scaleStretchRatio(scaleFactor);
+        }
+    }
+
+    previousMasterTempo = masterTempo;
+    masterTempo = bpm;
+
+    metronomeBeatInterval = 60.0 / bpm;
+
+    for (auto& track : audioTracks)
+    {
+        track->setMasterBPM(bpm);
+    }
+}
+
+void StretcherEngine::setInitialMasterBPM(double bpm, AudioTrack* definingTrack)
+{
+    juce::ScopedLock sl(lock);
+
+    previousMasterTempo = masterTempo;
+    masterTempo = bpm;
+
+    metronomeBeatInterval = 60.0 / bpm;
+
+    if (definingTrack)
+    {
+        definingTrack->setStretchRatio(1.0);
+        definingTrack->setMasterBPM(bpm);
+    }
+
+    for (auto& track : audioTracks)
+    {
+        if (track.get() != definingTrack)
+        {
+            track->setMasterBPM(bpm);
+        }
+    }
+
+    juce::Logger::writeToLog("Initial Master BPM set to: " + juce::String(bpm, 1) +
+                            " by first loaded track (stretch factor: 1.00)");
+}
+
+double StretcherEngine::findAverageBPM() const
+{
+    std::vector<double> bpms;
+
+    for (auto& track : audioTracks)
+    {
+        if (track->isLoaded())
+        {
+            double bpm = track->getDetectedBPM();
+            if (bpm > 60.0 && bpm < 200.0)
+            {
+                bpms.push_back(bpm);
+            }
+        }
+    }
+
+    if (bpms.empty())
+        return 0.0;
+
+    double sum = 0.0;
+    for (double bpm : bpms)
+    {
+        sum += bpm;
+    }
+
+    return sum / bpms.size();
+}
+
+// ============================================================================
+// Loading and alignment
+// ============================================================================
+
+void StretcherEngine::loadTrack(int trackIndex, const juce::File& file, std::function<void()> onLoaded)
+{
+    if (AudioTrack* track = getTrack(trackIndex))
+    {
+        track->loadAudioFileAsync(file, std::move(onLoaded));
+    }
+}
+
+void StretcherEngine::trackFileLoaded(int trackIndex)
+{
+    TraceRecorder::Scope trace("trackFileLoaded", "load");
+
+    AudioTrack* track = getTrack(trackIndex);
+
+    if (!track)
+        return;
+
+    if (track->getDetectedBPM() > 0.0)
+    {
+        trackTempoDetected(track->getDetectedBPM());
+    }
+
+    // Line a newly stacked loop up with what is already there
+    alignTrackToMix(trackIndex);
+}
+
+void StretcherEngine::trackTempoDetected(double trackBPM)
+{
+    int tracksWithAudio = 0;
+    AudioTrack* loadedTrack = nullptr;
+
+    for (auto& track : audioTracks)
+    {
+        if (track->isLoaded())
+        {
+            tracksWithAudio++;
+            loadedTrack = track.get();
+        }
+    }
+
+    if (tracksWithAudio == 1 && trackBPM > 0.0 && loadedTrack)
+    {
+        setInitialMasterBPM(trackBPM, loadedTrack);
+    }
+}
+
+void StretcherEngine::alignTrackToMix(int trackIndex)
+{
+    TraceRecorder::Scope trace("alignTrackToMix", "analysis");
+
+    AudioTrack* track = getTrack(trackIndex);
+
+    if (!track)
+        return;
+
+    const std::vector<float> envelope = track->getOnsetEnvelope();
+
+    if (!track->isLoaded() || track->isLoadingFile() || envelope.empty())
+        return;
+
+    // Envelopes are one value per 512-sample hop of each track's own source audio
+    const double hopSize = 512.0;
+    const double framesPerSecond = track->getSampleRate() / hopSize;
+    const double rangeStart = track->hasLoopRegion() ? track->getLoopStart() : 0.0;
+    const double rangeEnd = track->hasLoopRegion() ? track->getLoopEnd() : track->getDurationInSeconds();
+    const int startFrame = (int)(rangeStart * framesPerSecond);
+    const int period = juce::jmin((int)((rangeEnd - rangeStart) * framesPerSecond), (int)envelope.size() - startFrame);
+    const double stretch = juce::jmax(0.01, track->getStretchRatio());
+
+    if (period < 16)
+        return;
+
+    std::vector<float> loop(envelope.begin() + startFrame, envelope.begin() + startFrame + period);
+
+    // The rest of the mix as it sounds against the new track's source frames, folded onto
+    // its loop period. A few periods are folded when the loop is short so the reference
+    // covers at least 30 seconds of playback.
+    const double periodTransportSeconds = period / (framesPerSecond * stretch);
+    const int numPeriods = juce::jlimit(1, 64, (int)std::ceil(30.0 / periodTransportSeconds));
+    std::vector<float> reference((size_t)period, 0.0f);
+    int numReferenceTracks = 0;
+
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        AudioTrack* other = audioTracks[(size_t)i].get();
+
+        if (i == trackIndex || !other->isLoaded() || other->isLoadingFile() || other->isMuted())
+            continue;
+
+        const std::vector<float> otherEnvelope = other->getOnsetEnvelope();
+        if (otherEnvelope.size() < 16)
+            continue;
+
+        // Normalise each track so a loud one does not drown out the others
+        double mean = 0.0;
+        double squares = 0.0;
+        for (float value : otherEnvelope)
+        {
+            mean += value;
+            squares += (double)value * value;
+        }
+        mean /= (double)otherEnvelope.size();
+        const double deviation = std::sqrt(juce::jmax(1.0e-12, squares / (double)otherEnvelope.size() - mean * mean));
+        const double otherFramesPerSecond = other->getSampleRate() / hopSize;
+
+        for (int frame = 0; frame < period * numPeriods; ++frame)
+        {
+            const double transportTime = frame / (framesPerSecond * stretch);
+            const int otherFrame = (int)(other->transportToSourcePosition(transportTime) * otherFramesPerSecond);
+
+            if (otherFrame >= 0 && otherFrame < (int)otherEnvelope.size())
+                reference[(size_t)(frame % period)] += (float)((otherEnvelope[(size_t)otherFrame] - mean) / deviation);
+        }
+
+        ++numReferenceTracks;
+    }
+
+    if (numReferenceTracks == 0)
+        return;
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    LoopAlignment alignment = TempoAnalysis::findLoopAlignment(reference, loop);
+    const double elapsedMs = juce::Time::getMillisecondCounterHiRes() - startTime;
+
+    if (alignment.strength < minimumAlignmentStrength)
+    {
+        juce::Logger::writeToLog("Track " + juce::String(trackIndex + 1) + " left unaligned: no clear match with the mix (" +
+                                 juce::String(alignment.strength, 2) + ")");
+        return;
+    }
+
+    const double offset = alignment.lagFrames / framesPerSecond;
+
+    {
+        juce::ScopedLock sl(lock);
+
+        track->setStartOffset(offset);
+
+        if (playing)
+        {
+            track->setTransportPosition(currentPlayPosition);
+        }
+    }
+
+    juce::Logger::writeToLog("Track " + juce::String(trackIndex + 1) + " aligned to the mix: offset " +
+                            juce::String(offset, 3) + "s (match " + juce::String(alignment.strength, 2) +
+                            ", " + juce::String(elapsedMs, 1) + " ms)");
+}
+
+// ============================================================================
+// Offline rendering
+// ============================================================================
+
+void StretcherEngine::beginOfflineRender(int maxBlockSize, int numChannels)
+{
+    juce::ScopedLock sl(lock);
+
+    renderingOffline = true;
+
+    for (auto& trackBuffer : trackBuffers)
+    {
+        trackBuffer.setSize(numChannels, maxBlockSize);
+    }
+
+    trackBufferMemory.set(trackBuffers.size() * MemoryAccounting::bytesOf(trackBuffers[0]));
+
+    currentPlayPosition = 0.0;
+    displayPlayPosition = 0.0;
+    metronomePhase = 0.0;
+    lastBeatTime = 0.0;
+
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        AudioTrack& track = *audioTracks[(size_t)i];
+        track.prepareToPlay(maxBlockSize);
+        track.reset();
+        track.setTransportPosition(0.0);
+
+        // Pool threads would otherwise time stages outside any profiled block
+        track.setProfiler(nullptr, i);
+    }
+
+    playing = true;
+}
+
+void StretcherEngine::renderBlock(juce::AudioBuffer<float>& buffer, int numSamples, juce::ThreadPool* pool)
+{
+    TraceRecorder::Scope trace("renderBlock", "render");
+    juce::ScopedLock sl(lock);
+    mixBlock(buffer, 0, numSamples, pool);
+}
+
+void StretcherEngine::endOfflineRender()
+{
+    juce::ScopedLock sl(lock);
+
+    playing = false;
+    currentPlayPosition = 0.0;
+    displayPlayPosition = 0.0;
+
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        audioTracks[(size_t)i]->reset();
+        audioTracks[(size_t)i]->setProfiler(&profiler, i);
+    }
+
+    for (auto& trackBuffer : trackBuffers)
+    {
+        trackBuffer.setSize(0, 0);
+    }
+
+    trackBufferMemory.set(0);
+
+    renderingOffline = false;
+}
+
+void StretcherEngine::renderTracksConcurrently(juce::AudioBuffer<float>& buffer, int numSamples, juce::ThreadPool& pool, bool hasSolo)
+{
+    std::array<bool, maxTracks> active {};
+    int numActive = 0;
+
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        AudioTrack& track = *audioTracks[(size_t)i];
+        active[(size_t)i] = track.isLoaded() && !track.isMuted() && (!hasSolo || track.isSolo())
+                            && trackBuffers[(size_t)i].getNumSamples() >= numSamples;
+
+        if (active[(size_t)i])
+            ++numActive;
+    }
+
+    if (numActive == 0)
+        return;
+
+    pendingTrackJobs = numActive;
+
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        if (!active[(size_t)i])
+            continue;
+
+        pool.addJob([this, i, numSamples]
+        {
+            TraceRecorder::Scope trace("renderTrack", "render");
+            juce::AudioBuffer<float>& trackBuffer = trackBuffers[(size_t)i];
+            trackBuffer.clear(0, numSamples);
+            audioTracks[(size_t)i]->processBlock(trackBuffer, 0, numSamples);
+
+            if (--pendingTrackJobs == 0)
+                trackJobsFinished.signal();
+        });
+    }
+
+    trackJobsFinished.wait();
+
+    // Summed in track order, so the mix is identical to rendering the tracks one by one
+    for (int i = 0; i < maxTracks; ++i)
+    {
+        if (!active[(size_t)i])
+            continue;
+
+        for (int ch = 0; ch < juce::jmin(buffer.getNumChannels(), trackBuffers[(size_t)i].getNumChannels()); ++ch)
+        {
+            buffer.addFrom(ch, 0, trackBuffers[(size_t)i], ch, 0, numSamples);
+        }
+    }
+}
+
+// ============================================================================
+// Metronome
+// ============================================================================
+
+void StretcherEngine::setMetronomeEnabled(bool shouldBeEnabled)
+{
+    juce::ScopedLock sl(lock);
+
+    metronomeEnabled = shouldBeEnabled;
+    metronomePhase = 0.0;
+    lastBeatTime = 0.0;
+}
+
+void StretcherEngine::processMetronome(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (!metronomeEnabled || !playing)
+        return;
+
+    metronomeBeatInterval = 60.0 / masterTempo;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        double currentTime = currentPlayPosition + (sample / sampleRate);
+
+        double timeSinceLastBeat = currentTime - lastBeatTime;
+        if (timeSinceLastBeat >= metronomeBeatInterval)
+        {
+            lastBeatTime = currentTime;
+            metronomePhase = 0.0;
+        }
+
+        float clickSample = generateClickSound(metronomePhase);
+
+        if (buffer.getNumChannels() >= 1)
+            buffer.addSample(0, startSample + sample, clickSample * metronomeVolume);
+        if (buffer.getNumChannels() >= 2)
+            buffer.addSample(1, startSample + sample, clickSample * metronomeVolume);
+
+        metronomePhase += 1.0 / sampleRate;
+    }
+}
+
+float StretcherEngine::generateClickSound(double phase) const
+{
+    const double clickDuration = 0.01;
+
+    if (phase > clickDuration)
+        return 0.0f;
+
+    const double frequency = 2000.0;
+    double envelope = 1.0 - (phase / clickDuration);
+    envelope = envelope * envelope;
+
+    double sineWave = std::sin(2.0 * juce::MathConstants<double>::pi * frequency * phase);
+
+    return static_cast<float>(sineWave * envelope * 0.3);
+}
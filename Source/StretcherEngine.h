@@ -0,0 +1,122 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioTrack.h"
+#include "AudioProfiler.h"
+#include "LevelMeter.h"
+#include "MemoryAccounting.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+// The playback side of STRETCHER without any GUI: a fixed set of tracks, the master
+// tempo they are stretched to, the transport, the metronome and the master bus. The
+// app drives it from its audio callback; tools drive it with plain buffers, so it can
+// be rendered, profiled and regression-tested with no audio device or window.
+//
+// processBlock() runs on the audio thread. Everything else may be called from any
+// other thread; calls that change playback take the same lock as processBlock().
+class StretcherEngine
+{
+public:
+    // Fixed, since the profiler's report is a flat snapshot with a slot per track. Far
+    // more rows than fit on screen, which the track list only builds as they scroll in.
+    static constexpr int maxTracks = 32;
+
+    StretcherEngine();
+    ~StretcherEngine();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    double getSampleRate() const { return sampleRate; }
+
+    // Adds every unmuted (or soloed) track and the metronome into the buffer, which is
+    // cleared first, and advances the transport by numSamples
+    void processBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    AudioTrack* getTrack(int trackIndex) const;
+
+    // Transport
+    void setPlaying(bool shouldPlay);
+    bool isPlaying() const { return playing.load(); }
+    void stop();                                        // Stops and rewinds
+    void setPlayPosition(double positionInSeconds);     // Moves the transport and every track
+    double getPlayPosition() const { return displayPlayPosition.load(); }
+    void setTrackPosition(int trackIndex, double positionInSeconds);
+
+    // Master tempo. setTempo restretches every loaded track by the change; the initial
+    // tempo is taken from one track, which then plays unstretched.
+    void setTempo(double bpm);
+    void setInitialMasterBPM(double bpm, AudioTrack* definingTrack);
+    double getMasterTempo() const { return masterTempo; }
+    double findAverageBPM() const;
+
+    void setMetronomeEnabled(bool shouldBeEnabled);
+    bool isMetronomeEnabled() const { return metronomeEnabled.load(); }
+
+    // Loading. trackFileLoaded() is called once a load finishes: the first loaded track
+    // sets the master tempo and later ones are lined up with the mix.
+    void loadTrack(int trackIndex, const juce::File& file, std::function<void()> onLoaded);
+    void trackFileLoaded(int trackIndex);
+    void trackTempoDetected(double trackBPM);
+
+    // Shifts a track's start so its onsets line up with the rest of the mix. A match
+    // weaker than minimumAlignmentStrength leaves the start where it was.
+    void alignTrackToMix(int trackIndex);
+
+    static constexpr double minimumAlignmentStrength = 0.1;
+
+    // Offline rendering. Between begin and end the audio callback outputs silence and the
+    // transport only moves through renderBlock(), which renders the tracks on the pool's
+    // threads when one is given. begin rewinds and starts the transport; end stops it.
+    void beginOfflineRender(int maxBlockSize, int numChannels);
+    void renderBlock(juce::AudioBuffer<float>& buffer, int numSamples, juce::ThreadPool* pool);
+    void endOfflineRender();
+    bool isRenderingOffline() const { return renderingOffline.load(); }
+
+    // Master bus levels, measured at the end of every block
+    LevelMeter& getMasterMeter() { return masterMeter; }
+
+    // Timing of every processBlock(), per track and per stage. Offline renders are not
+    // profiled: they have no deadline to miss.
+    AudioProfiler& getProfiler() { return profiler; }
+
+private:
+    static_assert(maxTracks == AudioProfiler::maxTracks, "The profiler keeps a slot per track");
+
+    std::array<std::unique_ptr<AudioTrack>, maxTracks> audioTracks;
+    LevelMeter masterMeter;
+    AudioProfiler profiler;
+
+    double sampleRate;
+    double masterTempo;
+    double previousMasterTempo;
+    double currentPlayPosition;                 // Audio thread, or under the lock
+    std::atomic<bool> playing;
+    std::atomic<bool> metronomeEnabled;
+    std::atomic<bool> renderingOffline;
+
+    // One buffer per track for offline rendering, so tracks can render concurrently.
+    // The pool's jobs count down and signal the render thread when the last one is done.
+    std::array<juce::AudioBuffer<float>, maxTracks> trackBuffers;
+    std::atomic<int> pendingTrackJobs;
+    juce::WaitableEvent trackJobsFinished;
+    MemoryAccounting::Allocation trackBufferMemory;
+
+    // Metronome state
+    double metronomePhase;
+    double metronomeBeatInterval;
+    double lastBeatTime;
+    float metronomeVolume;
+
+    // Play position for readers on other threads, written at the end of every block
+    std::atomic<double> displayPlayPosition;
+
+    juce::CriticalSection lock;
+
+    void mixBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, juce::ThreadPool* pool);
+    void renderTracksConcurrently(juce::AudioBuffer<float>& buffer, int numSamples, juce::ThreadPool& pool, bool hasSolo);
+    void processMetronome(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    float generateClickSound(double phase) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StretcherEngine)
+};
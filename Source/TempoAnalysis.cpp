@@ -0,0 +1,785 @@
+#include "TempoAnalysis.h"
+#include <algorithm>
+#include <cmath>
+
+// ============================================================================
+// Offline detectors
+// ============================================================================
+
+std::vector<double> TempoAnalysis::pickOnsetTimes(const std::vector<float>& onsetStrength, double sampleRate)
+{
+    std::vector<double> onsetTimes;
+
+    if (onsetStrength.size() < 10)
+        return onsetTimes;
+
+    // Find peaks in onset strength
+    const double hopSize = 512.0;
+    const double threshold = 0.3;
+
+    float maxOnset = *std::max_element(onsetStrength.begin(), onsetStrength.end());
+    float adaptiveThreshold = maxOnset * threshold;
+
+    for (int i = 1; i < (int)onsetStrength.size() - 1; ++i)
+    {
+        if (onsetStrength[i] > adaptiveThreshold &&
+            onsetStrength[i] > onsetStrength[i-1] &&
+            onsetStrength[i] > onsetStrength[i+1])
+        {
+            double onsetTime = (i * hopSize) / sampleRate;
+            onsetTimes.push_back(onsetTime);
+        }
+    }
+
+    return onsetTimes;
+}
+
+double TempoAnalysis::detectBPMFromOnsets(const std::vector<float>& onsetStrength, double sampleRate)
+{
+    std::vector<TempoCandidate> candidates = rankTempoCandidates(pickOnsetTimes(onsetStrength, sampleRate), 1);
+
+    if (candidates.empty())
+        return 120.0;
+
+    // Octave correction for musical tempos
+    return foldTempo(candidates.front().bpm, 70.0, 180.0);
+}
+
+double TempoAnalysis::detectBPMAutocorrelation(const juce::AudioBuffer<float>& audioBuffer, double sampleRate)
+{
+    const int numSamples = audioBuffer.getNumSamples();
+    if (numSamples < (int)sampleRate) return 120.0;
+
+    // Use mono sum for analysis
+    std::vector<float> monoSignal(numSamples);
+    const int numChannels = audioBuffer.getNumChannels();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float sum = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            sum += audioBuffer.getSample(ch, i);
+        }
+        monoSignal[i] = sum / numChannels;
+    }
+
+    // Calculate onset strength function
+    const int hopSize = 512;
+    const int frameSize = 1024;
+    std::vector<float> onsetStrength;
+
+    for (int pos = 0; pos < numSamples - frameSize; pos += hopSize)
+    {
+        float energy = 0.0f;
+        float prevEnergy = 0.0f;
+
+        // Current frame energy
+        for (int i = 0; i < frameSize; ++i)
+        {
+            if (pos + i < numSamples)
+                energy += monoSignal[pos + i] * monoSignal[pos + i];
+        }
+
+        // Previous frame energy
+        for (int i = 0; i < frameSize; ++i)
+        {
+            if (pos - hopSize + i >= 0 && pos - hopSize + i < numSamples)
+                prevEnergy += monoSignal[pos - hopSize + i] * monoSignal[pos - hopSize + i];
+        }
+
+        float strength = juce::jmax(0.0f, energy - prevEnergy);
+        onsetStrength.push_back(strength);
+    }
+
+    if (onsetStrength.size() < 10) return 120.0;
+
+    // Autocorrelation on onset strength
+    const int minLag = (int)(60.0 * sampleRate / (200.0 * hopSize)); // 200 BPM max
+    const int maxLag = (int)(60.0 * sampleRate / (60.0 * hopSize));   // 60 BPM min
+
+    double bestCorr = 0.0;
+    int bestLag = minLag;
+
+    for (int lag = minLag; lag < maxLag && lag < (int)onsetStrength.size() / 2; ++lag)
+    {
+        double correlation = 0.0;
+        int count = 0;
+
+        for (int i = 0; i < (int)onsetStrength.size() - lag; ++i)
+        {
+            correlation += onsetStrength[i] * onsetStrength[i + lag];
+            count++;
+        }
+
+        if (count > 0)
+        {
+            correlation /= count;
+
+            if (correlation > bestCorr)
+            {
+                bestCorr = correlation;
+                bestLag = lag;
+            }
+        }
+    }
+
+    // Convert lag to BPM
+    double beatInterval = (bestLag * hopSize) / sampleRate;
+    double bpm = 60.0 / beatInterval;
+
+    // Octave correction for musical tempos
+    return foldTempo(bpm, 70.0, 180.0);
+}
+
+double TempoAnalysis::detectBPMImproved(double durationInSeconds)
+{
+    if (durationInSeconds <= 0.0)
+        return 120.0;
+
+    // For common musical loop patterns (4, 8, 16, 32 beats)
+    std::vector<double> possibleBPMs;
+
+    for (int beats : {4, 8, 16, 32})
+    {
+        double bpm = (beats * 60.0) / durationInSeconds;
+        if (bpm >= 60.0 && bpm <= 200.0)
+        {
+            possibleBPMs.push_back(bpm);
+        }
+    }
+
+    if (!possibleBPMs.empty())
+    {
+        for (double bpm : possibleBPMs)
+        {
+            if (bpm >= 65.0 && bpm <= 150.0)
+            {
+                return bpm;
+            }
+        }
+        return possibleBPMs[0];
+    }
+
+    return 120.0;
+}
+
+// ============================================================================
+// Beat tracking
+// ============================================================================
+
+std::vector<double> TempoAnalysis::trackBeats(const std::vector<float>& onsetStrength,
+                                              double framesPerSecond,
+                                              double nominalBPM)
+{
+    std::vector<double> beatTimes;
+
+    const int numFrames = (int)onsetStrength.size();
+
+    if (numFrames < 16 || framesPerSecond <= 0.0 || nominalBPM <= 0.0)
+        return beatTimes;
+
+    const double period = framesPerSecond * 60.0 / nominalBPM; // Beat period in frames
+
+    if (period < 2.0 || period * 4.0 > numFrames)
+        return beatTimes;
+
+    // Normalise the envelope so the tempo penalty weighs the same for quiet and loud files
+    double mean = 0.0;
+    for (float value : onsetStrength)
+        mean += value;
+    mean /= numFrames;
+
+    double variance = 0.0;
+    for (float value : onsetStrength)
+        variance += (value - mean) * (value - mean);
+
+    const double deviation = std::sqrt(variance / numFrames);
+
+    if (deviation <= 0.0)
+        return beatTimes;
+
+    std::vector<double> normalised(numFrames);
+    for (int i = 0; i < numFrames; ++i)
+        normalised[i] = onsetStrength[i] / deviation;
+
+    // Cumulative score: each frame takes its onset strength plus the best predecessor,
+    // penalised by how far the gap strays from the nominal beat period (log-scale)
+    const double tightness = 100.0;
+    const int minGap = juce::jmax(1, (int)std::round(period * 0.5));
+    const int maxGap = (int)std::round(period * 2.0);
+
+    std::vector<double> score(numFrames);
+    std::vector<int> backlink(numFrames, -1);
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        double bestPrevious = 0.0;
+        int bestIndex = -1;
+
+        for (int prev = i - maxGap; prev <= i - minGap; ++prev)
+        {
+            if (prev < 0)
+                continue;
+
+            double deviationFromPeriod = std::log((i - prev) / period);
+            double candidate = score[prev] - tightness * deviationFromPeriod * deviationFromPeriod;
+
+            if (bestIndex < 0 || candidate > bestPrevious)
+            {
+                bestPrevious = candidate;
+                bestIndex = prev;
+            }
+        }
+
+        score[i] = normalised[i] + (bestIndex >= 0 ? juce::jmax(0.0, bestPrevious) : 0.0);
+        backlink[i] = bestIndex;
+    }
+
+    // Start from the strongest frame within the final beat period and walk back
+    int lastBeat = numFrames - 1;
+    for (int i = juce::jmax(0, numFrames - (int)period); i < numFrames; ++i)
+    {
+        if (score[i] > score[lastBeat])
+            lastBeat = i;
+    }
+
+    std::vector<int> beatFrames;
+    for (int frame = lastBeat; frame >= 0; frame = backlink[frame])
+    {
+        beatFrames.push_back(frame);
+    }
+
+    beatTimes.reserve(beatFrames.size());
+    for (auto it = beatFrames.rbegin(); it != beatFrames.rend(); ++it)
+    {
+        beatTimes.push_back(*it / framesPerSecond);
+    }
+
+    return beatTimes;
+}
+
+// ============================================================================
+// Tempo candidates
+// ============================================================================
+
+double TempoAnalysis::foldTempo(double bpm, double minBPM, double maxBPM)
+{
+    // The range has to span an octave for every tempo to have a place in it
+    if (bpm <= 0.0 || minBPM <= 0.0 || maxBPM < minBPM * 2.0)
+        return bpm;
+
+    if (bpm < minBPM)
+        return bpm * std::exp2(std::ceil(std::log2(minBPM / bpm)));
+
+    if (bpm >= maxBPM)
+        return bpm / std::exp2(std::floor(std::log2(bpm / maxBPM)) + 1.0);
+
+    return bpm;
+}
+
+double TempoAnalysis::findOctaveRatio(double bpm, double referenceBPM)
+{
+    if (bpm <= 0.0 || referenceBPM <= 0.0)
+        return 0.0;
+
+    const double ratio = bpm / referenceBPM;
+    const double tolerance = 0.03;
+
+    for (double simpleRatio : { 1.0, 2.0, 0.5, 1.5, 2.0 / 3.0, 4.0 / 3.0, 0.75, 3.0, 1.0 / 3.0 })
+    {
+        if (std::abs(ratio / simpleRatio - 1.0) <= tolerance)
+            return simpleRatio;
+    }
+
+    return 0.0;
+}
+
+std::vector<TempoCandidate> TempoAnalysis::rankTempoCandidates(const std::vector<double>& onsetTimes,
+                                                               int maxCandidates)
+{
+    std::vector<TempoCandidate> candidates;
+
+    if (onsetTimes.size() < 4 || maxCandidates <= 0)
+        return candidates;
+
+    // Tempogram over 60-200 BPM in half-BPM bins, filled straight from inter-onset intervals
+    // of 0.1-2.0 s. Pairs up to a few onsets apart are counted too, so beats still show up
+    // when subdivisions sit between them; out-of-range tempi fold in by octaves.
+    const double minInterval = 0.1;
+    const double maxInterval = 2.0;
+    const double minBPM = 60.0;
+    const double maxBPM = 200.0;
+    const double bpmResolution = 0.5;
+    const int numTempoBins = (int)((maxBPM - minBPM) / bpmResolution);
+    const size_t pairSpan = 4;
+
+    std::vector<double> tempogram(numTempoBins, 0.0);
+    double totalWeight = 0.0;
+
+    for (size_t i = 0; i < onsetTimes.size(); ++i)
+    {
+        for (size_t j = i + 1; j < onsetTimes.size() && j <= i + pairSpan; ++j)
+        {
+            double interval = onsetTimes[j] - onsetTimes[i];
+
+            if (interval >= maxInterval)
+                break;
+
+            if (interval <= minInterval)
+                continue;
+
+            // Nearer pairs are more likely to be consecutive beats
+            double weight = 1.0 / (double)(j - i);
+            double bpm = foldTempo(60.0 / interval, minBPM, maxBPM);
+
+            // Split the weight across the two nearest tempo bins
+            double position = (bpm - minBPM) / bpmResolution - 0.5;
+            int lower = juce::jlimit(0, numTempoBins - 1, (int)std::floor(position));
+            int upper = juce::jmin(numTempoBins - 1, lower + 1);
+            double fraction = juce::jlimit(0.0, 1.0, position - lower);
+
+            tempogram[lower] += weight * (1.0 - fraction);
+            tempogram[upper] += weight * fraction;
+            totalWeight += weight;
+        }
+    }
+
+    if (totalWeight <= 0.0)
+        return candidates;
+
+    // Window sums of +/-2% around each tempo stand in for the old pairwise tolerance scan
+    std::vector<double> prefix(numTempoBins + 1, 0.0);
+    for (int bin = 0; bin < numTempoBins; ++bin)
+        prefix[bin + 1] = prefix[bin] + tempogram[bin];
+
+    const double relativeTolerance = 0.02;
+    std::vector<double> smoothed(numTempoBins);
+    std::vector<int> halfWindows(numTempoBins);
+
+    for (int bin = 0; bin < numTempoBins; ++bin)
+    {
+        double bpm = minBPM + (bin + 0.5) * bpmResolution;
+        halfWindows[bin] = juce::jmax(1, (int)std::round(bpm * relativeTolerance / bpmResolution));
+
+        int first = juce::jmax(0, bin - halfWindows[bin]);
+        int last = juce::jmin(numTempoBins - 1, bin + halfWindows[bin]);
+        smoothed[bin] = prefix[last + 1] - prefix[first];
+    }
+
+    // A candidate is the strongest bin within its own tolerance window, refined with the
+    // weighted mean of the raw tempogram under that window
+    for (int bin = 0; bin < numTempoBins; ++bin)
+    {
+        if (smoothed[bin] <= 0.0)
+            continue;
+
+        int first = juce::jmax(0, bin - halfWindows[bin]);
+        int last = juce::jmin(numTempoBins - 1, bin + halfWindows[bin]);
+        bool isPeak = true;
+
+        for (int other = first; other <= last && isPeak; ++other)
+        {
+            if (smoothed[other] > smoothed[bin] || (other < bin && smoothed[other] == smoothed[bin]))
+                isPeak = false;
+        }
+
+        if (!isPeak)
+            continue;
+
+        double weightedSum = 0.0;
+        for (int other = first; other <= last; ++other)
+            weightedSum += tempogram[other] * (minBPM + (other + 0.5) * bpmResolution);
+
+        TempoCandidate candidate;
+        candidate.bpm = weightedSum / smoothed[bin];
+        candidate.confidence = juce::jmin(1.0, smoothed[bin] / totalWeight);
+        candidate.octaveRatio = 0.0;
+        candidates.push_back(candidate);
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const TempoCandidate& a, const TempoCandidate& b) { return a.confidence > b.confidence; });
+
+    // Flat-topped peaks can leave neighbours that are really the same tempo
+    std::vector<TempoCandidate> ranked;
+
+    for (const auto& candidate : candidates)
+    {
+        bool isDuplicate = false;
+
+        for (const auto& kept : ranked)
+        {
+            if (std::abs(candidate.bpm / kept.bpm - 1.0) <= 2.0 * relativeTolerance)
+                isDuplicate = true;
+        }
+
+        if (!isDuplicate)
+            ranked.push_back(candidate);
+
+        if ((int)ranked.size() >= maxCandidates)
+            break;
+    }
+
+    candidates = std::move(ranked);
+
+    for (auto& candidate : candidates)
+    {
+        candidate.octaveRatio = findOctaveRatio(candidate.bpm, candidates.front().bpm);
+    }
+
+    return candidates;
+}
+
+// ============================================================================
+// Loop alignment
+// ============================================================================
+
+LoopAlignment TempoAnalysis::findLoopAlignment(const std::vector<float>& reference, const std::vector<float>& loop)
+{
+    LoopAlignment result { 0, 0.0 };
+
+    const int period = (int)juce::jmin(reference.size(), loop.size());
+
+    if (period < 4)
+        return result;
+
+    // The loop is laid out twice so every lag up to one period is a plain linear product
+    const int fftSize = juce::nextPowerOfTwo(2 * period);
+    juce::dsp::FFT fft((int)std::round(std::log2((double)fftSize)));
+
+    std::vector<float> referenceData(2 * (size_t)fftSize, 0.0f);
+    std::vector<float> loopData(2 * (size_t)fftSize, 0.0f);
+
+    // Zero-mean copies so the correlation follows the rhythm rather than the level
+    double referenceMean = 0.0;
+    double loopMean = 0.0;
+    for (int i = 0; i < period; ++i)
+    {
+        referenceMean += reference[(size_t)i];
+        loopMean += loop[(size_t)i];
+    }
+    referenceMean /= period;
+    loopMean /= period;
+
+    double referenceEnergy = 0.0;
+    double loopEnergy = 0.0;
+    for (int i = 0; i < period; ++i)
+    {
+        referenceData[(size_t)i] = (float)(reference[(size_t)i] - referenceMean);
+        loopData[(size_t)i] = (float)(loop[(size_t)i] - loopMean);
+        loopData[(size_t)(i + period)] = loopData[(size_t)i];
+
+        referenceEnergy += referenceData[(size_t)i] * referenceData[(size_t)i];
+        loopEnergy += loopData[(size_t)i] * loopData[(size_t)i];
+    }
+
+    if (referenceEnergy <= 0.0 || loopEnergy <= 0.0)
+        return result;
+
+    // Kept for the time-domain check of the peak, as the transforms overwrite the data
+    const std::vector<float> centredReference(referenceData.begin(), referenceData.begin() + period);
+    const std::vector<float> centredLoop(loopData.begin(), loopData.begin() + 2 * period);
+
+    fft.performRealOnlyForwardTransform(referenceData.data());
+    fft.performRealOnlyForwardTransform(loopData.data());
+
+    // conj(reference) * loop, on interleaved complex bins
+    for (int bin = 0; bin < fftSize; ++bin)
+    {
+        const float refReal = referenceData[(size_t)(2 * bin)];
+        const float refImag = referenceData[(size_t)(2 * bin + 1)];
+        const float loopReal = loopData[(size_t)(2 * bin)];
+        const float loopImag = loopData[(size_t)(2 * bin + 1)];
+
+        loopData[(size_t)(2 * bin)] = refReal * loopReal + refImag * loopImag;
+        loopData[(size_t)(2 * bin + 1)] = refReal * loopImag - refImag * loopReal;
+    }
+
+    fft.performRealOnlyInverseTransform(loopData.data());
+
+    float bestCorrelation = loopData[0];
+    for (int lag = 1; lag < period; ++lag)
+    {
+        if (loopData[(size_t)lag] > bestCorrelation)
+        {
+            bestCorrelation = loopData[(size_t)lag];
+            result.lagFrames = lag;
+        }
+    }
+
+    // The FFT only picks the lag: its inverse carries a size-dependent scale, so the
+    // strength is the product at that lag over the energies of both periods, which
+    // reads the same whatever the FFT size
+    double product = 0.0;
+    for (int i = 0; i < period; ++i)
+        product += (double)centredReference[(size_t)i] * centredLoop[(size_t)(i + result.lagFrames)];
+
+    result.strength = juce::jlimit(-1.0, 1.0, product / std::sqrt(referenceEnergy * loopEnergy));
+    return result;
+}
+
+// ============================================================================
+// TempoMap Implementation
+// ============================================================================
+
+TempoMap::TempoMap()
+    : nominalBPM(0.0)
+{
+}
+
+void TempoMap::clear()
+{
+    beats.clear();
+    curveTimes.clear();
+    curveRates.clear();
+    nominalBPM = 0.0;
+}
+
+void TempoMap::build(const std::vector<double>& beatTimes, double bpm)
+{
+    clear();
+
+    const int minimumBeats = 8;
+
+    if ((int)beatTimes.size() < minimumBeats || bpm <= 0.0)
+        return;
+
+    beats = beatTimes;
+    nominalBPM = bpm;
+
+    const double nominalInterval = 60.0 / bpm;
+    const int numIntervals = (int)beats.size() - 1;
+
+    // Beat intervals, with doubled/missed beats clamped back towards the nominal period
+    std::vector<double> intervals(numIntervals);
+    for (int i = 0; i < numIntervals; ++i)
+    {
+        intervals[i] = juce::jlimit(nominalInterval * 0.5, nominalInterval * 2.0, beats[i + 1] - beats[i]);
+    }
+
+    // Smooth over a bar either side so single-beat jitter doesn't modulate the stretch
+    const int halfWindow = 4;
+    curveTimes.reserve(numIntervals);
+    curveRates.reserve(numIntervals);
+
+    for (int i = 0; i < numIntervals; ++i)
+    {
+        int first = juce::jmax(0, i - halfWindow);
+        int last = juce::jmin(numIntervals - 1, i + halfWindow);
+
+        double sum = 0.0;
+        for (int j = first; j <= last; ++j)
+            sum += intervals[j];
+
+        double smoothedInterval = sum / (last - first + 1);
+
+        curveTimes.push_back(0.5 * (beats[i] + beats[i + 1]));
+        curveRates.push_back(nominalInterval / smoothedInterval);
+    }
+}
+
+double TempoMap::getRateAt(double timeInSeconds) const
+{
+    if (curveTimes.empty())
+        return 1.0;
+
+    if (timeInSeconds <= curveTimes.front())
+        return curveRates.front();
+
+    if (timeInSeconds >= curveTimes.back())
+        return curveRates.back();
+
+    auto upper = std::upper_bound(curveTimes.begin(), curveTimes.end(), timeInSeconds);
+    size_t index = (size_t)(upper - curveTimes.begin());
+
+    double t0 = curveTimes[index - 1];
+    double t1 = curveTimes[index];
+    double alpha = (timeInSeconds - t0) / (t1 - t0);
+
+    return curveRates[index - 1] + alpha * (curveRates[index] - curveRates[index - 1]);
+}
+
+double TempoMap::getWarpedRatioAt(double timeInSeconds, double stretchRatio) const
+{
+    const double rate = getRateAt(timeInSeconds);
+    return rate > 0.0 ? stretchRatio / rate : stretchRatio;
+}
+
+// ============================================================================
+// StreamingTempoEstimator Implementation
+// ============================================================================
+
+StreamingTempoEstimator::StreamingTempoEstimator()
+    : sampleRate(44100.0),
+      minLag(1),
+      maxLag(1),
+      frameWritePos(0),
+      samplesSinceHop(0),
+      totalSamples(0),
+      previousEnergy(0.0f),
+      envelopeSum(0.0),
+      framesSinceUpdate(0),
+      publishedBPM(0.0),
+      publishedConfidence(0.0),
+      analysedSeconds(0.0)
+{
+}
+
+void StreamingTempoEstimator::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+
+    const double framesPerSecond = sampleRate / hopSize;
+    minLag = juce::jmax(1, (int)std::floor(60.0 * framesPerSecond / 200.0)); // 200 BPM max
+    maxLag = (int)std::ceil(60.0 * framesPerSecond / 60.0);                  // 60 BPM min
+
+    reset();
+}
+
+void StreamingTempoEstimator::reset()
+{
+    frameSamples.assign(frameSize, 0.0f);
+    frameWritePos = 0;
+    samplesSinceHop = 0;
+    totalSamples = 0;
+    previousEnergy = 0.0f;
+
+    envelope.clear();
+    lagSums.assign(2 * maxLag + 1, 0.0); // Twice the slowest beat, for the octave check
+    envelopeSum = 0.0;
+    framesSinceUpdate = 0;
+
+    publishedBPM = 0.0;
+    publishedConfidence = 0.0;
+    analysedSeconds = 0.0;
+}
+
+bool StreamingTempoEstimator::process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = buffer.getNumChannels();
+
+    if (numChannels <= 0 || numSamples <= 0)
+        return false;
+
+    const double bpmBefore = publishedBPM.load();
+    const double confidenceBefore = publishedConfidence.load();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float sum = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            sum += buffer.getSample(ch, startSample + i);
+        }
+
+        frameSamples[frameWritePos] = sum / numChannels;
+        frameWritePos = (frameWritePos + 1) % frameSize;
+        ++totalSamples;
+
+        if (++samplesSinceHop >= hopSize && totalSamples >= frameSize)
+        {
+            samplesSinceHop = 0;
+
+            // Same energy-flux onset function as the offline autocorrelation detector
+            float energy = 0.0f;
+            for (float sample : frameSamples)
+                energy += sample * sample;
+
+            addFrame(juce::jmax(0.0f, energy - previousEnergy));
+            previousEnergy = energy;
+        }
+    }
+
+    analysedSeconds = totalSamples / sampleRate;
+
+    return publishedBPM.load() != bpmBefore || publishedConfidence.load() != confidenceBefore;
+}
+
+void StreamingTempoEstimator::addFrame(float onsetStrength)
+{
+    envelope.push_back(onsetStrength);
+    envelopeSum += onsetStrength;
+
+    const int n = (int)envelope.size() - 1;
+    const int maxLagToAccumulate = juce::jmin(n, (int)lagSums.size() - 1);
+
+    for (int lag = 1; lag <= maxLagToAccumulate; ++lag)
+    {
+        lagSums[lag] += (double)onsetStrength * envelope[n - lag];
+    }
+
+    // Publish a first estimate after a few seconds, then refine about once a second
+    const double framesPerSecond = sampleRate / hopSize;
+    const int minimumFrames = (int)(4.0 * framesPerSecond);
+    const int updateInterval = (int)framesPerSecond;
+
+    if ((int)envelope.size() >= minimumFrames && ++framesSinceUpdate >= updateInterval)
+    {
+        framesSinceUpdate = 0;
+        updateEstimate();
+    }
+}
+
+void StreamingTempoEstimator::updateEstimate()
+{
+    const int numFrames = (int)envelope.size();
+    const double mean = envelopeSum / numFrames;
+    const int lastLag = juce::jmin(maxLag, (int)lagSums.size() / 2 - 1);
+
+    if (lastLag <= minLag || numFrames <= 2 * lastLag)
+        return;
+
+    auto autocovariance = [&](int lag)
+    {
+        return lagSums[lag] / (numFrames - lag) - mean * mean;
+    };
+
+    // Reward lags whose double also lines up, which favours the beat over its subdivisions
+    std::vector<double> scores(lastLag + 2, 0.0);
+    for (int lag = minLag - 1; lag <= lastLag + 1; ++lag)
+    {
+        if (lag >= 1 && 2 * lag < (int)lagSums.size())
+            scores[lag] = autocovariance(lag) + 0.5 * autocovariance(2 * lag);
+    }
+
+    int bestLag = minLag;
+    double scoreSum = 0.0;
+
+    for (int lag = minLag; lag <= lastLag; ++lag)
+    {
+        scoreSum += scores[lag];
+
+        if (scores[lag] > scores[bestLag])
+            bestLag = lag;
+    }
+
+    const double bestScore = scores[bestLag];
+    const double meanScore = scoreSum / (lastLag - minLag + 1);
+
+    if (bestScore <= 0.0)
+        return;
+
+    // Parabolic interpolation for a sub-frame lag
+    double refinedLag = bestLag;
+    const double y0 = scores[bestLag - 1];
+    const double y1 = scores[bestLag];
+    const double y2 = scores[bestLag + 1];
+    const double denominator = y0 - 2.0 * y1 + y2;
+
+    if (denominator < 0.0)
+        refinedLag += juce::jlimit(-0.5, 0.5, 0.5 * (y0 - y2) / denominator);
+
+    const double framesPerSecond = sampleRate / hopSize;
+    double bpm = 60.0 * framesPerSecond / refinedLag;
+
+    // Octave correction for musical tempos
+    bpm = TempoAnalysis::foldTempo(bpm, 70.0, 180.0);
+
+    // Peak prominence, discounted until enough audio has been heard to trust it
+    const double prominence = juce::jlimit(0.0, 1.0, (bestScore - meanScore) / bestScore);
+    const double coverage = juce::jmin(1.0, (numFrames / framesPerSecond) / 30.0);
+
+    publishedBPM = bpm;
+    publishedConfidence = prominence * (0.5 + 0.5 * coverage);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <atomic>
+
+// One tempo hypothesis from the inter-onset histogram
+struct TempoCandidate
+{
+    double bpm;
+    double confidence;   // Share of the tempogram weight behind this peak (0..1)
+    double octaveRatio;  // Relation to the top candidate (1, 2, 0.5, 1.5, ...), 0 if unrelated
+};
+
+// Where one loop of an envelope lines up best with a reference folded onto the same period
+struct LoopAlignment
+{
+    int lagFrames;
+    double strength;     // Normalised correlation at that lag (-1..1)
+};
+
+namespace TempoAnalysis
+{
+    // Ranks tempi in 60-200 BPM from onset times using a binned inter-onset histogram,
+    // in time linear in the number of onsets. Sorted by confidence, at most maxCandidates.
+    std::vector<TempoCandidate> rankTempoCandidates(const std::vector<double>& onsetTimes,
+                                                    int maxCandidates);
+
+    // Moves a tempo by whole octaves into [minBPM, maxBPM)
+    double foldTempo(double bpm, double minBPM, double maxBPM);
+
+    // Returns the simple ratio (2, 1/2, 3/2, ...) relating two tempi, or 0 if none fits
+    double findOctaveRatio(double bpm, double referenceBPM);
+
+    // Offline detectors over a whole decoded file, shared by AudioTrack and the tools.
+    // The onset envelope is Spectrogram::getOnsetStrength(), with a 512-sample hop.
+    std::vector<double> pickOnsetTimes(const std::vector<float>& onsetStrength, double sampleRate);
+    double detectBPMFromOnsets(const std::vector<float>& onsetStrength, double sampleRate);
+    double detectBPMAutocorrelation(const juce::AudioBuffer<float>& buffer, double sampleRate);
+    double detectBPMImproved(double durationInSeconds);
+
+    // Circular cross-correlation of one loop period of an onset envelope against a reference
+    // of the same length, done with a single FFT pair so long files still take milliseconds
+    LoopAlignment findLoopAlignment(const std::vector<float>& reference, const std::vector<float>& loop);
+
+    // Places beats on an onset-strength envelope with dynamic programming around a
+    // nominal tempo, so the beat times follow a performance that drifts.
+    std::vector<double> trackBeats(const std::vector<float>& onsetStrength,
+                                   double framesPerSecond,
+                                   double nominalBPM);
+}
+
+// Beat times across a file plus the smoothed playback-rate curve derived from them.
+// The curve is precomputed so the audio thread only does one lookup per block.
+class TempoMap
+{
+public:
+    TempoMap();
+
+    void build(const std::vector<double>& beatTimes, double nominalBPM);
+    void clear();
+
+    bool isEmpty() const { return curveTimes.empty(); }
+    const std::vector<double>& getBeatTimes() const { return beats; }
+    double getNominalBPM() const { return nominalBPM; }
+
+    // Local tempo divided by the nominal tempo at a source position (1.0 = on tempo)
+    double getRateAt(double timeInSeconds) const;
+    double getLocalBPMAt(double timeInSeconds) const { return nominalBPM * getRateAt(timeInSeconds); }
+
+    // SoundTouch tempo that keeps the output on the grid a stretch ratio asks for.
+    // Where the performance runs ahead (rate above 1) playback slows by that factor.
+    double getWarpedRatioAt(double timeInSeconds, double stretchRatio) const;
+
+private:
+    std::vector<double> beats;
+    std::vector<double> curveTimes;
+    std::vector<double> curveRates;
+    double nominalBPM;
+};
+
+// Tempo estimate that refines block by block while a file is decoding. The onset
+// envelope and its autocorrelation are accumulated incrementally, and the current
+// BPM and confidence are published through atomics for the UI to poll.
+class StreamingTempoEstimator
+{
+public:
+    StreamingTempoEstimator();
+
+    void prepare(double newSampleRate);
+    void reset();
+
+    // Feed decoded audio in order; returns true when a new estimate was published
+    bool process(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    double getBPM() const { return publishedBPM.load(); }
+    double getConfidence() const { return publishedConfidence.load(); }
+    double getAnalysedSeconds() const { return analysedSeconds.load(); }
+    bool hasEstimate() const { return getBPM() > 0.0; }
+
+    static constexpr int hopSize = 512;
+    static constexpr int frameSize = 1024;
+
+private:
+    double sampleRate;
+    int minLag;
+    int maxLag;
+
+    std::vector<float> frameSamples;   // Last frameSize mono samples, ring-indexed
+    int frameWritePos;
+    int samplesSinceHop;
+    long long totalSamples;
+    float previousEnergy;
+
+    std::vector<float> envelope;       // Onset strength, one value per hop
+    std::vector<double> lagSums;       // Running sum of envelope[n] * envelope[n - lag]
+    double envelopeSum;
+    int framesSinceUpdate;
+
+    std::atomic<double> publishedBPM;
+    std::atomic<double> publishedConfidence;
+    std::atomic<double> analysedSeconds;
+
+    void addFrame(float onsetStrength);
+    void updateEstimate();
+};
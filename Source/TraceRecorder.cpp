@@ -0,0 +1,224 @@
+#include "TraceRecorder.h"
+#include "MemoryAccounting.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+    };
+
+    // Written only by its own thread; the exporter reads it while the thread keeps going
+    struct ThreadBuffer
+    {
+        static constexpr juce::uint32 capacity = 8192;
+
+        ThreadBuffer(int id, const juce::String& threadName)
+            : threadId(id),
+              name(threadName),
+              events(new Event[capacity]),
+              numWritten(0),
+              retired(false),
+              memory(MemoryAccounting::traceBuffers)
+        {
+            memory.set(capacity * sizeof(Event));
+        }
+
+        void add(const Event& event) noexcept
+        {
+            const juce::uint32 index = numWritten.load(std::memory_order_relaxed);
+            events[index % capacity] = event;
+            numWritten.store(index + 1, std::memory_order_release);
+        }
+
+        const int threadId;
+        const juce::String name;
+        std::unique_ptr<Event[]> events;
+        std::atomic<juce::uint32> numWritten;
+        std::atomic<bool> retired;             // Its thread has exited
+        MemoryAccounting::Allocation memory;
+    };
+
+    struct Registry
+    {
+        juce::CriticalSection lock;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        int nextThreadId = 1;
+
+        const juce::int64 originTicks = juce::Time::getHighResolutionTicks();
+        std::atomic<juce::int64> clearedTicks { 0 };
+        std::atomic<bool> enabled { true };
+    };
+
+    // Threads can outlive static destruction, so the registry is never destroyed
+    Registry& getRegistry()
+    {
+        static Registry& registry = *new Registry();
+        return registry;
+    }
+
+    // Loader threads come and go with every file, so only the most recent exited
+    // threads keep their rings
+    constexpr int maxRetiredThreads = 16;
+
+    juce::String getCurrentThreadName()
+    {
+        if (juce::Thread* thread = juce::Thread::getCurrentThread())
+            return thread->getThreadName();
+
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            return "Message Thread";
+
+        return {};
+    }
+
+    ThreadBuffer* registerThread()
+    {
+        Registry& registry = getRegistry();
+        const juce::String threadName = getCurrentThreadName();
+
+        juce::ScopedLock sl(registry.lock);
+
+        int numRetired = 0;
+
+        for (const auto& buffer : registry.buffers)
+        {
+            if (buffer->retired)
+                ++numRetired;
+        }
+
+        for (auto it = registry.buffers.begin(); it != registry.buffers.end() && numRetired >= maxRetiredThreads;)
+        {
+            if ((*it)->retired)
+            {
+                it = registry.buffers.erase(it);
+                --numRetired;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        const int threadId = registry.nextThreadId++;
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>(threadId,
+                                                                  threadName.isNotEmpty() ? threadName : "Thread " + juce::String(threadId)));
+        return registry.buffers.back().get();
+    }
+
+    // Hands the ring back when the thread exits
+    struct ThreadHandle
+    {
+        ~ThreadHandle()
+        {
+            if (buffer != nullptr)
+                buffer->retired = true;
+        }
+
+        ThreadBuffer* buffer = nullptr;
+    };
+
+    thread_local ThreadHandle threadHandle;
+
+    juce::String ticksToMicroseconds(juce::int64 ticks)
+    {
+        return juce::String(juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6, 3);
+    }
+}
+
+TraceRecorder::Scope::Scope(const char* eventName, const char* eventCategory) noexcept
+    : name(eventName),
+      category(eventCategory),
+      startTicks(getRegistry().enabled ? juce::Time::getHighResolutionTicks() : 0)
+{
+}
+
+TraceRecorder::Scope::~Scope() noexcept
+{
+    if (startTicks == 0)
+        return;
+
+    if (threadHandle.buffer == nullptr)
+        threadHandle.buffer = registerThread();
+
+    threadHandle.buffer->add({ name, category, startTicks, juce::Time::getHighResolutionTicks() });
+}
+
+void TraceRecorder::setEnabled(bool shouldRecord) noexcept
+{
+    getRegistry().enabled = shouldRecord;
+}
+
+bool TraceRecorder::isEnabled() noexcept
+{
+    return getRegistry().enabled;
+}
+
+void TraceRecorder::clear() noexcept
+{
+    // The rings belong to their threads, so clearing just hides what came before
+    getRegistry().clearedTicks = juce::Time::getHighResolutionTicks();
+}
+
+juce::String TraceRecorder::toJSON()
+{
+    Registry& registry = getRegistry();
+    const juce::int64 clearedTicks = registry.clearedTicks;
+
+    juce::String json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+         << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"STRETCHER\"}}";
+
+    juce::ScopedLock sl(registry.lock);
+
+    for (const auto& buffer : registry.buffers)
+    {
+        // Copy the newest events, then drop any the thread overwrote while we copied
+        const juce::uint32 end = buffer->numWritten.load(std::memory_order_acquire);
+        juce::uint32 begin = end > ThreadBuffer::capacity ? end - ThreadBuffer::capacity : 0;
+        std::vector<Event> events;
+        events.reserve(end - begin);
+
+        for (juce::uint32 index = begin; index != end; ++index)
+            events.push_back(buffer->events[index % ThreadBuffer::capacity]);
+
+        // The writer may already be filling slot `written`, which it shares with
+        // written - capacity, so that one is gone too
+        const juce::uint32 written = buffer->numWritten.load(std::memory_order_acquire);
+        const juce::uint32 firstIntact = written + 1 > ThreadBuffer::capacity ? written + 1 - ThreadBuffer::capacity : 0;
+        const size_t numOverwritten = firstIntact > begin ? juce::jmin((size_t)(firstIntact - begin), events.size()) : 0;
+
+        json << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->threadId
+             << ",\"args\":{\"name\":\"" << juce::JSON::escapeString(buffer->name) << "\"}}";
+
+        for (size_t i = numOverwritten; i < events.size(); ++i)
+        {
+            const Event& event = events[i];
+
+            if (event.startTicks < clearedTicks)
+                continue;
+
+            json << ",\n{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                 << "\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << ticksToMicroseconds(event.startTicks - registry.originTicks)
+                 << ",\"dur\":" << ticksToMicroseconds(event.endTicks - event.startTicks) << "}";
+        }
+    }
+
+    json << "\n]}\n";
+    return json;
+}
+
+juce::Result TraceRecorder::exportJSON(const juce::File& file)
+{
+    if (!file.replaceWithText(toJSON()))
+        return juce::Result::fail("Could not write " + file.getFullPathName());
+
+    return juce::Result::ok();
+}
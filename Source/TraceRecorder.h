@@ -0,0 +1,40 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// A timeline of where time goes outside the audio callback: file loads, analysis,
+// offline renders and the UI work they trigger. Code marks a span with a Scope. Each
+// thread records into its own fixed-size ring, so recording neither locks nor
+// allocates after a thread's first event, and a full ring drops its oldest events.
+// exportJSON() writes the Chrome trace format, which chrome://tracing and
+// ui.perfetto.dev open as they are.
+//
+// Keep it off the audio thread: a thread's first event allocates its ring.
+namespace TraceRecorder
+{
+    // Records the span from construction to destruction. Name and category must be
+    // string literals, since only the pointers are kept.
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name, const char* category = "stretcher") noexcept;
+        ~Scope() noexcept;
+
+    private:
+        const char* name;
+        const char* category;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    // Recording is on from the start, so a slow load can be exported after the fact
+    void setEnabled(bool shouldRecord) noexcept;
+    bool isEnabled() noexcept;
+
+    // Forgets everything recorded so far
+    void clear() noexcept;
+
+    juce::String toJSON();
+    juce::Result exportJSON(const juce::File& file);
+}
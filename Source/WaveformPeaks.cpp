@@ -0,0 +1,223 @@
+#include "WaveformPeaks.h"
+#include <cmath>
+
+WaveformPeaks::WaveformPeaks()
+    : memory(MemoryAccounting::waveformPeaks)
+{
+}
+
+void WaveformPeaks::clear()
+{
+    samples.clear();
+    levels.clear();
+    countMemory();
+}
+
+void WaveformPeaks::build(const juce::AudioBuffer<float>& buffer)
+{
+    clear();
+
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = buffer.getNumChannels();
+
+    if (numSamples == 0 || numChannels == 0)
+        return;
+
+    // Mono mix
+    samples.resize((size_t)numSamples);
+    juce::FloatVectorOperations::copy(samples.data(), buffer.getReadPointer(0), numSamples);
+
+    for (int channel = 1; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::add(samples.data(), buffer.getReadPointer(channel), numSamples);
+
+    if (numChannels > 1)
+        juce::FloatVectorOperations::multiply(samples.data(), 1.0f / (float)numChannels, numSamples);
+
+    buildFinestLevel();
+
+    while (levels.back().minimum.size() > 1)
+        buildCoarserLevel(levels.back());
+
+    countMemory();
+}
+
+void WaveformPeaks::countMemory()
+{
+    size_t bytes = MemoryAccounting::bytesOf(samples) + MemoryAccounting::bytesOf(levels);
+
+    for (const Level& level : levels)
+        bytes += MemoryAccounting::bytesOf(level.minimum) + MemoryAccounting::bytesOf(level.maximum)
+                 + MemoryAccounting::bytesOf(level.meanSquare);
+
+    memory.set(bytes);
+}
+
+void WaveformPeaks::buildFinestLevel()
+{
+    using Vector = juce::dsp::SIMDRegister<float>;
+    constexpr int lanes = (int)Vector::SIMDNumElements;
+    static_assert(finestBinSize % lanes == 0, "Bins must hold whole SIMD registers");
+
+    const int numSamples = (int)samples.size();
+    const int numBins = (numSamples + finestBinSize - 1) / finestBinSize;
+    const int numFullBins = numSamples / finestBinSize;
+    const float* data = samples.data();
+
+    Level level;
+    level.samplesPerBin = finestBinSize;
+    level.minimum.resize((size_t)numBins);
+    level.maximum.resize((size_t)numBins);
+    level.meanSquare.resize((size_t)numBins);
+
+    // Each bin is a whole number of registers, so aligned data stays aligned bin to bin
+    int bin = 0;
+
+    if (Vector::isSIMDAligned(data))
+    {
+        for (; bin < numFullBins; ++bin)
+        {
+            const float* binData = data + bin * finestBinSize;
+
+            Vector first = Vector::fromRawArray(binData);
+            Vector lowest = first;
+            Vector highest = first;
+            Vector squares = first * first;
+
+            for (int i = lanes; i < finestBinSize; i += lanes)
+            {
+                Vector values = Vector::fromRawArray(binData + i);
+                lowest = Vector::min(lowest, values);
+                highest = Vector::max(highest, values);
+                squares += values * values;
+            }
+
+            float minimum = lowest.get(0);
+            float maximum = highest.get(0);
+            for (size_t lane = 1; lane < (size_t)lanes; ++lane)
+            {
+                minimum = juce::jmin(minimum, lowest.get(lane));
+                maximum = juce::jmax(maximum, highest.get(lane));
+            }
+
+            level.minimum[(size_t)bin] = minimum;
+            level.maximum[(size_t)bin] = maximum;
+            level.meanSquare[(size_t)bin] = squares.sum() / (float)finestBinSize;
+        }
+    }
+
+    // Unaligned data and the partial last bin
+    for (; bin < numBins; ++bin)
+    {
+        const int start = bin * finestBinSize;
+        const int end = juce::jmin(start + finestBinSize, numSamples);
+
+        float minimum = data[start];
+        float maximum = data[start];
+        float squares = 0.0f;
+
+        for (int i = start; i < end; ++i)
+        {
+            minimum = juce::jmin(minimum, data[i]);
+            maximum = juce::jmax(maximum, data[i]);
+            squares += data[i] * data[i];
+        }
+
+        level.minimum[(size_t)bin] = minimum;
+        level.maximum[(size_t)bin] = maximum;
+        level.meanSquare[(size_t)bin] = squares / (float)(end - start);
+    }
+
+    levels.push_back(std::move(level));
+}
+
+void WaveformPeaks::buildCoarserLevel(const Level& source)
+{
+    const int numSourceBins = (int)source.minimum.size();
+    const int numBins = (numSourceBins + levelRatio - 1) / levelRatio;
+
+    Level level;
+    level.samplesPerBin = source.samplesPerBin * levelRatio;
+    level.minimum.resize((size_t)numBins);
+    level.maximum.resize((size_t)numBins);
+    level.meanSquare.resize((size_t)numBins);
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const int start = bin * levelRatio;
+        const int end = juce::jmin(start + levelRatio, numSourceBins);
+
+        float minimum = source.minimum[(size_t)start];
+        float maximum = source.maximum[(size_t)start];
+        float squares = 0.0f;
+
+        for (int i = start; i < end; ++i)
+        {
+            minimum = juce::jmin(minimum, source.minimum[(size_t)i]);
+            maximum = juce::jmax(maximum, source.maximum[(size_t)i]);
+            squares += source.meanSquare[(size_t)i];
+        }
+
+        level.minimum[(size_t)bin] = minimum;
+        level.maximum[(size_t)bin] = maximum;
+        level.meanSquare[(size_t)bin] = squares / (float)(end - start);
+    }
+
+    levels.push_back(std::move(level));
+}
+
+WaveformPeaks::Range WaveformPeaks::getRange(double startSample, double endSample) const
+{
+    Range range { 0.0f, 0.0f, 0.0f };
+
+    if (samples.empty())
+        return range;
+
+    const double numSamples = (double)samples.size();
+    startSample = juce::jlimit(0.0, numSamples - 1.0, startSample);
+    endSample = juce::jlimit(startSample, numSamples, endSample);
+
+    const double width = endSample - startSample;
+
+    if (width < finestBinSize)
+    {
+        // Narrower than a bin: read the samples themselves
+        const int first = (int)startSample;
+        const int last = juce::jmax(first + 1, juce::jmin((int)samples.size(), (int)std::ceil(endSample)));
+
+        range.minimum = range.maximum = samples[(size_t)first];
+        float squares = 0.0f;
+
+        for (int i = first; i < last; ++i)
+        {
+            range.minimum = juce::jmin(range.minimum, samples[(size_t)i]);
+            range.maximum = juce::jmax(range.maximum, samples[(size_t)i]);
+            squares += samples[(size_t)i] * samples[(size_t)i];
+        }
+
+        range.rms = std::sqrt(squares / (float)(last - first));
+        return range;
+    }
+
+    // Coarsest level whose bins are no wider than the range, so only a handful are read
+    int levelIndex = (int)(std::log2(width / finestBinSize) / std::log2((double)levelRatio));
+    levelIndex = juce::jlimit(0, (int)levels.size() - 1, levelIndex);
+
+    const Level& level = levels[(size_t)levelIndex];
+    const int numBins = (int)level.minimum.size();
+    const int first = juce::jlimit(0, numBins - 1, (int)(startSample / level.samplesPerBin));
+    const int last = juce::jlimit(first + 1, numBins, (int)std::ceil(endSample / level.samplesPerBin));
+
+    range.minimum = level.minimum[(size_t)first];
+    range.maximum = level.maximum[(size_t)first];
+    float squares = 0.0f;
+
+    for (int bin = first; bin < last; ++bin)
+    {
+        range.minimum = juce::jmin(range.minimum, level.minimum[(size_t)bin]);
+        range.maximum = juce::jmax(range.maximum, level.maximum[(size_t)bin]);
+        squares += level.meanSquare[(size_t)bin];
+    }
+
+    range.rms = std::sqrt(squares / (float)(last - first));
+    return range;
+}
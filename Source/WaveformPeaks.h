@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryAccounting.h"
+#include <vector>
+
+// Min/max/RMS summary of a file's mono mix at several resolutions, from raw samples up
+// to a few thousand samples per bin. Each level is four times coarser than the one
+// below, so any zoom can be drawn from a level whose bins are at most four per pixel.
+class WaveformPeaks
+{
+public:
+    struct Range
+    {
+        float minimum;
+        float maximum;
+        float rms;
+    };
+
+    static constexpr int finestBinSize = 16;
+    static constexpr int levelRatio = 4;
+
+    WaveformPeaks();
+
+    // Mixes the buffer down and builds every level. The finest level is built with SIMD.
+    void build(const juce::AudioBuffer<float>& buffer);
+    void clear();
+
+    bool isEmpty() const { return samples.empty(); }
+    int getNumSamples() const { return (int)samples.size(); }
+    const std::vector<float>& getSamples() const { return samples; }
+
+    // Summary of [startSample, endSample), read from the coarsest level that still
+    // resolves a range that wide, so the cost does not depend on the range length
+    Range getRange(double startSample, double endSample) const;
+
+private:
+    struct Level
+    {
+        int samplesPerBin;
+        std::vector<float> minimum;
+        std::vector<float> maximum;
+        std::vector<float> meanSquare;
+    };
+
+    std::vector<float> samples;   // Mono mix, the raw level
+    std::vector<Level> levels;    // finestBinSize samples per bin, then levelRatio times coarser each
+    MemoryAccounting::Allocation memory;
+
+    void buildFinestLevel();
+    void buildCoarserLevel(const Level& source);
+    void countMemory();
+};
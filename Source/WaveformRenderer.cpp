@@ -0,0 +1,170 @@
+#include "WaveformRenderer.h"
+#include <cmath>
+
+bool WaveformTile::hasSameResolutionAs(const WaveformTile& other) const
+{
+    return peaks == other.peaks
+        && sampleRate == other.sampleRate
+        && colour == other.colour
+        && height == other.height
+        && scale == other.scale
+        && pixelsPerSecond > 0.0
+        && std::abs(pixelsPerSecond / other.pixelsPerSecond - 1.0) < 1.0e-6;
+}
+
+bool WaveformTile::covers(const WaveformTile& other, double start, double end) const
+{
+    // Half a pixel of slack so rounding at the tile edges does not force a re-render
+    const double slack = 0.5 / pixelsPerSecond;
+    return hasSameResolutionAs(other) && startTime <= start + slack && endTime >= end - slack;
+}
+
+WaveformRenderer::WaveformRenderer()
+    : juce::Thread("Waveform Renderer")
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+WaveformRenderer::~WaveformRenderer()
+{
+    stopThread(4000);
+}
+
+void WaveformRenderer::requestTile(const void* client, const WaveformTile& tile,
+                                   std::function<void(const WaveformTile&)> onRendered)
+{
+    {
+        juce::ScopedLock sl(lock);
+        pendingRequests[client] = { tile, std::move(onRendered) };
+    }
+
+    notify();
+}
+
+void WaveformRenderer::cancelRequests(const void* client)
+{
+    juce::ScopedLock sl(lock);
+    pendingRequests.erase(client);
+}
+
+void WaveformRenderer::run()
+{
+    while (!threadShouldExit())
+    {
+        Request request;
+        bool hasRequest = false;
+
+        {
+            juce::ScopedLock sl(lock);
+
+            if (!pendingRequests.empty())
+            {
+                request = std::move(pendingRequests.begin()->second);
+                pendingRequests.erase(pendingRequests.begin());
+                hasRequest = true;
+            }
+        }
+
+        if (!hasRequest)
+        {
+            wait(-1);
+            continue;
+        }
+
+        renderTile(request.tile);
+
+        if (!threadShouldExit() && request.onRendered)
+        {
+            juce::MessageManager::callAsync([tile = std::move(request.tile), onRendered = std::move(request.onRendered)]
+            {
+                onRendered(tile);
+            });
+        }
+    }
+}
+
+void WaveformRenderer::renderTile(WaveformTile& tile)
+{
+    const int width = juce::roundToInt((tile.endTime - tile.startTime) * tile.pixelsPerSecond * tile.scale);
+    const int height = juce::roundToInt(tile.height * tile.scale);
+
+    if (width <= 0 || height <= 0 || tile.peaks == nullptr || tile.peaks->isEmpty())
+    {
+        tile.image = {};
+        return;
+    }
+
+    // Software images can be drawn into off the message thread
+    tile.image = juce::Image(juce::Image::ARGB, width, height, true, juce::SoftwareImageType());
+    juce::Graphics g(tile.image);
+
+    const WaveformPeaks& peaks = *tile.peaks;
+    const float centerY = height * 0.5f;
+    const float amplitudeScale = height * 0.4f;
+    const double firstSample = tile.startTime * tile.sampleRate;
+    const double samplesPerPixel = tile.sampleRate / (tile.pixelsPerSecond * tile.scale);
+
+    if (samplesPerPixel >= 1.0)
+    {
+        // One min/max column per pixel from the matching pyramid level, RMS on top
+        std::vector<WaveformPeaks::Range> columns((size_t)width);
+
+        for (int x = 0; x < width; ++x)
+        {
+            double columnStart = firstSample + x * samplesPerPixel;
+            columns[(size_t)x] = peaks.getRange(columnStart, columnStart + samplesPerPixel);
+        }
+
+        g.setColour(tile.colour);
+        for (int x = 0; x < width; ++x)
+        {
+            float top = centerY - columns[(size_t)x].maximum * amplitudeScale;
+            float bottom = centerY - columns[(size_t)x].minimum * amplitudeScale;
+            g.fillRect((float)x, top, 1.0f, juce::jmax(1.0f, bottom - top));
+        }
+
+        g.setColour(tile.colour.brighter(0.5f));
+        for (int x = 0; x < width; ++x)
+        {
+            float rmsHeight = columns[(size_t)x].rms * amplitudeScale;
+            g.fillRect((float)x, centerY - rmsHeight, 1.0f, rmsHeight * 2.0f);
+        }
+    }
+    else
+    {
+        // Fewer samples than pixels: join the samples themselves, and mark each one
+        // once they are far enough apart to click between
+        const std::vector<float>& samples = peaks.getSamples();
+        const int first = juce::jmax(0, (int)firstSample);
+        const int last = juce::jmin((int)samples.size() - 1, (int)std::ceil(firstSample + width * samplesPerPixel) + 1);
+        const double pixelsPerSample = 1.0 / samplesPerPixel;
+
+        juce::Path samplePath;
+
+        for (int i = first; i <= last; ++i)
+        {
+            float x = (float)((i - firstSample) * pixelsPerSample);
+            float y = centerY - samples[(size_t)i] * amplitudeScale;
+
+            if (i == first)
+                samplePath.startNewSubPath(x, y);
+            else
+                samplePath.lineTo(x, y);
+        }
+
+        g.setColour(tile.colour);
+        g.strokePath(samplePath, juce::PathStrokeType(1.5f * tile.scale));
+
+        if (pixelsPerSample >= 6.0 * tile.scale)
+        {
+            const float dotSize = 4.0f * tile.scale;
+
+            for (int i = first; i <= last; ++i)
+            {
+                float x = (float)((i - firstSample) * pixelsPerSample);
+                float y = centerY - samples[(size_t)i] * amplitudeScale;
+                g.fillEllipse(x - dotSize * 0.5f, y - dotSize * 0.5f, dotSize, dotSize);
+            }
+        }
+    }
+}
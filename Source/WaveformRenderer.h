@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "WaveformPeaks.h"
+#include <functional>
+#include <map>
+#include <memory>
+
+// A rendered stretch of waveform. The same struct describes a request (everything but
+// the image) and its result, so the UI can tell whether a tile still matches the view.
+struct WaveformTile
+{
+    juce::Image image;                            // Physical pixels, transparent background
+    std::shared_ptr<const WaveformPeaks> peaks;
+    double sampleRate = 44100.0;
+    juce::Colour colour;
+    double startTime = 0.0;
+    double endTime = 0.0;
+    double pixelsPerSecond = 0.0;                 // Logical pixels
+    int height = 0;                               // Logical pixels
+    float scale = 1.0f;                           // Physical pixels per logical pixel
+
+    bool isValid() const { return image.isValid(); }
+
+    // Same data, colour and resolution, so the image can be drawn unscaled
+    bool hasSameResolutionAs(const WaveformTile& other) const;
+
+    // Same resolution, and covers [start, end)
+    bool covers(const WaveformTile& other, double start, double end) const;
+};
+
+// Rasterizes waveform tiles on a background thread shared by every waveform view.
+// Each client has at most one pending request; a newer one replaces it, so fast
+// zooming only renders the tile the view settles on.
+class WaveformRenderer : public juce::Thread
+{
+public:
+    WaveformRenderer();
+    ~WaveformRenderer() override;
+
+    // The callback runs on the message thread once the tile is ready
+    void requestTile(const void* client, const WaveformTile& tile,
+                     std::function<void(const WaveformTile&)> onRendered);
+    void cancelRequests(const void* client);
+
+    // Draws the tile's min/max columns and RMS, or the raw samples when zoomed in
+    // past one sample per pixel. Safe to call on any thread.
+    static void renderTile(WaveformTile& tile);
+
+    void run() override;
+
+private:
+    struct Request
+    {
+        WaveformTile tile;
+        std::function<void(const WaveformTile&)> onRendered;
+    };
+
+    juce::CriticalSection lock;
+    std::map<const void*, Request> pendingRequests;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformRenderer)
+};
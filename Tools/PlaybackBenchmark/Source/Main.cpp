@@ -0,0 +1,304 @@
+#include <JuceHeader.h>
+#include "AudioTrack.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// Throughput benchmark for AudioTrack::processBlock(). Plays synthesized loops
+// through every combination of stretch ratio, block size, channel count and number
+// of simultaneous tracks, timing each block, and reports throughput and the block
+// time distribution. A ratio of 1 measures direct playback; any other ratio goes
+// through SoundTouch.
+//
+//   PlaybackBenchmark [--quick] [--seconds N] [--sample-rate N]
+//                     [--ratios 0.25,1,4] [--block-sizes 64,512] [--channels 1,2,6]
+//                     [--tracks 1,8,64] [--label text] [--csv results.csv]
+//
+// The CSV has one row per combination. --label goes in every row, so runs from
+// different commits can be concatenated and compared.
+// ============================================================================
+
+namespace
+{
+    struct Config
+    {
+        double ratio;
+        int blockSize;
+        int numChannels;
+        int numTracks;
+    };
+
+    struct Measurement
+    {
+        Config config;
+        int numBlocks = 0;
+        double totalSeconds = 0.0;
+        std::vector<double> blockSeconds;
+
+        bool isDirect() const { return std::abs(config.ratio - 1.0) < 0.02; }
+
+        // Frames of every track, per second of processing
+        double getFramesPerSecond() const
+        {
+            return (double)numBlocks * config.blockSize * config.numTracks / juce::jmax(1.0e-12, totalSeconds);
+        }
+    };
+
+    // Swallows the per-track log lines while tracks load
+    class QuietLogger : public juce::Logger
+    {
+    public:
+        void logMessage(const juce::String&) override {}
+    };
+
+    std::vector<double> parseList(const juce::ArgumentList& args, const juce::String& option, std::vector<double> defaults)
+    {
+        if (!args.containsOption(option))
+            return defaults;
+
+        std::vector<double> values;
+        juce::StringArray tokens;
+        tokens.addTokens(args.getValueForOption(option), ",", "");
+
+        for (const juce::String& token : tokens)
+        {
+            if (token.trim().isNotEmpty())
+                values.push_back(token.trim().getDoubleValue());
+        }
+
+        return values;
+    }
+
+    double percentile(std::vector<double> values, double fraction)
+    {
+        if (values.empty())
+            return 0.0;
+
+        size_t index = juce::jmin(values.size() - 1, (size_t)(fraction * (double)(values.size() - 1) + 0.5));
+        std::nth_element(values.begin(), values.begin() + (long)index, values.end());
+        return values[index];
+    }
+
+    // One bar at 120 BPM of decaying noise hits over a chord, each channel a little
+    // different, so SoundTouch has transients and steady tones to work through
+    juce::AudioBuffer<float> synthesizeLoop(int numChannels, double sampleRate)
+    {
+        const int numSamples = (int)(2.0 * sampleRate);
+        const int beatLength = (int)(sampleRate * 0.5);
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        juce::Random random(42);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* samples = buffer.getWritePointer(ch);
+            const double detune = 1.0 + ch * 0.003;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double time = i / sampleRate;
+                const double hit = std::exp(-(double)(i % beatLength) / (sampleRate * 0.03));
+                const double chord = std::sin(2.0 * juce::MathConstants<double>::pi * 220.0 * detune * time)
+                                   + std::sin(2.0 * juce::MathConstants<double>::pi * 277.2 * detune * time)
+                                   + std::sin(2.0 * juce::MathConstants<double>::pi * 329.6 * detune * time);
+
+                samples[i] = (float)(0.15 * chord + 0.5 * hit * (random.nextFloat() * 2.0f - 1.0f));
+            }
+        }
+
+        return buffer;
+    }
+
+    bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        file.deleteFile();
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)buffer.getNumChannels(), 24, {}, 0));
+
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); // The writer owns the stream now
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    Measurement run(const Config& config, std::vector<std::unique_ptr<AudioTrack>>& tracks, double sampleRate, double seconds)
+    {
+        Measurement measurement;
+        measurement.config = config;
+
+        for (int i = 0; i < config.numTracks; ++i)
+        {
+            AudioTrack& track = *tracks[(size_t)i];
+            track.setStretchRatio(config.ratio);
+            track.reset();
+
+            // Staggered, so the tracks don't all wrap their loops in the same block
+            track.setPosition(i * track.getDurationInSeconds() / config.numTracks);
+        }
+
+        juce::AudioBuffer<float> output(config.numChannels, config.blockSize);
+        const int numWarmUpBlocks = juce::jmax(4, (int)(0.25 * sampleRate / config.blockSize));
+        const int numBlocks = juce::jmax(16, (int)(seconds * sampleRate / config.blockSize));
+
+        measurement.blockSeconds.reserve((size_t)numBlocks);
+
+        for (int block = 0; block < numWarmUpBlocks + numBlocks; ++block)
+        {
+            const juce::int64 start = juce::Time::getHighResolutionTicks();
+
+            output.clear();
+
+            for (int i = 0; i < config.numTracks; ++i)
+                tracks[(size_t)i]->processBlock(output, 0, config.blockSize);
+
+            const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            if (block >= numWarmUpBlocks)
+            {
+                measurement.blockSeconds.push_back(elapsed);
+                measurement.totalSeconds += elapsed;
+                ++measurement.numBlocks;
+            }
+        }
+
+        return measurement;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    const bool quick = args.containsOption("--quick");
+    const double seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : (quick ? 0.5 : 2.0);
+    const double sampleRate = args.containsOption("--sample-rate") ? args.getValueForOption("--sample-rate").getDoubleValue() : 48000.0;
+    const juce::String label = args.containsOption("--label") ? args.getValueForOption("--label") : juce::String();
+
+    const std::vector<double> ratios = parseList(args, "--ratios", quick ? std::vector<double> { 0.5, 1.0, 2.0 }
+                                                                         : std::vector<double> { 0.25, 0.5, 0.8, 1.0, 1.25, 2.0, 4.0 });
+    const std::vector<double> blockSizes = parseList(args, "--block-sizes", quick ? std::vector<double> { 256 }
+                                                                                  : std::vector<double> { 64, 256, 1024, 4096 });
+    const std::vector<double> channelCounts = parseList(args, "--channels", quick ? std::vector<double> { 2 }
+                                                                                  : std::vector<double> { 1, 2, 6 });
+    const std::vector<double> trackCounts = parseList(args, "--tracks", quick ? std::vector<double> { 1, 8 }
+                                                                              : std::vector<double> { 1, 4, 16, 64 });
+
+    auto outOfRange = [](const std::vector<double>& values, double low, double high)
+    {
+        return values.empty() || std::any_of(values.begin(), values.end(), [=](double value) { return value < low || value > high; });
+    };
+
+    if (seconds <= 0.0 || sampleRate < 8000.0 || outOfRange(ratios, 0.25, 4.0) || outOfRange(blockSizes, 1, 16384)
+        || outOfRange(channelCounts, 1, 8) || outOfRange(trackCounts, 1, 64))
+    {
+        std::cerr << "Ratios must lie between 0.25 and 4, block sizes up to 16384, channels 1 to 8 and tracks 1 to 64\n";
+        return 1;
+    }
+
+    QuietLogger quietLogger;
+    const juce::File loopFile = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                    .getNonexistentChildFile("PlaybackBenchmark", ".wav");
+    const int maxTracks = (int)*std::max_element(trackCounts.begin(), trackCounts.end());
+
+    std::cout << "AudioTrack::processBlock at " << sampleRate << " Hz, " << seconds << " s of audio per run\n\n";
+    std::cout << "  ratio  block  ch  tracks    Mframes/s  ns/frame   median us     p99 us   p99.9 us     max us   load p99\n";
+
+    std::vector<Measurement> measurements;
+
+    for (double channels : channelCounts)
+    {
+        // The loop is loaded into as many tracks as the largest run needs, and they are
+        // dropped again before the next channel count, to keep memory down
+        const int numChannels = (int)channels;
+        std::vector<std::unique_ptr<AudioTrack>> tracks;
+
+        if (!writeWav(loopFile, synthesizeLoop(numChannels, sampleRate), sampleRate))
+        {
+            std::cerr << "Could not write " << loopFile.getFullPathName() << "\n";
+            return 1;
+        }
+
+        juce::Logger::setCurrentLogger(&quietLogger);
+
+        for (int i = 0; i < maxTracks; ++i)
+        {
+            tracks.push_back(std::make_unique<AudioTrack>());
+            tracks.back()->loadAudioFile(loopFile);
+            tracks.back()->setLooping(true);
+        }
+
+        juce::Logger::setCurrentLogger(nullptr);
+        loopFile.deleteFile();
+
+        for (double blockSize : blockSizes)
+        {
+            for (double ratio : ratios)
+            {
+                for (double numTracks : trackCounts)
+                {
+                    const Config config { ratio, (int)blockSize, numChannels, (int)numTracks };
+                    measurements.push_back(run(config, tracks, sampleRate, seconds));
+
+                    const Measurement& measurement = measurements.back();
+                    const double deadline = config.blockSize / sampleRate;
+                    const double median = percentile(measurement.blockSeconds, 0.5);
+
+                    std::cout << juce::String(config.ratio, 2).paddedLeft(' ', 7) << juce::String(config.blockSize).paddedLeft(' ', 7)
+                              << juce::String(config.numChannels).paddedLeft(' ', 4) << juce::String(config.numTracks).paddedLeft(' ', 8)
+                              << juce::String(measurement.getFramesPerSecond() * 1.0e-6, 2).paddedLeft(' ', 13)
+                              << juce::String(median * 1.0e9 / (config.blockSize * config.numTracks), 1).paddedLeft(' ', 10)
+                              << juce::String(median * 1.0e6, 1).paddedLeft(' ', 12)
+                              << juce::String(percentile(measurement.blockSeconds, 0.99) * 1.0e6, 1).paddedLeft(' ', 11)
+                              << juce::String(percentile(measurement.blockSeconds, 0.999) * 1.0e6, 1).paddedLeft(' ', 11)
+                              << juce::String(percentile(measurement.blockSeconds, 1.0) * 1.0e6, 1).paddedLeft(' ', 11)
+                              << (juce::String(percentile(measurement.blockSeconds, 0.99) / deadline * 100.0, 1) + "%").paddedLeft(' ', 11)
+                              << "\n";
+                }
+            }
+        }
+    }
+
+    if (args.containsOption("--csv"))
+    {
+        juce::File csvFile = args.getFileForOption("--csv");
+        juce::String csv = "label,mode,ratio,block_size,channels,tracks,sample_rate,blocks,frames_per_second,ns_per_frame_median,"
+                           "block_us_median,block_us_p90,block_us_p99,block_us_p999,block_us_max,load_median,load_p99\n";
+
+        for (const auto& measurement : measurements)
+        {
+            const Config& config = measurement.config;
+            const double deadline = config.blockSize / sampleRate;
+            const double median = percentile(measurement.blockSeconds, 0.5);
+
+            csv << label << "," << (measurement.isDirect() ? "direct" : "stretched") << "," << juce::String(config.ratio, 3) << ","
+                << config.blockSize << "," << config.numChannels << "," << config.numTracks << "," << juce::String(sampleRate, 0) << ","
+                << measurement.numBlocks << "," << juce::String(measurement.getFramesPerSecond(), 0) << ","
+                << juce::String(median * 1.0e9 / (config.blockSize * config.numTracks), 3) << ","
+                << juce::String(median * 1.0e6, 3) << ","
+                << juce::String(percentile(measurement.blockSeconds, 0.9) * 1.0e6, 3) << ","
+                << juce::String(percentile(measurement.blockSeconds, 0.99) * 1.0e6, 3) << ","
+                << juce::String(percentile(measurement.blockSeconds, 0.999) * 1.0e6, 3) << ","
+                << juce::String(percentile(measurement.blockSeconds, 1.0) * 1.0e6, 3) << ","
+                << juce::String(median / deadline, 5) << ","
+                << juce::String(percentile(measurement.blockSeconds, 0.99) / deadline, 5) << "\n";
+        }
+
+        if (!csvFile.replaceWithText(csv))
+        {
+            std::cerr << "Could not write " << csvFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include <JuceHeader.h>
+#include "StretcherEngine.h"
+#include "RealtimeSanitizer.h"
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// Real-time safety check for StretcherEngine::processBlock(). Built with
+// STRETCHER_REALTIME_SANITIZER=1, so every allocation, free, mutex lock and file call
+// is intercepted. A thread plays the engine in real time, block by block, while the
+// main thread works the controls the way a user would: transport, seeking, loop
+// regions, tempo changes and the mixer. Anything the audio thread does that could
+// block is reported per scenario, with a stack for each distinct call site.
+//
+//   RealtimeCheck [--seconds N] [--block-size N] [--sample-rate N] [--stack-lines N]
+//                 [--fail-on allocation,deallocation,lock,lock-wait,file-access,logging]
+//
+// Exits with 2 when any of the --fail-on kinds turned up. By default those are all
+// but the two lock kinds: the engine and its tracks share a lock with the controls
+// by design, so locks are reported as warnings.
+// ============================================================================
+
+namespace
+{
+    using RealtimeSanitizer::Kind;
+
+    const Kind allKinds[] = { Kind::allocation, Kind::deallocation, Kind::lock, Kind::lockWait, Kind::fileAccess, Kind::logging };
+
+    // Anything logged from the audio thread is a violation; the rest is dropped
+    class CheckingLogger : public juce::Logger
+    {
+    public:
+        void logMessage(const juce::String&) override
+        {
+            RealtimeSanitizer::notify(Kind::logging, "Logger::writeToLog");
+        }
+    };
+
+    // Stands in for the device: one block per block duration, until told to stop
+    class AudioThread : public juce::Thread
+    {
+    public:
+        AudioThread(StretcherEngine& engineToPlay, int numChannels, int blockSize, double sampleRate)
+            : juce::Thread("Audio"),
+              engine(engineToPlay),
+              buffer(numChannels, blockSize),
+              blockMilliseconds(blockSize * 1000.0 / sampleRate),
+              blocksProcessed(0)
+        {
+        }
+
+        void run() override
+        {
+            double nextBlockTime = juce::Time::getMillisecondCounterHiRes();
+
+            while (!threadShouldExit())
+            {
+                engine.processBlock(buffer, 0, buffer.getNumSamples());
+                ++blocksProcessed;
+
+                nextBlockTime += blockMilliseconds;
+                const double wait = nextBlockTime - juce::Time::getMillisecondCounterHiRes();
+
+                if (wait >= 1.0)
+                    juce::Thread::sleep((int)wait);
+            }
+        }
+
+        int getBlocksProcessed() const { return blocksProcessed.load(); }
+
+    private:
+        StretcherEngine& engine;
+        juce::AudioBuffer<float> buffer;
+        const double blockMilliseconds;
+        std::atomic<int> blocksProcessed;
+    };
+
+    struct Scenario
+    {
+        juce::String name;
+        std::function<void(StretcherEngine&, juce::Random&)> step;
+    };
+
+    juce::String getOptionName(Kind kind)
+    {
+        return RealtimeSanitizer::getKindName(kind).replaceCharacter(' ', '-');
+    }
+
+    // Two bars of clicks and a chord at the given tempo
+    juce::AudioBuffer<float> synthesizeLoop(double bpm, int numChannels, double sampleRate)
+    {
+        const int beatLength = (int)(sampleRate * 60.0 / bpm);
+        const int numSamples = beatLength * 8;
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* samples = buffer.getWritePointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double time = i / sampleRate;
+                const double click = std::exp(-(double)(i % beatLength) / (sampleRate * 0.01));
+                const double chord = std::sin(2.0 * juce::MathConstants<double>::pi * (220.0 + ch) * time)
+                                   + std::sin(2.0 * juce::MathConstants<double>::pi * (329.6 + ch) * time);
+
+                samples[i] = (float)(0.2 * chord + 0.6 * click * std::sin(2.0 * juce::MathConstants<double>::pi * 1000.0 * time));
+            }
+        }
+
+        return buffer;
+    }
+
+    bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        file.deleteFile();
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)buffer.getNumChannels(), 24, {}, 0));
+
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); // The writer owns the stream now
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    AudioTrack& pickLoadedTrack(StretcherEngine& engine, juce::Random& random, int numLoaded)
+    {
+        return *engine.getTrack(random.nextInt(numLoaded));
+    }
+
+    std::vector<Scenario> makeScenarios(int numLoaded)
+    {
+        std::vector<Scenario> scenarios;
+
+        scenarios.push_back({ "transport", [](StretcherEngine& engine, juce::Random& random)
+        {
+            if (random.nextInt(4) == 0)
+                engine.stop();
+            else
+                engine.setPlaying(!engine.isPlaying());
+        } });
+
+        scenarios.push_back({ "seek", [numLoaded](StretcherEngine& engine, juce::Random& random)
+        {
+            if (random.nextBool())
+            {
+                engine.setPlayPosition(random.nextDouble() * 8.0);
+            }
+            else
+            {
+                const int trackIndex = random.nextInt(numLoaded);
+                engine.setTrackPosition(trackIndex, random.nextDouble() * engine.getTrack(trackIndex)->getDurationInSeconds());
+            }
+        } });
+
+        scenarios.push_back({ "loop", [numLoaded](StretcherEngine& engine, juce::Random& random)
+        {
+            AudioTrack& track = pickLoadedTrack(engine, random, numLoaded);
+            const double duration = track.getDurationInSeconds();
+
+            switch (random.nextInt(3))
+            {
+                case 0:
+                {
+                    const double start = random.nextDouble() * duration * 0.8;
+                    track.setLoopRegion(start, start + juce::jmax(0.05, random.nextDouble() * (duration - start)));
+                    break;
+                }
+                case 1:     track.clearLoopRegion(); break;
+                default:    track.setLooping(!track.isLooping()); break;
+            }
+        } });
+
+        scenarios.push_back({ "tempo and mixer", [numLoaded](StretcherEngine& engine, juce::Random& random)
+        {
+            AudioTrack& track = pickLoadedTrack(engine, random, numLoaded);
+
+            switch (random.nextInt(6))
+            {
+                case 0:     engine.setTempo(60.0 + random.nextDouble() * 120.0); break;
+                case 1:     engine.setMetronomeEnabled(!engine.isMetronomeEnabled()); break;
+                case 2:     track.setStretchRatio(0.5 + random.nextDouble() * 1.5); break;
+                case 3:     track.setVolume(random.nextFloat()); break;
+                case 4:     track.setMuted(!track.isMuted()); break;
+                default:    track.setSolo(!track.isSolo()); break;
+            }
+        } });
+
+        return scenarios;
+    }
+
+    void printViolations(const std::vector<RealtimeSanitizer::Violation>& violations, const juce::Array<int>& failingKinds,
+                         int stackLines)
+    {
+        for (const auto& violation : violations)
+        {
+            const bool fails = failingKinds.contains((int)violation.kind);
+
+            std::cout << (fails ? "    FAIL " : "    warn ") << RealtimeSanitizer::getKindName(violation.kind) << " in "
+                      << violation.call << ", " << violation.count << (violation.count == 1 ? " time\n" : " times\n");
+
+            juce::StringArray lines = juce::StringArray::fromLines(violation.stackTrace.trim());
+
+            for (int i = 0; i < juce::jmin(stackLines, lines.size()); ++i)
+                std::cout << "        " << lines[i].trim() << "\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    const double seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 2.0;
+    const int blockSize = args.containsOption("--block-size") ? args.getValueForOption("--block-size").getIntValue() : 256;
+    const double sampleRate = args.containsOption("--sample-rate") ? args.getValueForOption("--sample-rate").getDoubleValue() : 48000.0;
+    const int stackLines = args.containsOption("--stack-lines") ? args.getValueForOption("--stack-lines").getIntValue() : 12;
+
+    if (!RealtimeSanitizer::isAvailable())
+    {
+        std::cerr << "Built without STRETCHER_REALTIME_SANITIZER=1, so nothing is intercepted\n";
+        return 1;
+    }
+
+    if (seconds <= 0.0 || blockSize < 16 || blockSize > 8192 || sampleRate < 8000.0)
+    {
+        std::cerr << "Block sizes must lie between 16 and 8192, and the sample rate be at least 8000\n";
+        return 1;
+    }
+
+    juce::Array<int> failingKinds;
+    juce::StringArray failOn;
+    failOn.addTokens(args.containsOption("--fail-on") ? args.getValueForOption("--fail-on")
+                                                      : juce::String("allocation,deallocation,file-access,logging"), ",", "");
+
+    for (const juce::String& token : failOn)
+    {
+        if (token.trim().isEmpty())
+            continue;
+
+        bool known = false;
+
+        for (Kind kind : allKinds)
+        {
+            if (getOptionName(kind) == token.trim())
+            {
+                failingKinds.addIfNotAlreadyThere((int)kind);
+                known = true;
+            }
+        }
+
+        if (!known)
+        {
+            std::cerr << "Unknown kind " << token.trim() << "\n";
+            return 1;
+        }
+    }
+
+    // Tracks at three tempos, so the master tempo stretches all but the first
+    StretcherEngine engine;
+    engine.prepareToPlay(blockSize, sampleRate);
+
+    CheckingLogger checkingLogger;
+    juce::Logger::setCurrentLogger(&checkingLogger);
+
+    const double loopTempos[] = { 120.0, 96.0, 135.0 };
+    const int numLoaded = (int)std::size(loopTempos);
+
+    for (int i = 0; i < numLoaded; ++i)
+    {
+        const juce::File loopFile = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                        .getNonexistentChildFile("RealtimeCheck", ".wav");
+
+        if (!writeWav(loopFile, synthesizeLoop(loopTempos[i], i == 1 ? 1 : 2, sampleRate), sampleRate))
+        {
+            std::cerr << "Could not write " << loopFile.getFullPathName() << "\n";
+            juce::Logger::setCurrentLogger(nullptr);
+            return 1;
+        }
+
+        engine.getTrack(i)->loadAudioFile(loopFile);
+        engine.trackFileLoaded(i);
+        loopFile.deleteFile();
+    }
+
+    std::cout << "StretcherEngine::processBlock, " << blockSize << " samples at " << sampleRate << " Hz, "
+              << seconds << " s per scenario\n";
+
+    AudioThread audioThread(engine, 2, blockSize, sampleRate);
+    audioThread.startThread(juce::Thread::Priority::highest);
+
+    juce::Random random(1234);
+    bool failed = false;
+
+    for (const Scenario& scenario : makeScenarios(numLoaded))
+    {
+        engine.setPlaying(true);
+        juce::Thread::sleep(50);
+        RealtimeSanitizer::clearViolations();
+
+        const int firstBlock = audioThread.getBlocksProcessed();
+        const double endTime = juce::Time::getMillisecondCounterHiRes() + seconds * 1000.0;
+
+        while (juce::Time::getMillisecondCounterHiRes() < endTime)
+        {
+            scenario.step(engine, random);
+            juce::Thread::sleep(5 + random.nextInt(20));
+        }
+
+        const std::vector<RealtimeSanitizer::Violation> violations = RealtimeSanitizer::getViolations();
+        int counts[std::size(allKinds)] = {};
+
+        for (const auto& violation : violations)
+            counts[(int)violation.kind] += violation.count;
+
+        std::cout << "\n" << scenario.name << ": " << (audioThread.getBlocksProcessed() - firstBlock) << " blocks";
+
+        for (Kind kind : allKinds)
+        {
+            std::cout << ", " << counts[(int)kind] << " " << RealtimeSanitizer::getKindName(kind);
+
+            if (counts[(int)kind] > 0 && failingKinds.contains((int)kind))
+                failed = true;
+        }
+
+        std::cout << "\n";
+        printViolations(violations, failingKinds, stackLines);
+    }
+
+    audioThread.stopThread(2000);
+    juce::Logger::setCurrentLogger(nullptr);
+
+    std::cout << "\n" << (failed ? "FAILED" : "OK") << "\n";
+    return failed ? 2 : 0;
+}
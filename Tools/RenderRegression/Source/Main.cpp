@@ -0,0 +1,526 @@
+#include <JuceHeader.h>
+#include "StretcherEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// ============================================================================
+// Render regression check for StretcherEngine. Each scenario loads synthesized
+// loops, renders a fixed length offline and compares the result with a golden file.
+// The scenarios cover loops wrapping in both the direct and the SoundTouch paths,
+// tempo changes landing mid-block, loop regions edited during playback, and mono
+// sources on a stereo bus. Every scenario is rendered several times: the runs must
+// match each other exactly, and the fastest must fit the scenario's time budget.
+//
+//   RenderRegression [--golden directory] [--update] [--only name]
+//                    [--tolerance 0.0001] [--runs 3] [--budget-scale 1.0]
+//                    [--output directory]
+//
+// Goldens are 32-bit float WAVs, recorded with --update and kept in
+// Tools/RenderRegression/Golden by default (run from the repository root).
+// --update also writes timings.json there with each scenario's fastest run and the
+// machine it ran on. A scenario's budget is that time plus budgetMargin, and it is
+// only checked on that same machine, or anywhere --budget-scale says how much slower
+// or faster this one is. --output keeps each failing render next to its golden name
+// for listening.
+//
+// A scenario with no golden or no timing yet is reported as unrecorded rather than
+// failed. Exits with 2 when any scenario fails, and with 3 when none fails but some
+// are unrecorded, so a check that compared nothing never passes silently.
+// ============================================================================
+
+namespace
+{
+    // Fixed, since SoundTouch is fed per block and a different size changes the output
+    constexpr int blockSize = 512;
+    constexpr double sampleRate = 44100.0;
+    constexpr int numOutputChannels = 2;
+
+    // Headroom over the recorded fastest run, for scheduling jitter between runs
+    constexpr double budgetMargin = 0.5;
+
+    struct Source
+    {
+        int numChannels;
+        double lengthInSeconds;
+        double beatSeconds;
+        int seed;
+    };
+
+    // A change applied when the render reaches atSample; the block is split there
+    struct Event
+    {
+        juce::int64 atSample;
+        std::function<void(StretcherEngine&)> apply;
+    };
+
+    struct Scenario
+    {
+        juce::String name;
+        std::vector<Source> sources;                        // Loaded into tracks 1, 2, ...
+        std::function<void(StretcherEngine&)> setUp;
+        std::vector<Event> events;
+        double lengthInSeconds;
+    };
+
+    struct Render
+    {
+        juce::AudioBuffer<float> output;
+        double seconds = 0.0;
+    };
+
+    // Swallows the per-track log lines while tracks load
+    class QuietLogger : public juce::Logger
+    {
+    public:
+        void logMessage(const juce::String&) override {}
+    };
+
+    // Decaying noise hits on the beat over two detuned partials. Seeded, so every run
+    // and every machine gets the same samples.
+    juce::AudioBuffer<float> synthesizeSource(const Source& source)
+    {
+        const int numSamples = (int)(source.lengthInSeconds * sampleRate);
+        const int beatLength = (int)(source.beatSeconds * sampleRate);
+        juce::AudioBuffer<float> buffer(source.numChannels, numSamples);
+        juce::Random random(source.seed);
+
+        for (int ch = 0; ch < source.numChannels; ++ch)
+        {
+            float* samples = buffer.getWritePointer(ch);
+            const double frequency = 180.0 + 40.0 * source.seed + 3.0 * ch;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double time = i / sampleRate;
+                const double hit = std::exp(-(double)(i % beatLength) / (sampleRate * 0.02));
+                const double tone = std::sin(2.0 * juce::MathConstants<double>::pi * frequency * time)
+                                  + 0.5 * std::sin(2.0 * juce::MathConstants<double>::pi * frequency * 1.5 * time);
+
+                samples[i] = (float)(0.2 * tone + 0.5 * hit * (random.nextFloat() * 2.0f - 1.0f));
+            }
+        }
+
+        return buffer;
+    }
+
+    bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, int bitsPerSample)
+    {
+        file.deleteFile();
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)buffer.getNumChannels(), bitsPerSample, {}, 0));
+
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); // The writer owns the stream now
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    bool readWav(const juce::File& file, juce::AudioBuffer<float>& buffer)
+    {
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatReader> reader(wavFormat.createReaderFor(file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+            return false;
+
+        buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+        return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+    }
+
+    // Budgets only mean something on the machine that recorded them
+    juce::String describeMachine()
+    {
+        return juce::SystemStats::getCpuModel() + ", " + juce::String(juce::SystemStats::getNumCpus()) + " cores, "
+               + juce::SystemStats::getOperatingSystemName();
+    }
+
+    // The recording machine and the fastest run per scenario name, in milliseconds
+    struct Timings
+    {
+        juce::String machine;
+        juce::var milliseconds { new juce::DynamicObject() };
+    };
+
+    Timings readTimings(const juce::File& file)
+    {
+        Timings timings;
+        const juce::var json = juce::JSON::parse(file.loadFileAsString());
+
+        if (json.isObject())
+        {
+            timings.machine = json.getProperty("machine", juce::String()).toString();
+
+            if (json.getProperty("milliseconds", {}).isObject())
+                timings.milliseconds = json.getProperty("milliseconds", {});
+        }
+
+        return timings;
+    }
+
+    bool writeTimings(const juce::File& file, const Timings& timings)
+    {
+        juce::var json(new juce::DynamicObject());
+        json.getDynamicObject()->setProperty("machine", timings.machine);
+        json.getDynamicObject()->setProperty("milliseconds", timings.milliseconds);
+        return file.replaceWithText(juce::JSON::toString(json));
+    }
+
+    std::vector<Scenario> makeScenarios()
+    {
+        std::vector<Scenario> scenarios;
+
+        // Loop lengths that are no multiple of the block size, direct and stretched
+        scenarios.push_back({ "loop-wraps",
+                              { { 2, 1.37, 0.34, 1 }, { 2, 0.91, 0.3, 2 }, { 2, 1.1, 0.275, 3 } },
+                              [](StretcherEngine& engine)
+                              {
+                                  engine.getTrack(0)->setStretchRatio(1.0);
+                                  engine.getTrack(1)->setStretchRatio(1.5);
+                                  engine.getTrack(2)->setStretchRatio(0.75);
+                              },
+                              {},
+                              6.0 });
+
+        // Tempo moves between blocks the host would otherwise deliver whole
+        scenarios.push_back({ "tempo-change-mid-block",
+                              { { 2, 2.0, 0.5, 4 }, { 1, 1.5, 0.375, 5 } },
+                              [](StretcherEngine& engine)
+                              {
+                                  engine.getTrack(0)->setStretchRatio(1.25);
+                                  engine.getTrack(1)->setStretchRatio(1.0);
+                              },
+                              { { 33333, [](StretcherEngine& engine) { engine.setTempo(132.0); } },
+                                { 70001, [](StretcherEngine& engine) { engine.setTempo(96.0); } },
+                                { 120007, [](StretcherEngine& engine) { engine.setTempo(120.0); } },
+                                { 150011, [](StretcherEngine& engine) { engine.setTempo(150.0); } } },
+                              5.0 });
+
+        // Regions set, moved and cleared while both tracks play
+        scenarios.push_back({ "loop-region-edits",
+                              { { 2, 3.0, 0.5, 6 }, { 2, 3.0, 0.4, 7 } },
+                              [](StretcherEngine& engine)
+                              {
+                                  engine.getTrack(0)->setLoopRegion(0.5, 1.25);
+                                  engine.getTrack(1)->setStretchRatio(1.3);
+                              },
+                              { { 40000, [](StretcherEngine& engine) { engine.getTrack(1)->setLoopRegion(0.2, 0.9); } },
+                                { 90001, [](StretcherEngine& engine) { engine.getTrack(0)->setLoopRegion(1.0, 2.2); } },
+                                { 130003, [](StretcherEngine& engine) { engine.getTrack(0)->clearLoopRegion(); } },
+                                { 170009, [](StretcherEngine& engine) { engine.getTrack(1)->setLoopRegion(2.5, 2.9); } } },
+                              5.0 });
+
+        // Mono sources are copied to both sides of the bus
+        scenarios.push_back({ "mono-to-stereo",
+                              { { 1, 1.2, 0.3, 8 }, { 1, 1.7, 0.425, 9 } },
+                              [](StretcherEngine& engine)
+                              {
+                                  engine.getTrack(1)->setStretchRatio(0.8);
+                                  engine.getTrack(1)->setVolume(0.7f);
+                              },
+                              {},
+                              4.0 });
+
+        return scenarios;
+    }
+
+    // A fresh engine per run, so nothing one render leaves behind can reach the next
+    Render render(const Scenario& scenario, const juce::Array<juce::File>& sourceFiles)
+    {
+        StretcherEngine engine;
+        engine.prepareToPlay(blockSize, sampleRate);
+
+        for (int i = 0; i < sourceFiles.size(); ++i)
+        {
+            AudioTrack& track = *engine.getTrack(i);
+            track.loadAudioFile(sourceFiles[i]);
+            track.setLooping(true);
+        }
+
+        if (scenario.setUp)
+            scenario.setUp(engine);
+
+        const juce::int64 totalSamples = (juce::int64)(scenario.lengthInSeconds * sampleRate);
+        Render result;
+        result.output.setSize(numOutputChannels, (int)totalSamples);
+
+        juce::AudioBuffer<float> block(numOutputChannels, blockSize);
+        juce::int64 position = 0;
+        size_t nextEvent = 0;
+
+        const juce::int64 start = juce::Time::getHighResolutionTicks();
+        engine.beginOfflineRender(blockSize, numOutputChannels);
+
+        while (position < totalSamples)
+        {
+            while (nextEvent < scenario.events.size() && scenario.events[nextEvent].atSample <= position)
+                scenario.events[nextEvent++].apply(engine);
+
+            juce::int64 numSamples = juce::jmin((juce::int64)blockSize, totalSamples - position);
+
+            if (nextEvent < scenario.events.size())
+                numSamples = juce::jmin(numSamples, scenario.events[nextEvent].atSample - position);
+
+            engine.renderBlock(block, (int)numSamples, nullptr);
+
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+                result.output.copyFrom(ch, (int)position, block, ch, 0, (int)numSamples);
+
+            position += numSamples;
+        }
+
+        engine.endOfflineRender();
+        result.seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        return result;
+    }
+
+    bool isIdentical(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+            return false;
+
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+        {
+            if (!std::equal(a.getReadPointer(ch), a.getReadPointer(ch) + a.getNumSamples(), b.getReadPointer(ch)))
+                return false;
+        }
+
+        return true;
+    }
+
+    struct Difference
+    {
+        float maxAbsolute = 0.0f;
+        int firstSampleOverTolerance = -1;
+        double relativeDecibels = -200.0;       // Difference energy against the golden's
+    };
+
+    Difference compare(const juce::AudioBuffer<float>& actual, const juce::AudioBuffer<float>& golden, float tolerance)
+    {
+        Difference difference;
+        double differenceEnergy = 0.0;
+        double goldenEnergy = 0.0;
+
+        for (int ch = 0; ch < golden.getNumChannels(); ++ch)
+        {
+            const float* a = actual.getReadPointer(ch);
+            const float* g = golden.getReadPointer(ch);
+
+            for (int i = 0; i < golden.getNumSamples(); ++i)
+            {
+                const float delta = std::abs(a[i] - g[i]);
+                difference.maxAbsolute = juce::jmax(difference.maxAbsolute, delta);
+                differenceEnergy += (double)delta * delta;
+                goldenEnergy += (double)g[i] * g[i];
+
+                if (delta > tolerance && (difference.firstSampleOverTolerance < 0 || i < difference.firstSampleOverTolerance))
+                    difference.firstSampleOverTolerance = i;
+            }
+        }
+
+        if (differenceEnergy > 0.0)
+            difference.relativeDecibels = 10.0 * std::log10(differenceEnergy / juce::jmax(1.0e-30, goldenEnergy));
+
+        return difference;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    const juce::File goldenDirectory = args.containsOption("--golden")
+                                           ? args.getFileForOption("--golden")
+                                           : juce::File::getCurrentWorkingDirectory().getChildFile("Tools/RenderRegression/Golden");
+    const juce::File outputDirectory = args.containsOption("--output") ? args.getFileForOption("--output") : juce::File();
+    const bool update = args.containsOption("--update");
+    const juce::String only = args.getValueForOption("--only");
+    const float tolerance = args.containsOption("--tolerance") ? args.getValueForOption("--tolerance").getFloatValue() : 1.0e-4f;
+    const int numRuns = args.containsOption("--runs") ? args.getValueForOption("--runs").getIntValue() : 3;
+    const double budgetScale = args.containsOption("--budget-scale") ? args.getValueForOption("--budget-scale").getDoubleValue() : 1.0;
+
+    if (tolerance < 0.0f || numRuns < 1 || budgetScale <= 0.0)
+    {
+        std::cerr << "The tolerance can't be negative, and runs and the budget scale must be positive\n";
+        return 1;
+    }
+
+    if (update && !goldenDirectory.isDirectory() && !goldenDirectory.createDirectory())
+    {
+        std::cerr << "Could not create " << goldenDirectory.getFullPathName() << "\n";
+        return 1;
+    }
+
+    if (outputDirectory != juce::File())
+        outputDirectory.createDirectory();
+
+    const juce::File timingsFile = goldenDirectory.getChildFile("timings.json");
+    Timings timings = readTimings(timingsFile);
+    const juce::String thisMachine = describeMachine();
+    const bool checkBudgets = update || timings.machine == thisMachine || args.containsOption("--budget-scale");
+
+    if (update)
+        timings.machine = thisMachine;
+
+    QuietLogger quietLogger;
+    juce::Logger::setCurrentLogger(&quietLogger);
+
+    const juce::File scratchDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                            .getNonexistentChildFile("RenderRegression", "");
+    scratchDirectory.createDirectory();
+
+    std::cout << "StretcherEngine offline render, " << blockSize << "-sample blocks at " << sampleRate << " Hz, best of "
+              << numRuns << (numRuns == 1 ? " run" : " runs") << "\n";
+
+    if (!checkBudgets && timings.machine.isNotEmpty())
+        std::cout << "Budgets were recorded on " << timings.machine << ", not " << thisMachine
+                  << ", so times are shown but not checked; pass --budget-scale to check them\n";
+
+    std::cout << "\n";
+    std::cout << "  scenario                  max diff    diff dB    time ms  budget ms  result\n";
+
+    int numFailed = 0;
+    int numUnrecorded = 0;
+    int numRun = 0;
+
+    for (const Scenario& scenario : makeScenarios())
+    {
+        if (only.isNotEmpty() && scenario.name != only)
+            continue;
+
+        ++numRun;
+        juce::Array<juce::File> sourceFiles;
+
+        for (size_t i = 0; i < scenario.sources.size(); ++i)
+        {
+            const juce::File file = scratchDirectory.getChildFile(scenario.name + "-" + juce::String((int)i + 1) + ".wav");
+
+            // Float, so the source survives the round trip through the file unchanged
+            if (!writeWav(file, synthesizeSource(scenario.sources[i]), 32))
+            {
+                std::cerr << "Could not write " << file.getFullPathName() << "\n";
+                scratchDirectory.deleteRecursively();
+                juce::Logger::setCurrentLogger(nullptr);
+                return 1;
+            }
+
+            sourceFiles.add(file);
+        }
+
+        Render first = render(scenario, sourceFiles);
+        double fastestSeconds = first.seconds;
+        bool deterministic = true;
+
+        for (int run = 1; run < numRuns; ++run)
+        {
+            Render again = render(scenario, sourceFiles);
+            fastestSeconds = juce::jmin(fastestSeconds, again.seconds);
+            deterministic = deterministic && isIdentical(first.output, again.output);
+        }
+
+        const juce::File goldenFile = goldenDirectory.getChildFile(scenario.name + ".wav");
+        const double recordedMilliseconds = timings.milliseconds.getProperty(scenario.name, 0.0);
+        double budgetMilliseconds = recordedMilliseconds * (1.0 + budgetMargin) * budgetScale;
+        juce::String result;
+        Difference difference;
+
+        if (!deterministic)
+        {
+            result = "FAIL: runs differ";
+        }
+        else if (update)
+        {
+            result = writeWav(goldenFile, first.output, 32) ? "updated" : "FAIL: could not write the golden";
+            timings.milliseconds.getDynamicObject()->setProperty(scenario.name, fastestSeconds * 1000.0);
+            budgetMilliseconds = fastestSeconds * 1000.0 * (1.0 + budgetMargin) * budgetScale;
+        }
+        else
+        {
+            juce::AudioBuffer<float> golden;
+
+            if (!goldenFile.existsAsFile())
+            {
+                result = "unrecorded: no golden, record one with --update";
+            }
+            else if (!readWav(goldenFile, golden))
+            {
+                result = "FAIL: could not read the golden";
+            }
+            else if (golden.getNumChannels() != first.output.getNumChannels() || golden.getNumSamples() != first.output.getNumSamples())
+            {
+                result = "FAIL: golden is " + juce::String(golden.getNumChannels()) + " x " + juce::String(golden.getNumSamples())
+                         + " samples";
+            }
+            else
+            {
+                difference = compare(first.output, golden, tolerance);
+
+                if (difference.firstSampleOverTolerance >= 0)
+                    result = "FAIL: differs from " + juce::String(difference.firstSampleOverTolerance / sampleRate, 3) + " s";
+            }
+
+            if (result.isEmpty() && recordedMilliseconds <= 0.0)
+                result = "unrecorded: no timing, record one with --update";
+
+            if (result.isEmpty())
+                result = checkBudgets && fastestSeconds * 1000.0 > budgetMilliseconds ? "FAIL: over budget" : "ok";
+        }
+
+        if (result.startsWith("unrecorded"))
+            ++numUnrecorded;
+
+        if (result.startsWith("FAIL"))
+        {
+            ++numFailed;
+
+            if (outputDirectory != juce::File())
+                writeWav(outputDirectory.getChildFile(scenario.name + ".wav"), first.output, 32);
+        }
+
+        std::cout << "  " << scenario.name.paddedRight(' ', 24)
+                  << juce::String(difference.maxAbsolute, 6).paddedLeft(' ', 10)
+                  << juce::String(difference.relativeDecibels, 1).paddedLeft(' ', 11)
+                  << juce::String(fastestSeconds * 1000.0, 1).paddedLeft(' ', 11)
+                  << juce::String(budgetMilliseconds, 0).paddedLeft(' ', 11)
+                  << "  " << result << "\n";
+    }
+
+    scratchDirectory.deleteRecursively();
+    juce::Logger::setCurrentLogger(nullptr);
+
+    if (update && numRun > 0 && !writeTimings(timingsFile, timings))
+    {
+        std::cerr << "Could not write " << timingsFile.getFullPathName() << "\n";
+        return 2;
+    }
+
+    if (numRun == 0)
+    {
+        std::cerr << "No scenario is called " << only << "\n";
+        return 1;
+    }
+
+    std::cout << "\n" << (numRun - numFailed - numUnrecorded) << " of " << numRun << " scenarios passed";
+
+    if (numUnrecorded > 0)
+        std::cout << ", " << numUnrecorded << " unrecorded";
+
+    std::cout << "\n";
+
+    if (numFailed > 0)
+        return 2;
+
+    return numUnrecorded > 0 ? 3 : 0;
+}
@@ -0,0 +1,339 @@
+#include <JuceHeader.h>
+#include "TempoAnalysis.h"
+#include "Spectrogram.h"
+#include "WaveformPeaks.h"
+#include "TempoCorpus.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <map>
+
+// ============================================================================
+// Headless benchmark for the BPM detectors. Synthesizes the tempo corpus, runs
+// each detector over it and reports throughput and the error distribution.
+//
+//   TempoBenchmark [--quick] [--seconds N] [--sample-rate N] [--seed N]
+//                  [--csv results.csv] [--write-corpus directory]
+//
+// It also checks that warping to a tempo map cancels the drift of the corpus's
+// tempo ramps, and exits with 2 when it doesn't.
+// ============================================================================
+
+namespace
+{
+    struct Detector
+    {
+        juce::String name;
+        std::function<double(const juce::AudioBuffer<float>&, double)> detect;
+    };
+
+    struct Result
+    {
+        juce::String item;
+        juce::String category;
+        double trueBPM;
+        double estimate;
+        double seconds;
+    };
+
+    // The onset envelope as AudioTrack computes it at load: spectral flux from the
+    // spectrogram of the waveform peaks' mono mix
+    std::vector<float> getOnsetStrength(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        WaveformPeaks peaks;
+        peaks.build(buffer);
+
+        Spectrogram spectrogram;
+        spectrogram.build(peaks.getSamples(), sampleRate);
+        return spectrogram.getOnsetStrength();
+    }
+
+    // Relative error against the true tempo, and whether the estimate is within
+    // tolerance of the tempo itself or of a simple multiple of it
+    double relativeError(const Result& result)
+    {
+        return (result.estimate - result.trueBPM) / result.trueBPM;
+    }
+
+    bool isCorrect(const Result& result, double tolerance)
+    {
+        return std::abs(relativeError(result)) <= tolerance;
+    }
+
+    bool isOctaveCorrect(const Result& result, double tolerance)
+    {
+        for (double multiple : { 1.0, 2.0, 0.5, 3.0, 1.0 / 3.0 })
+        {
+            if (std::abs(result.estimate / (result.trueBPM * multiple) - 1.0) <= tolerance)
+                return true;
+        }
+
+        return false;
+    }
+
+    double percentile(std::vector<double> values, double fraction)
+    {
+        if (values.empty())
+            return 0.0;
+
+        size_t index = juce::jmin(values.size() - 1, (size_t)(fraction * (double)(values.size() - 1) + 0.5));
+        std::nth_element(values.begin(), values.begin() + (long)index, values.end());
+        return values[index];
+    }
+
+    juce::String percentString(double fraction)
+    {
+        return juce::String(fraction * 100.0, 1) + "%";
+    }
+
+    void printSummary(const Detector& detector, const std::vector<Result>& results, double audioSeconds)
+    {
+        const double tolerance = 0.04;
+        double totalTime = 0.0;
+        int correct = 0;
+        int octaveCorrect = 0;
+        int withinOnePercent = 0;
+        std::vector<double> absoluteErrors;
+        std::map<juce::String, std::pair<int, int>> perCategory; // correct, total
+
+        for (const auto& result : results)
+        {
+            totalTime += result.seconds;
+            absoluteErrors.push_back(std::abs(relativeError(result)));
+
+            if (isCorrect(result, 0.01))
+                ++withinOnePercent;
+
+            if (isCorrect(result, tolerance))
+                ++correct;
+
+            if (isOctaveCorrect(result, tolerance))
+                ++octaveCorrect;
+
+            auto& category = perCategory[result.category];
+            category.first += isCorrect(result, tolerance) ? 1 : 0;
+            category.second += 1;
+        }
+
+        const double count = (double)juce::jmax((size_t)1, results.size());
+
+        std::cout << "\n" << detector.name << "\n";
+        std::cout << "  throughput     " << juce::String(audioSeconds / juce::jmax(1.0e-9, totalTime), 0)
+                  << "x real time (" << juce::String(totalTime * 1000.0 / count, 2) << " ms per item)\n";
+        std::cout << "  within 1%      " << percentString(withinOnePercent / count) << "\n";
+        std::cout << "  within 4%      " << percentString(correct / count) << "\n";
+        std::cout << "  octave errors  " << percentString((octaveCorrect - correct) / count) << "\n";
+        std::cout << "  other errors   " << percentString((count - octaveCorrect) / count) << "\n";
+        std::cout << "  |error| p50 " << percentString(percentile(absoluteErrors, 0.5))
+                  << "  p90 " << percentString(percentile(absoluteErrors, 0.9))
+                  << "  max " << percentString(percentile(absoluteErrors, 1.0)) << "\n";
+
+        for (const auto& category : perCategory)
+        {
+            std::cout << "    " << category.first.paddedRight(' ', 8)
+                      << percentString(category.second.first / (double)category.second.second)
+                      << " of " << category.second.second << " within 4%\n";
+        }
+    }
+
+    // Beat times of a linear tempo ramp, whose beat count is the integral of the tempo
+    std::vector<double> getRampBeatTimes(const TempoCorpus::ItemSpec& spec, double duration)
+    {
+        const double slope = (spec.endBPM - spec.startBPM) / duration;
+        std::vector<double> beatTimes;
+
+        for (int beat = 0;; ++beat)
+        {
+            const double time = std::abs(slope) < 1.0e-9
+                                    ? 60.0 * beat / spec.startBPM
+                                    : (std::sqrt(spec.startBPM * spec.startBPM + 120.0 * slope * beat) - spec.startBPM) / slope;
+
+            if (!(time < duration))
+                return beatTimes;
+
+            beatTimes.push_back(time);
+        }
+    }
+
+    // Plays a ramp the way AudioTrack does, one ratio per block, and returns the worst
+    // output beat interval's error as a share of the master tempo's beat. The beats at
+    // either end, where the map's smoothing window is cut short, are left out.
+    double measureWarpDrift(const TempoCorpus::ItemSpec& spec, double duration, double sampleRate, bool warp)
+    {
+        const int blockSize = 512;
+        const double masterBPM = 120.0;
+        const std::vector<double> beatTimes = getRampBeatTimes(spec, duration);
+
+        TempoMap tempoMap;
+        tempoMap.build(beatTimes, spec.getTrueBPM());
+
+        const double stretchRatio = masterBPM / spec.getTrueBPM();
+        std::vector<double> outputBeatTimes;
+        double sourceTime = 0.0;
+        double outputTime = 0.0;
+
+        while (outputBeatTimes.size() < beatTimes.size())
+        {
+            const double ratio = warp ? juce::jlimit(0.25, 4.0, tempoMap.getWarpedRatioAt(sourceTime, stretchRatio)) : stretchRatio;
+            const double sourceAdvance = blockSize * ratio / sampleRate;
+
+            while (outputBeatTimes.size() < beatTimes.size() && beatTimes[outputBeatTimes.size()] < sourceTime + sourceAdvance)
+                outputBeatTimes.push_back(outputTime + (beatTimes[outputBeatTimes.size()] - sourceTime) / ratio);
+
+            sourceTime += sourceAdvance;
+            outputTime += blockSize / sampleRate;
+        }
+
+        const int margin = 5;
+        const double masterInterval = 60.0 / masterBPM;
+        double worstError = 0.0;
+
+        for (size_t i = margin; i + margin < outputBeatTimes.size(); ++i)
+            worstError = juce::jmax(worstError, std::abs((outputBeatTimes[i] - outputBeatTimes[i - 1]) / masterInterval - 1.0));
+
+        return worstError;
+    }
+
+    void writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        file.deleteFile();
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+
+        if (stream == nullptr)
+            return;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)buffer.getNumChannels(), 24, {}, 0));
+
+        if (writer != nullptr)
+        {
+            stream.release(); // The writer owns the stream now
+            writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    const bool quick = args.containsOption("--quick");
+    const double duration = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 30.0;
+    const double sampleRate = args.containsOption("--sample-rate") ? args.getValueForOption("--sample-rate").getDoubleValue() : 44100.0;
+    const juce::uint32 seed = args.containsOption("--seed") ? (juce::uint32)args.getValueForOption("--seed").getIntValue() : 1;
+
+    if (duration < 2.0 || sampleRate < 8000.0)
+    {
+        std::cerr << "Need at least 2 seconds per item and a sample rate of 8000 Hz or more\n";
+        return 1;
+    }
+
+    const std::vector<Detector> detectors =
+    {
+        { "detectBPMFromOnsets", [](const juce::AudioBuffer<float>& buffer, double rate)
+            {
+                return TempoAnalysis::detectBPMFromOnsets(getOnsetStrength(buffer, rate), rate);
+            } },
+        { "rankTempoCandidates (top)", [](const juce::AudioBuffer<float>& buffer, double rate)
+            {
+                auto onsets = TempoAnalysis::pickOnsetTimes(getOnsetStrength(buffer, rate), rate);
+                auto candidates = TempoAnalysis::rankTempoCandidates(onsets, 1);
+                return candidates.empty() ? 120.0 : candidates.front().bpm;
+            } },
+        { "detectBPMAutocorrelation", [](const juce::AudioBuffer<float>& buffer, double rate)
+            {
+                return TempoAnalysis::detectBPMAutocorrelation(buffer, rate);
+            } },
+        { "detectBPMImproved", [](const juce::AudioBuffer<float>& buffer, double rate)
+            {
+                return TempoAnalysis::detectBPMImproved(buffer.getNumSamples() / rate);
+            } }
+    };
+
+    const std::vector<TempoCorpus::ItemSpec> corpus = TempoCorpus::createStandardCorpus(seed, quick);
+
+    juce::File corpusDirectory;
+    if (args.containsOption("--write-corpus"))
+    {
+        corpusDirectory = args.getFileForOption("--write-corpus");
+        corpusDirectory.createDirectory();
+    }
+
+    std::cout << "Tempo corpus: " << corpus.size() << " items of " << duration << " s at "
+              << sampleRate << " Hz (seed " << (int)seed << ")\n";
+
+    std::vector<std::vector<Result>> results(detectors.size());
+    juce::AudioBuffer<float> buffer;
+
+    for (const auto& spec : corpus)
+    {
+        TempoCorpus::render(spec, buffer, sampleRate, duration);
+
+        if (corpusDirectory.isDirectory())
+            writeWav(corpusDirectory.getChildFile(spec.name + ".wav"), buffer, sampleRate);
+
+        for (size_t i = 0; i < detectors.size(); ++i)
+        {
+            const double startTime = juce::Time::getMillisecondCounterHiRes();
+            const double estimate = detectors[i].detect(buffer, sampleRate);
+            const double elapsed = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+            results[i].push_back({ spec.name, spec.category, spec.getTrueBPM(), estimate, elapsed });
+        }
+    }
+
+    const double audioSeconds = duration * (double)corpus.size();
+
+    for (size_t i = 0; i < detectors.size(); ++i)
+        printSummary(detectors[i], results[i], audioSeconds);
+
+    // Warping should leave a small fraction of a ramp's drift; the wrong direction doubles it
+    bool warpCancelsDrift = true;
+    std::cout << "\nTempo map warp, worst beat interval error at 120 BPM\n";
+
+    // Shorter items leave too few beats once the ends are dropped
+    if (duration < 10.0)
+        std::cout << "    skipped, needs items of 10 s or more\n";
+
+    for (const auto& spec : corpus)
+    {
+        if (spec.startBPM == spec.endBPM || duration < 10.0)
+            continue;
+
+        const double unwarped = measureWarpDrift(spec, duration, sampleRate, false);
+        const double warped = measureWarpDrift(spec, duration, sampleRate, true);
+        const bool cancelled = warped < 0.005 && warped < unwarped * 0.25;
+        warpCancelsDrift = warpCancelsDrift && cancelled;
+
+        std::cout << "    " << spec.name.paddedRight(' ', 28) << percentString(unwarped).paddedLeft(' ', 7)
+                  << " unwarped " << percentString(warped).paddedLeft(' ', 7) << " warped"
+                  << (cancelled ? "" : "  FAIL") << "\n";
+    }
+
+    if (args.containsOption("--csv"))
+    {
+        juce::File csvFile = args.getFileForOption("--csv");
+        juce::String csv = "detector,item,category,true_bpm,estimate,relative_error,seconds\n";
+
+        for (size_t i = 0; i < detectors.size(); ++i)
+        {
+            for (const auto& result : results[i])
+            {
+                csv << detectors[i].name << "," << result.item << "," << result.category << ","
+                    << juce::String(result.trueBPM, 3) << "," << juce::String(result.estimate, 3) << ","
+                    << juce::String(relativeError(result), 5) << "," << juce::String(result.seconds, 6) << "\n";
+            }
+        }
+
+        if (!csvFile.replaceWithText(csv))
+        {
+            std::cerr << "Could not write " << csvFile.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+
+    return warpCancelsDrift ? 0 : 2;
+}
@@ -0,0 +1,206 @@
+#include "TempoCorpus.h"
+#include <cmath>
+
+namespace
+{
+    enum class Voice
+    {
+        click,
+        accent,
+        kick,
+        snare,
+        hat
+    };
+
+    void addHit(juce::AudioBuffer<float>& buffer, int startSample, Voice voice,
+                float gain, double sampleRate, juce::Random& random)
+    {
+        const int numSamples = buffer.getNumSamples();
+        float* data = buffer.getWritePointer(0);
+
+        double lengthSeconds = 0.0;
+        switch (voice)
+        {
+            case Voice::click:
+            case Voice::accent: lengthSeconds = 0.02; break;
+            case Voice::kick:   lengthSeconds = 0.25; break;
+            case Voice::snare:  lengthSeconds = 0.15; break;
+            case Voice::hat:    lengthSeconds = 0.04; break;
+        }
+
+        const int length = juce::jmin((int)(lengthSeconds * sampleRate), numSamples - startSample);
+        const double twoPi = juce::MathConstants<double>::twoPi;
+        double phase = 0.0;
+        float previousNoise = 0.0f;
+
+        for (int i = 0; i < length; ++i)
+        {
+            const double t = i / sampleRate;
+            float sample = 0.0f;
+
+            switch (voice)
+            {
+                case Voice::click:
+                case Voice::accent:
+                {
+                    double frequency = voice == Voice::accent ? 1500.0 : 1000.0;
+                    sample = (float)(std::sin(twoPi * frequency * t) * std::exp(-t * 300.0));
+                    break;
+                }
+                case Voice::kick:
+                {
+                    // Pitch sweep from 120 Hz down to 50 Hz
+                    double frequency = 50.0 + 70.0 * std::exp(-t * 30.0);
+                    phase += twoPi * frequency / sampleRate;
+                    sample = (float)(std::sin(phase) * std::exp(-t * 18.0));
+                    break;
+                }
+                case Voice::snare:
+                {
+                    float noise = random.nextFloat() * 2.0f - 1.0f;
+                    double tone = std::sin(twoPi * 200.0 * t) * 0.4;
+                    sample = (float)((noise * 0.6 + tone) * std::exp(-t * 25.0));
+                    break;
+                }
+                case Voice::hat:
+                {
+                    // First difference of white noise tilts it towards the top end
+                    float noise = random.nextFloat() * 2.0f - 1.0f;
+                    sample = (float)((noise - previousNoise) * 0.5 * std::exp(-t * 90.0));
+                    previousNoise = noise;
+                    break;
+                }
+            }
+
+            data[startSample + i] += sample * gain;
+        }
+    }
+}
+
+std::vector<TempoCorpus::ItemSpec> TempoCorpus::createStandardCorpus(juce::uint32 seed, bool quick)
+{
+    std::vector<ItemSpec> specs;
+    juce::uint32 itemSeed = seed;
+
+    auto addItem = [&](const juce::String& category, double startBPM, double endBPM,
+                       double swing, double noiseLevel)
+    {
+        ItemSpec spec;
+        spec.category = category;
+        spec.startBPM = startBPM;
+        spec.endBPM = endBPM;
+        spec.swing = swing;
+        spec.noiseLevel = noiseLevel;
+        spec.seed = ++itemSeed;
+        spec.name = category + "-" + juce::String(startBPM, 1);
+
+        if (endBPM != startBPM)
+            spec.name << "-" << juce::String(endBPM, 1);
+
+        if (swing > 0.0)
+            spec.name << "-swing" << juce::String(swing, 2);
+
+        if (noiseLevel > 0.0)
+            spec.name << "-noise" << juce::String(noiseLevel, 2);
+
+        specs.push_back(spec);
+    };
+
+    const double tempoStep = quick ? 20.0 : 7.0;
+
+    for (double bpm = 62.0; bpm <= 198.0; bpm += tempoStep)
+        addItem("click", bpm, bpm, 0.0, 0.0);
+
+    for (double bpm = 70.0; bpm <= 180.0; bpm += tempoStep * 1.5)
+        addItem("drums", bpm, bpm, 0.0, 0.0);
+
+    for (double swing : { 0.2, 0.33, 0.5 })
+    {
+        for (double bpm = 80.0; bpm <= 160.0; bpm += tempoStep * 3.0)
+            addItem("swing", bpm, bpm, swing, 0.0);
+    }
+
+    for (double noise : { 0.1, 0.3, 0.6 })
+    {
+        for (double bpm = 75.0; bpm <= 175.0; bpm += tempoStep * 3.0)
+            addItem("noisy", bpm, bpm, 0.0, noise);
+    }
+
+    for (auto ramp : { std::make_pair(90.0, 100.0), std::make_pair(120.0, 128.0),
+                       std::make_pair(140.0, 126.0), std::make_pair(100.0, 130.0) })
+    {
+        addItem("ramp", ramp.first, ramp.second, 0.0, 0.05);
+    }
+
+    return specs;
+}
+
+void TempoCorpus::render(const ItemSpec& spec, juce::AudioBuffer<float>& buffer,
+                         double sampleRate, double durationInSeconds)
+{
+    const int numSamples = (int)(durationInSeconds * sampleRate);
+    buffer.setSize(1, numSamples, false, true, false);
+    buffer.clear();
+
+    juce::Random random((juce::int64)spec.seed);
+    const bool isClick = spec.category == "click";
+
+    // Events sit on an eighth-note grid; the grid is advanced by the instantaneous
+    // tempo so ramps come out as a smooth accelerando
+    double beatPosition = 0.0;
+    int nextEighth = 0;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        double progress = (double)sample / numSamples;
+        double bpm = spec.startBPM + (spec.endBPM - spec.startBPM) * progress;
+        double nextBeat = nextEighth * 0.5;
+
+        // Swing delays the off-beat eighths
+        if (nextEighth % 2 == 1)
+            nextBeat += spec.swing * 0.5;
+
+        if (beatPosition >= nextBeat)
+        {
+            const int beatInBar = (nextEighth / 2) % 4;
+            const bool onBeat = nextEighth % 2 == 0;
+
+            if (isClick)
+            {
+                if (onBeat)
+                    addHit(buffer, sample, beatInBar == 0 ? Voice::accent : Voice::click, 0.8f, sampleRate, random);
+            }
+            else
+            {
+                if (onBeat && (beatInBar == 0 || beatInBar == 2))
+                    addHit(buffer, sample, Voice::kick, 0.9f, sampleRate, random);
+
+                if (onBeat && (beatInBar == 1 || beatInBar == 3))
+                    addHit(buffer, sample, Voice::snare, 0.7f, sampleRate, random);
+
+                addHit(buffer, sample, Voice::hat, onBeat ? 0.35f : 0.25f, sampleRate, random);
+            }
+
+            // Ghost hits that fall between the grid
+            if (spec.noiseLevel > 0.0 && random.nextDouble() < spec.noiseLevel * 0.5)
+            {
+                int offset = (int)(random.nextDouble() * 30.0 / bpm * sampleRate);
+                if (sample + offset < numSamples)
+                    addHit(buffer, sample + offset, Voice::snare, 0.3f, sampleRate, random);
+            }
+
+            ++nextEighth;
+        }
+
+        beatPosition += bpm / (60.0 * sampleRate);
+    }
+
+    if (spec.noiseLevel > 0.0)
+    {
+        float* data = buffer.getWritePointer(0);
+        const float noiseGain = (float)(spec.noiseLevel * 0.3);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            data[sample] += (random.nextFloat() * 2.0f - 1.0f) * noiseGain;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Synthetic audio with known tempo for measuring the BPM detectors.
+// Items are described up front and rendered one at a time so memory stays bounded.
+namespace TempoCorpus
+{
+    struct ItemSpec
+    {
+        juce::String name;
+        juce::String category;   // "click", "drums", "swing", "noisy" or "ramp"
+        double startBPM;
+        double endBPM;           // Equal to startBPM unless the tempo ramps
+        double swing;            // Off-beat eighths delayed by this share of an eighth (0..0.66)
+        double noiseLevel;       // Background noise and random ghost hits (0..1)
+        juce::uint32 seed;
+
+        // Average tempo over the item, which is what a single-BPM detector should report
+        double getTrueBPM() const { return 0.5 * (startBPM + endBPM); }
+    };
+
+    // The standard corpus: click tracks across the tempo range, straight, swung and
+    // noisy drum patterns, and linear tempo ramps
+    std::vector<ItemSpec> createStandardCorpus(juce::uint32 seed, bool quick);
+
+    // Renders a mono item of the given length
+    void render(const ItemSpec& spec, juce::AudioBuffer<float>& buffer,
+                double sampleRate, double durationInSeconds);
+}
@@ -0,0 +1,383 @@
+#include <JuceHeader.h>
+#include <soundtouch/SoundTouch.h>
+#include "AudioTrack.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+
+// ============================================================================
+// Batch tempo conform for loop libraries. Every audio file under the input folder
+// is loaded and analysed like a track in the app, stretched to the target tempo and
+// written as a WAV under the same relative path in the output folder.
+//
+//   TempoConform --in folder --out folder --bpm N [--jobs N] [--max-memory MB]
+//                [--report report.csv] [--min-confidence X] [--no-fold] [--verbose]
+//
+// Files run concurrently, but only as many as fit the memory budget. Each result
+// is appended to the report as soon as it is written, and outputs only appear
+// under their final name once complete, so an interrupted run picks up where it
+// stopped: files the report lists as done, whose output exists, are skipped.
+// ============================================================================
+
+namespace
+{
+    struct Job
+    {
+        juce::File source;
+        juce::String relativePath;
+        juce::File output;
+    };
+
+    struct Outcome
+    {
+        juce::String status;        // ok, low-confidence, unreadable, failed
+        double detectedBPM = 0.0;
+        double confidence = 0.0;
+        double sourceBPM = 0.0;     // The detected tempo after octave folding
+        double ratio = 1.0;
+        double seconds = 0.0;
+    };
+
+    // Swallows the per-track log lines unless --verbose is given
+    class QuietLogger : public juce::Logger
+    {
+    public:
+        void logMessage(const juce::String&) override {}
+    };
+
+    // Bytes in flight across all jobs. A job waits until its estimate fits, except
+    // when nothing else is running, so a single huge file still gets through.
+    class MemoryBudget
+    {
+    public:
+        explicit MemoryBudget(juce::int64 limitInBytes) : limit(limitInBytes), inUse(0) {}
+
+        void acquire(juce::int64 bytes)
+        {
+            for (;;)
+            {
+                {
+                    juce::ScopedLock sl(lock);
+
+                    if (inUse == 0 || inUse + bytes <= limit)
+                    {
+                        inUse += bytes;
+                        return;
+                    }
+                }
+
+                released.wait(50);
+            }
+        }
+
+        void release(juce::int64 bytes)
+        {
+            {
+                juce::ScopedLock sl(lock);
+                inUse -= bytes;
+            }
+
+            released.signal();
+        }
+
+    private:
+        const juce::int64 limit;
+        juce::int64 inUse;
+        juce::CriticalSection lock;
+        juce::WaitableEvent released;
+    };
+
+    juce::String quoted(const juce::String& text)
+    {
+        return "\"" + text.replace("\"", "\"\"") + "\"";
+    }
+
+    // Report lines of earlier runs that finished a file; the last line for a file wins
+    std::map<juce::String, juce::String> readFinishedFiles(const juce::File& report)
+    {
+        std::map<juce::String, juce::String> statuses;
+        juce::StringArray lines;
+        report.readLines(lines);
+
+        for (int i = 1; i < lines.size(); ++i)
+        {
+            juce::StringArray fields;
+            fields.addTokens(lines[i], ",", "\"");
+
+            if (fields.size() >= 2)
+                statuses[fields[0].unquoted().replace("\"\"", "\"")] = fields[1];
+        }
+
+        return statuses;
+    }
+
+    // A loop at 70 BPM conformed to 140 should play twice as many beats, not twice as fast
+    double foldTowards(double bpm, double target)
+    {
+        while (bpm < target / std::sqrt(2.0))
+            bpm *= 2.0;
+
+        while (bpm > target * std::sqrt(2.0))
+            bpm *= 0.5;
+
+        return bpm;
+    }
+
+    // The whole file through SoundTouch, set up as AudioTrack sets it up, then flushed
+    // so the tail is not lost, and trimmed or padded to exactly the stretched length
+    void stretch(const juce::AudioBuffer<float>& source, double sampleRate, double ratio, juce::AudioBuffer<float>& result)
+    {
+        const int numChannels = source.getNumChannels();
+        const int numSamples = source.getNumSamples();
+        const int targetLength = (int)std::llround(numSamples / ratio);
+        const int chunkSize = 8192;
+
+        soundtouch::SoundTouch soundTouch;
+        soundTouch.setSampleRate((uint32_t)sampleRate);
+        soundTouch.setChannels((uint32_t)numChannels);
+        soundTouch.setTempo(ratio);
+        soundTouch.setPitch(1.0);
+
+        result.setSize(numChannels, targetLength);
+        result.clear();
+
+        std::vector<float> interleaved((size_t)(chunkSize * numChannels));
+        int written = 0;
+
+        auto collect = [&]
+        {
+            for (;;)
+            {
+                const int received = (int)soundTouch.receiveSamples(interleaved.data(), (uint32_t)chunkSize);
+
+                if (received <= 0)
+                    break;
+
+                const int toCopy = juce::jmin(received, targetLength - written);
+
+                for (int i = 0; i < toCopy; ++i)
+                    for (int ch = 0; ch < numChannels; ++ch)
+                        result.setSample(ch, written + i, interleaved[(size_t)(i * numChannels + ch)]);
+
+                written += toCopy;
+            }
+        };
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int count = juce::jmin(chunkSize, numSamples - start);
+
+            for (int i = 0; i < count; ++i)
+                for (int ch = 0; ch < numChannels; ++ch)
+                    interleaved[(size_t)(i * numChannels + ch)] = source.getSample(ch, start + i);
+
+            soundTouch.putSamples(interleaved.data(), (uint32_t)count);
+            collect();
+        }
+
+        soundTouch.flush();
+        collect();
+    }
+
+    Outcome conform(const Job& job, double targetBPM, bool fold, double minimumConfidence)
+    {
+        Outcome outcome;
+        const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+        AudioTrack track;
+        track.loadAudioFile(job.source);
+
+        if (!track.isLoaded())
+        {
+            outcome.status = "unreadable";
+            return outcome;
+        }
+
+        outcome.detectedBPM = track.getDetectedBPM();
+        outcome.confidence = track.getBPMConfidence();
+        outcome.sourceBPM = fold ? foldTowards(outcome.detectedBPM, targetBPM) : outcome.detectedBPM;
+        outcome.ratio = targetBPM / outcome.sourceBPM;
+
+        juce::AudioBuffer<float> stretched;
+        stretch(track.getAudioBuffer(), track.getSampleRate(), outcome.ratio, stretched);
+
+        // Written under a temporary name first, so a half-written file is never taken as done
+        job.output.getParentDirectory().createDirectory();
+        const juce::File partial = job.output.getSiblingFile(job.output.getFileName() + ".part");
+        partial.deleteFile();
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::OutputStream> stream(partial.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        if (stream != nullptr)
+        {
+            writer.reset(wavFormat.createWriterFor(stream.get(), track.getSampleRate(),
+                                                   (unsigned int)stretched.getNumChannels(), 24, {}, 0));
+
+            if (writer != nullptr)
+                stream.release(); // The writer owns the stream now
+        }
+
+        const bool written = writer != nullptr && writer->writeFromAudioSampleBuffer(stretched, 0, stretched.getNumSamples());
+        writer.reset();
+
+        if (!written || !partial.moveFileTo(job.output))
+        {
+            partial.deleteFile();
+            outcome.status = "failed";
+            return outcome;
+        }
+
+        outcome.status = outcome.confidence >= minimumConfidence ? "ok" : "low-confidence";
+        outcome.seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        return outcome;
+    }
+
+    // Decoded copy, the track's buffer, the output at up to 1.5 times the length, and
+    // the mono mix with its analysis
+    juce::int64 estimateMemory(const juce::File& file, juce::AudioFormatManager& formatManager, juce::CriticalSection& formatLock)
+    {
+        juce::ScopedLock sl(formatLock);
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+        if (reader == nullptr)
+            return 0;
+
+        return reader->lengthInSamples * (juce::int64)sizeof(float) * ((juce::int64)reader->numChannels * 4 + 3);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    const juce::File inputFolder = args.containsOption("--in") ? args.getFileForOption("--in") : juce::File();
+    const juce::File outputFolder = args.containsOption("--out") ? args.getFileForOption("--out") : juce::File();
+    const double targetBPM = args.containsOption("--bpm") ? args.getValueForOption("--bpm").getDoubleValue() : 0.0;
+    const int numJobs = args.containsOption("--jobs") ? args.getValueForOption("--jobs").getIntValue() : juce::SystemStats::getNumCpus();
+    const juce::int64 memoryLimit = (args.containsOption("--max-memory") ? args.getValueForOption("--max-memory").getLargeIntValue() : 2048)
+                                    * 1024 * 1024;
+    const double minimumConfidence = args.containsOption("--min-confidence") ? args.getValueForOption("--min-confidence").getDoubleValue() : 0.3;
+    const bool fold = !args.containsOption("--no-fold");
+
+    if (!inputFolder.isDirectory() || outputFolder == juce::File() || targetBPM < 20.0 || targetBPM > 400.0 || numJobs < 1)
+    {
+        std::cerr << "Usage: TempoConform --in folder --out folder --bpm N [--jobs N] [--max-memory MB]\n"
+                     "                    [--report report.csv] [--min-confidence X] [--no-fold] [--verbose]\n";
+        return 1;
+    }
+
+    if (inputFolder == outputFolder || outputFolder.isAChildOf(inputFolder))
+    {
+        std::cerr << "The output folder must be outside the input folder\n";
+        return 1;
+    }
+
+    QuietLogger quietLogger;
+    if (!args.containsOption("--verbose"))
+        juce::Logger::setCurrentLogger(&quietLogger);
+
+    outputFolder.createDirectory();
+    const juce::File reportFile = args.containsOption("--report") ? args.getFileForOption("--report")
+                                                                  : outputFolder.getChildFile("conform-report.csv");
+
+    // Work out what is left to do
+    const std::map<juce::String, juce::String> finished = readFinishedFiles(reportFile);
+    juce::Array<juce::File> sources = inputFolder.findChildFiles(juce::File::findFiles, true, "*.wav;*.aif;*.aiff;*.flac;*.mp3;*.ogg");
+    std::sort(sources.begin(), sources.end());
+
+    std::vector<Job> jobs;
+    int numResumed = 0;
+
+    for (const juce::File& source : sources)
+    {
+        Job job;
+        job.source = source;
+        job.relativePath = source.getRelativePathFrom(inputFolder);
+        job.output = outputFolder.getChildFile(job.relativePath).withFileExtension("wav");
+
+        const auto previous = finished.find(job.relativePath);
+        const bool done = previous != finished.end() && (previous->second == "ok" || previous->second == "low-confidence");
+
+        if (done && job.output.existsAsFile())
+            ++numResumed;
+        else
+            jobs.push_back(job);
+    }
+
+    std::unique_ptr<juce::FileOutputStream> report(reportFile.createOutputStream());
+
+    if (report == nullptr || report->failedToOpen())
+    {
+        std::cerr << "Could not open " << reportFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    if (report->getPosition() == 0)
+        *report << "file,status,detected_bpm,confidence,source_bpm,ratio,seconds,output\n";
+
+    std::cout << "Conforming " << jobs.size() << " of " << sources.size() << " files to " << targetBPM << " BPM with "
+              << numJobs << " jobs (" << numResumed << " already done)\n";
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    juce::CriticalSection formatLock;
+    MemoryBudget budget(memoryLimit);
+
+    juce::CriticalSection reportLock;
+    std::map<juce::String, int> counts;
+    int numFinished = 0;
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        juce::ThreadPool pool(numJobs);
+
+        for (const Job& job : jobs)
+        {
+            pool.addJob([&, job]
+            {
+                const juce::int64 bytes = estimateMemory(job.source, formatManager, formatLock);
+                budget.acquire(bytes);
+                const Outcome outcome = conform(job, targetBPM, fold, minimumConfidence);
+                budget.release(bytes);
+
+                juce::ScopedLock sl(reportLock);
+
+                *report << quoted(job.relativePath) << "," << outcome.status << ","
+                        << juce::String(outcome.detectedBPM, 2) << "," << juce::String(outcome.confidence, 3) << ","
+                        << juce::String(outcome.sourceBPM, 2) << "," << juce::String(outcome.ratio, 5) << ","
+                        << juce::String(outcome.seconds, 3) << "," << quoted(job.output.getRelativePathFrom(outputFolder)) << "\n";
+                report->flush();
+
+                ++counts[outcome.status];
+                ++numFinished;
+
+                std::cout << "[" << numFinished << "/" << jobs.size() << "] " << job.relativePath << ": " << outcome.status;
+
+                if (outcome.detectedBPM > 0.0)
+                    std::cout << " (" << juce::String(outcome.detectedBPM, 1) << " BPM, confidence "
+                              << juce::String(outcome.confidence, 2) << ")";
+
+                std::cout << std::endl;
+            });
+        }
+
+        // Destroying the pool would drop any job still queued, so wait for all of them
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(100);
+    }
+
+    const double elapsed = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    std::cout << "\nDone in " << juce::String(elapsed, 1) << " s:";
+    for (const auto& count : counts)
+        std::cout << " " << count.second << " " << count.first;
+    std::cout << "\nReport: " << reportFile.getFullPathName() << "\n";
+
+    juce::Logger::setCurrentLogger(nullptr);
+
+    return counts["failed"] + counts["unreadable"] > 0 ? 2 : 0;
+}